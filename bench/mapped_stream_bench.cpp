@@ -0,0 +1,98 @@
+// Opening a PDF and loading every page through MuPDF's file stream
+// (fz_open_file) against the prefetched mmap stream of --mmap. The PDF is
+// BOOKSLICE_BENCH_PDF; point it at the storage the books live on, since
+// the mapping is meant for storage where each small read is a round trip.
+// Cold runs drop the file from the page cache (POSIX_FADV_DONTNEED) before
+// each iteration, outside the timing; warm runs read it from the cache.
+#include <benchmark/benchmark.h>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <mupdf/fitz.h>
+#include <string>
+#include <unistd.h>
+
+#include "pdf/session.hpp"
+
+namespace {
+
+const char *pdfPath() { return std::getenv("BOOKSLICE_BENCH_PDF"); }
+
+// false if the file's pages could not be dropped from the cache
+bool evict(const char *path) {
+  const int fd = ::open(path, O_RDONLY | O_CLOEXEC);
+  if (fd < 0)
+    return false;
+  const bool ok = posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+  ::close(fd);
+  return ok;
+}
+
+// what the pipeline's open path reads: trailer, xref, page tree, and the
+// objects of every page
+int loadPages(const PdfFile &pdf) {
+  fz_context *ctx = pdf.ctx();
+  const int count = pdf.pageCount();
+  int loaded = 0;
+  for (int i = 0; i < count; ++i) {
+    fz_page *page = nullptr;
+    fz_var(page);
+    fz_try(ctx) { page = fz_load_page(ctx, pdf.doc(), i); }
+    fz_catch(ctx) { continue; }
+    benchmark::DoNotOptimize(fz_bound_page(ctx, page));
+    fz_drop_page(ctx, page);
+    ++loaded;
+  }
+  return loaded;
+}
+
+// range(0): 1 for the mmap stream; range(1): 1 for a cold page cache
+void BM_openAndLoadPages(benchmark::State &state) {
+  const char *path = pdfPath();
+  if (!path) {
+    state.SkipWithError("set BOOKSLICE_BENCH_PDF to a PDF");
+    return;
+  }
+  const auto mode =
+      state.range(0) ? PdfFile::Open::Mapped : PdfFile::Open::Path;
+  const bool cold = state.range(1) != 0;
+  PdfSession session;
+  if (!session.isValid()) {
+    state.SkipWithError("no MuPDF context");
+    return;
+  }
+
+  int pages = 0;
+  for (auto _ : state) {
+    state.PauseTiming();
+    // nothing parsed in one iteration is reused by the next
+    fz_empty_store(session.ctx());
+    if (cold && !evict(path)) {
+      state.SkipWithError("cannot drop the PDF from the page cache");
+      return;
+    }
+    state.ResumeTiming();
+
+    const PdfFile pdf(session.ctx(), path, mode);
+    if (!pdf.isValid()) {
+      state.SkipWithError("cannot open the PDF");
+      return;
+    }
+    pages = loadPages(pdf);
+  }
+  state.counters["pages"] = pages;
+  state.SetBytesProcessed(
+      state.iterations() *
+      static_cast<std::int64_t>(std::filesystem::file_size(path)));
+  state.SetLabel(state.range(0) ? "mmap" : "fz_open_file");
+}
+
+} // namespace
+
+BENCHMARK(BM_openAndLoadPages)
+    ->ArgNames({"mapped", "cold"})
+    ->ArgsProduct({{0, 1}, {0, 1}})
+    ->UseRealTime()
+    ->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,146 @@
+// CPU per record of encoding section upserts: SectionBson, whose builders
+// are reused and whose chapter fields are encoded once per chapter, against
+// a fresh stream-builder document per record (the encoding it replaced).
+// One iteration is one record, so the CPU column is the cost per record.
+#include <benchmark/benchmark.h>
+#include <bsoncxx/builder/stream/document.hpp>
+#include <string>
+#include <vector>
+
+#include "db/section_bson.hpp"
+#include "utils.hpp"
+
+namespace {
+
+using bsoncxx::builder::stream::close_document;
+using bsoncxx::builder::stream::document;
+using bsoncxx::builder::stream::finalize;
+using bsoncxx::builder::stream::open_document;
+
+enum Form { kPlain, kRef, kPacked };
+
+constexpr int kSectionsPerChapter = 40;
+
+// one chapter's records; the texts they view are kept alongside, so it is
+// filled in place and never moved
+struct Chapter {
+  std::vector<std::string> titles;
+  std::string text;
+  std::vector<Record> records;
+};
+
+void fill(Chapter &ch, Form form, std::size_t contentBytes) {
+  const auto origin = std::make_shared<const ChapterFields>(ChapterFields{
+      "A Book About Benchmarks", "metadata", "/books/benchmarks.pdf",
+      "07_measuring.json", "07_measuring", "Measuring What Matters"});
+  ch.text.assign(contentBytes * kSectionsPerChapter, 'x');
+  for (int i = 0; i < kSectionsPerChapter; ++i)
+    ch.titles.push_back("7." + std::to_string(i + 1) + " Section title");
+  for (int i = 0; i < kSectionsPerChapter; ++i) {
+    Record r;
+    r.origin = origin;
+    r.section_index = i;
+    r.title = ch.titles[i];
+    r.startline = i * 30;
+    r.endline = i * 30 + 29;
+    const std::string_view content =
+        std::string_view(ch.text).substr(i * contentBytes, contentBytes);
+    switch (form) {
+    case kPlain:
+      r.content = content;
+      break;
+    case kRef:
+      r.content_blob = "0123456789abcdef-61440";
+      r.content_offset = i * contentBytes;
+      r.content_length = contentBytes;
+      break;
+    case kPacked:
+      r.content_z = content.substr(0, contentBytes / 3);
+      r.content_dict = "fedcba9876543210-112640";
+      r.content_codec = 1;
+      r.content_chars = contentBytes;
+      break;
+    }
+    r.content_hash = Hash::fnv1a(content);
+    ch.records.push_back(r);
+  }
+}
+
+// the per-record filter and update documents SectionBson replaced
+std::size_t streamEncode(const Record &r) {
+  const ChapterFields &o = *r.origin;
+  auto filter = document{} << "book_title" << o.book_title << "chapter"
+                           << o.chapter << "title" << r.title << finalize;
+  auto update = document{};
+  auto set = update << "$set" << open_document << "book_title"
+                    << o.book_title << "book_title_src" << o.book_title_src
+                    << "book_path" << o.book_path << "chapter_file"
+                    << o.chapter_file << "chapter" << o.chapter
+                    << "chapter_title" << o.chapter_title << "section_index"
+                    << r.section_index << "title" << r.title << "startline"
+                    << r.startline << "endline" << r.endline << "content_hash"
+                    << Hash::hex(r.content_hash);
+  if (!r.content_blob.empty()) {
+    set << "content_blob" << r.content_blob << "content_offset"
+        << static_cast<std::int64_t>(r.content_offset) << "content_length"
+        << static_cast<std::int64_t>(r.content_length) << close_document
+        << "$unset" << open_document << "content" << "" << "content_z" << ""
+        << "content_dict" << "" << "content_codec" << "" << "content_chars"
+        << "" << close_document;
+  } else if (!r.content_dict.empty()) {
+    set << "content_z" << bsonBinary(r.content_z) << "content_dict"
+        << r.content_dict << "content_codec" << r.content_codec
+        << "content_chars" << static_cast<std::int64_t>(r.content_chars)
+        << close_document << "$unset" << open_document << "content" << ""
+        << "content_blob" << "" << "content_offset" << "" << "content_length"
+        << "" << close_document;
+  } else {
+    set << "content" << r.content << close_document << "$unset"
+        << open_document << "content_blob" << "" << "content_offset" << ""
+        << "content_length" << "" << "content_z" << "" << "content_dict"
+        << "" << "content_codec" << "" << "content_chars" << ""
+        << close_document;
+  }
+  const auto doc = update.extract();
+  return filter.view().length() + doc.view().length();
+}
+
+void run(benchmark::State &state, bool reuse) {
+  Chapter chapter;
+  fill(chapter, static_cast<Form>(state.range(0)),
+       static_cast<std::size_t>(state.range(1)));
+  SectionBson bson;
+  std::size_t i = 0;
+  std::size_t bytes = 0;
+  for (auto _ : state) {
+    const Record &r = chapter.records[i];
+    if (reuse) {
+      bson.encode(r);
+      bytes += bson.filter().length() + bson.update().length();
+    } else {
+      bytes += streamEncode(r);
+    }
+    benchmark::DoNotOptimize(bytes);
+    i = i + 1 == chapter.records.size() ? 0 : i + 1;
+  }
+  state.SetItemsProcessed(state.iterations());
+  state.SetBytesProcessed(static_cast<std::int64_t>(bytes));
+}
+
+void BM_SectionBson(benchmark::State &state) { run(state, true); }
+void BM_StreamBuilder(benchmark::State &state) { run(state, false); }
+
+// form (plain, ref, packed) x section content bytes
+void forms(benchmark::internal::Benchmark *b) {
+  b->ArgNames({"form", "bytes"});
+  for (int form : {kPlain, kRef, kPacked})
+    for (int bytes : {256, 1536, 8192})
+      b->Args({form, bytes});
+}
+
+} // namespace
+
+BENCHMARK(BM_SectionBson)->Apply(forms);
+BENCHMARK(BM_StreamBuilder)->Apply(forms);
+
+BENCHMARK_MAIN();
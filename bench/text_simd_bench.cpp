@@ -0,0 +1,233 @@
+// The TextSimd kernels over lines like those of chapter and TOC text. Built
+// twice: text_simd_bench with the SSE2 blocks, text_simd_bench_scalar with
+// BOOKSLICE_NO_SIMD, so the same runs compare the two paths. Each run first
+// checks the kernel against the <cctype> loop it replaced.
+#include <benchmark/benchmark.h>
+#include <cctype>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "text_simd.hpp"
+
+namespace {
+
+#if defined(__SSE2__) && !defined(BOOKSLICE_NO_SIMD)
+constexpr const char *kPath = "sse2";
+#else
+constexpr const char *kPath = "scalar";
+#endif
+
+constexpr std::size_t kCorpusBytes = 1 << 20;
+
+// Lines of 1..maxLen bytes: words in mixed case, digits, punctuation, runs
+// of spaces and tabs, and now and then a UTF-8 sequence. Seeded, so both
+// binaries see the same bytes.
+std::vector<std::string> corpus(std::size_t maxLen) {
+  static constexpr std::string_view kWords[] = {
+      "Chapter", "the",     "OF",  "Introduction", "1.2", "section",
+      "(cont.)", "Figure",  "42",  "appendix",     "and", "Notes—",
+      "résumé",  "—",       "TOC", "INDEX",        "...", "p."};
+  std::mt19937 rng(12345);
+  std::uniform_int_distribution<std::size_t> len(1, maxLen);
+  std::uniform_int_distribution<std::size_t> word(0, std::size(kWords) - 1);
+  std::uniform_int_distribution<int> gap(0, 9);
+
+  std::vector<std::string> lines;
+  std::size_t total = 0;
+  while (total < kCorpusBytes) {
+    const std::size_t n = len(rng);
+    std::string line;
+    while (line.size() < n) {
+      line += kWords[word(rng)];
+      const int g = gap(rng);
+      line += g == 0 ? "   " : g == 1 ? "\t" : " ";
+    }
+    line.resize(n);
+    total += line.size();
+    lines.push_back(std::move(line));
+  }
+  return lines;
+}
+
+std::size_t bytes(const std::vector<std::string> &lines) {
+  std::size_t n = 0;
+  for (const auto &l : lines)
+    n += l.size();
+  return n;
+}
+
+// ───── <cctype> reference ───────────────────────────────────────────────────
+
+std::string refLower(std::string s) {
+  for (auto &c : s)
+    c = static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+  return s;
+}
+
+std::string refLowerAlnum(const std::string &s) {
+  std::string out;
+  for (unsigned char c : s)
+    if (std::isalnum(c))
+      out.push_back(static_cast<char>(std::tolower(c)));
+  return out;
+}
+
+std::string refCollapse(const std::string &s) {
+  std::string out;
+  bool inSpace = false;
+  for (unsigned char c : s) {
+    if (std::isspace(c)) {
+      inSpace = true;
+      continue;
+    }
+    if (inSpace && !out.empty())
+      out.push_back(' ');
+    out.push_back(static_cast<char>(c));
+    inSpace = false;
+  }
+  return out;
+}
+
+bool refHasLetters(const std::string &s) {
+  for (unsigned char c : s)
+    if (std::isalpha(c))
+      return true;
+  return false;
+}
+
+std::pair<int, int> refCount(const std::string &s) {
+  int letters = 0, uppers = 0;
+  for (unsigned char c : s) {
+    letters += std::isalpha(c) != 0;
+    uppers += std::isupper(c) != 0;
+  }
+  return {letters, uppers};
+}
+
+// ───── Benchmarks ───────────────────────────────────────────────────────────
+
+// false (and the run skipped) if kernel and reference disagree on a line
+template <class Same>
+bool verified(benchmark::State &state, const std::vector<std::string> &lines,
+              Same same) {
+  for (const auto &line : lines)
+    if (!same(line)) {
+      state.SkipWithError("kernel differs from the <cctype> reference");
+      return false;
+    }
+  return true;
+}
+
+void finish(benchmark::State &state, const std::vector<std::string> &lines) {
+  state.SetBytesProcessed(static_cast<std::int64_t>(state.iterations()) *
+                          static_cast<std::int64_t>(bytes(lines)));
+  state.SetLabel(kPath);
+}
+
+// in place, so every iteration starts again from the mixed-case lines
+void BM_toLower(benchmark::State &state) {
+  const auto mixed = corpus(static_cast<std::size_t>(state.range(0)));
+  if (!verified(state, mixed, [](const std::string &l) {
+        std::string s = l;
+        TextSimd::toLower(s.data(), s.size());
+        return s == refLower(l);
+      }))
+    return;
+  auto lines = mixed;
+  for (auto _ : state) {
+    for (auto &line : lines) {
+      TextSimd::toLower(line.data(), line.size());
+      benchmark::DoNotOptimize(line.data());
+    }
+    state.PauseTiming();
+    lines = mixed;
+    state.ResumeTiming();
+  }
+  finish(state, lines);
+}
+
+void BM_lowerAlnum(benchmark::State &state) {
+  const auto lines = corpus(static_cast<std::size_t>(state.range(0)));
+  std::string out;
+  auto run = [&](const std::string &l) {
+    out.resize(l.size());
+    out.resize(TextSimd::lowerAlnum(l.data(), l.size(), out.data()));
+    return out;
+  };
+  if (!verified(state, lines, [&](const std::string &l) {
+        return run(l) == refLowerAlnum(l);
+      }))
+    return;
+  for (auto _ : state)
+    for (const auto &line : lines)
+      benchmark::DoNotOptimize(run(line).size());
+  finish(state, lines);
+}
+
+void BM_collapseWhitespace(benchmark::State &state) {
+  const auto lines = corpus(static_cast<std::size_t>(state.range(0)));
+  std::string out;
+  auto run = [&](const std::string &l) {
+    out.resize(l.size());
+    out.resize(TextSimd::collapseWhitespace(l.data(), l.size(), out.data()));
+    return out;
+  };
+  if (!verified(state, lines, [&](const std::string &l) {
+        return run(l) == refCollapse(l);
+      }))
+    return;
+  for (auto _ : state)
+    for (const auto &line : lines)
+      benchmark::DoNotOptimize(run(line).size());
+  finish(state, lines);
+}
+
+// worst case: lines without letters are scanned to the end
+void BM_hasLetters(benchmark::State &state) {
+  auto lines = corpus(static_cast<std::size_t>(state.range(0)));
+  for (auto &line : lines)
+    for (auto &c : line)
+      if (std::isalpha(static_cast<unsigned char>(c)))
+        c = '.';
+  if (!verified(state, lines, [](const std::string &l) {
+        return TextSimd::hasLetters(l.data(), l.size()) == refHasLetters(l);
+      }))
+    return;
+  for (auto _ : state)
+    for (const auto &line : lines)
+      benchmark::DoNotOptimize(TextSimd::hasLetters(line.data(), line.size()));
+  finish(state, lines);
+}
+
+void BM_countLetters(benchmark::State &state) {
+  const auto lines = corpus(static_cast<std::size_t>(state.range(0)));
+  if (!verified(state, lines, [](const std::string &l) {
+        int letters = 0, uppers = 0;
+        TextSimd::countLetters(l.data(), l.size(), letters, uppers);
+        return std::pair{letters, uppers} == refCount(l);
+      }))
+    return;
+  int letters = 0, uppers = 0;
+  for (auto _ : state)
+    for (const auto &line : lines) {
+      TextSimd::countLetters(line.data(), line.size(), letters, uppers);
+      benchmark::DoNotOptimize(letters + uppers);
+    }
+  finish(state, lines);
+}
+
+// longest line: TOC entries, body lines, whole paragraphs
+void lineLengths(benchmark::internal::Benchmark *b) {
+  b->ArgName("maxLen")->Arg(32)->Arg(80)->Arg(512);
+}
+
+} // namespace
+
+BENCHMARK(BM_toLower)->Apply(lineLengths);
+BENCHMARK(BM_lowerAlnum)->Apply(lineLengths);
+BENCHMARK(BM_collapseWhitespace)->Apply(lineLengths);
+BENCHMARK(BM_hasLetters)->Apply(lineLengths);
+BENCHMARK(BM_countLetters)->Apply(lineLengths);
+
+BENCHMARK_MAIN();
@@ -0,0 +1,65 @@
+#pragma once
+#include <algorithm>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+// Multi-producer, multi-consumer FIFO holding at most `capacity` items.
+// push() blocks while the queue is full, which holds producers back to the
+// pace of consumers. After close(), push() refuses new items and pop()
+// drains what is left, then returns nullopt.
+template <class T> class BoundedQueue {
+public:
+  explicit BoundedQueue(std::size_t capacity)
+      : capacity_(std::max<std::size_t>(capacity, 1)) {}
+
+  BoundedQueue(const BoundedQueue &) = delete;
+  BoundedQueue &operator=(const BoundedQueue &) = delete;
+
+  // false if the queue was closed; the item is dropped
+  bool push(T item) {
+    std::unique_lock lock(m_);
+    notFull_.wait(lock, [&] { return closed_ || items_.size() < capacity_; });
+    if (closed_)
+      return false;
+    items_.push_back(std::move(item));
+    lock.unlock();
+    notEmpty_.notify_one();
+    return true;
+  }
+
+  // nullopt once the queue is closed and empty
+  std::optional<T> pop() {
+    std::unique_lock lock(m_);
+    notEmpty_.wait(lock, [&] { return closed_ || !items_.empty(); });
+    if (items_.empty())
+      return std::nullopt;
+    T item = std::move(items_.front());
+    items_.pop_front();
+    lock.unlock();
+    notFull_.notify_one();
+    return item;
+  }
+
+  void close() {
+    {
+      std::lock_guard lock(m_);
+      closed_ = true;
+    }
+    notFull_.notify_all();
+    notEmpty_.notify_all();
+  }
+
+  std::size_t capacity() const noexcept { return capacity_; }
+
+private:
+  std::mutex m_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+  std::deque<T> items_;
+  const std::size_t capacity_;
+  bool closed_ = false;
+};
@@ -0,0 +1,85 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <map>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Named blobs in one append-only file, so a book's stage outputs need one
+// file instead of three directories of small ones. Blobs are written after
+// the existing data; commit() appends an index (name, offset, size, hash)
+// and a fixed trailer pointing at it, and the last trailer wins. A blob put
+// again with the same bytes is not rewritten, and names whose bytes are
+// identical share one copy of them; replaced or erased blobs
+// leave garbage that commit() reclaims by rewriting the file once it
+// outweighs the live data. Any blob is read with a single pread. Blobs put
+// but never committed, as after a crash or an early return, are dropped
+// when the file is next opened. An existing file that does not start like a
+// bundle is refused, never overwritten. The open bundle holds an exclusive
+// flock, so a second process (or a second Bundle on the same path) gets an
+// invalid object instead of appending alongside.
+//
+// Durability costs throughput. Every commit() calls fdatasync twice, once so
+// the blobs are on disk before a trailer vouches for them and once so the
+// trailer is on disk before commit() returns, and it writes the whole index
+// again. That is what lets a crash lose only uncommitted writes. run_bundle
+// commits once per run, so a book pays two syncs and one index. A caller
+// that commits after every stage or chapter pays them each time, and on
+// small books the run then waits on the disk rather than the CPU. Batch
+// puts into as few commits as the caller can afford to lose.
+class Bundle {
+public:
+  explicit Bundle(std::filesystem::path path) noexcept;
+  ~Bundle();
+
+  Bundle(const Bundle &) = delete;
+  Bundle &operator=(const Bundle &) = delete;
+
+  bool isValid() const noexcept { return fd_ >= 0; }
+  const std::filesystem::path &path() const noexcept { return path_; }
+
+  bool contains(std::string_view name) const {
+    return index_.find(name) != index_.end();
+  }
+  std::optional<std::string> read(std::string_view name) const;
+  // names starting with prefix, sorted
+  std::vector<std::string> list(std::string_view prefix) const;
+
+  bool put(std::string_view name, std::string_view bytes);
+  void remove(std::string_view name);
+  // drops every blob whose name starts with prefix
+  void clear(std::string_view prefix);
+  bool commit();
+
+  // bytes still referenced, counting shared blobs once
+  std::uint64_t liveBytes() const;
+  std::uint64_t fileBytes() const noexcept { return end_; }
+
+private:
+  struct Entry {
+    std::uint64_t offset{};
+    std::uint64_t size{};
+    std::uint64_t hash{};
+  };
+
+  bool load();
+  // the index of the trailer ending at committed
+  bool readIndex(std::uint64_t committed);
+  // cuts off what a run wrote after its last commit
+  bool truncateTo(std::uint64_t committed, std::uint64_t size);
+  bool compact();
+  // an entry already holding exactly these bytes
+  const Entry *find(std::string_view bytes, std::uint64_t hash) const;
+
+  std::filesystem::path path_;
+  int fd_ = -1;
+  std::uint64_t end_ = 0; // where the next blob goes
+  std::map<std::string, Entry, std::less<>> index_;
+  // one stored copy per content hash, for put() to share; may name bytes
+  // no blob uses any more, which are still in the file until compact()
+  std::unordered_map<std::uint64_t, Entry> byHash_;
+  bool dirty_ = false;
+};
@@ -3,29 +3,56 @@
 #include <mupdf/fitz/context.h>
 #include <mupdf/fitz/types.h>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "pdf/page_text.hpp"
+#include "pdf/paged_text.hpp"
 #include "types.hpp"
 
+class PagePool;
+
+// bump whenever the same outline can yield different chapter files
+inline constexpr std::string_view kChapterVersion = "chapters/1";
+
 std::vector<ChapterInfo> computeChapters(const std::vector<Outline> &outline,
                                          int totalPages);
 
-// get text from pdf
+// Chapter text for the in-memory pipeline. `file` is the name the on-disk
+// pipeline would use ("NN_slug.txt"); chapter keys are derived from it.
+struct ChapterText {
+  std::string file;
+  PagedText body;
+};
+
+// "NN_slug.txt" for the i-th chapter (0-based)
+std::string chapterFileName(std::size_t i, const ChapterInfo &ch);
+
+// get text from pdf; pages found in the cache are not loaded again.
+// With layout on, pages go through structured text and keep line typography.
 class ChapterReader {
 public:
-  ChapterReader(fz_context *ctx, fz_document *doc) noexcept
-      : ctx_(ctx), doc_(doc) {
+  ChapterReader(fz_context *ctx, fz_document *doc,
+                PageReadOptions opts = {}) noexcept
+      : ctx_(ctx), doc_(doc), opts_(opts) {
     assert(ctx_ && doc_);
   }
-  std::string text(const ChapterInfo &chapter) const;
+  PagedText text(const ChapterInfo &chapter) const;
   fz_context *ctx() const noexcept { return ctx_; }
   fz_document *doc() const noexcept { return doc_; }
 
 private:
   fz_context *ctx_ = nullptr;
   fz_document *doc_ = nullptr;
+  PageReadOptions opts_;
 };
 
+// whole chapters in memory, for the in-memory pipeline
+std::vector<ChapterText> readChapters(const ChapterReader &reader,
+                                      const std::vector<ChapterInfo> &chapters);
+std::vector<ChapterText> readChapters(const PagePool &pool,
+                                      const std::vector<ChapterInfo> &chapters);
+
 // where to put text
 class ChapterWriter {
 public:
@@ -33,8 +60,14 @@ public:
 
   std::size_t writeAll(const ChapterReader &reader,
                        const std::vector<ChapterInfo> &chapters) const;
+  // Same output as the serial overload; pages are extracted by the pool.
+  std::size_t writeAll(const PagePool &pool,
+                       const std::vector<ChapterInfo> &chapters) const;
+  std::size_t write(const std::vector<ChapterText> &texts) const;
   const std::string &dir() const noexcept { return dir_; }
 
 private:
+  bool writeOne(const std::string &file, const PagedText &body) const;
+
   std::string dir_;
 };
@@ -0,0 +1,33 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+
+struct CliOptions {
+  std::filesystem::path pdfPath;
+  unsigned threads{1}; // page-extraction workers; 0 = all cores
+  std::filesystem::path cacheDir; // page-text cache; empty = disabled
+  bool inMemory{false}; // pass stage outputs in memory, not via directories
+  bool dump{false};     // with inMemory: still write the intermediate files
+  bool headings{false}; // font-metric heading detection (implies inMemory)
+  int fuzzy{0};         // edit budget for approximate TOC matching
+  std::filesystem::path batchDir; // batch: every *.pdf in this directory
+  std::filesystem::path manifest; // batch: one PDF path per line
+  unsigned workers{0};            // batch: books in flight; 0 = all cores
+  unsigned memBudgetMb{0};        // peak RSS for extraction; 0 = unbounded
+  bool mmap{false};               // open PDFs through a prefetched mmap
+  bool force{false};              // rerun every stage, ignore the manifest
+  bool prettyJson{false};         // indent the segment JSON files
+  std::filesystem::path arrowPath; // sections as Arrow IPC; empty = off
+  std::filesystem::path bundlePath; // stage outputs in one file, not dirs
+  bool sectionRefs{false}; // sections as byte ranges of the chapter text
+  bool compress{false};    // section content packed with a book dictionary
+  bool retrainDict{false}; // with compress: replace the book's dictionary
+  unsigned ingestWriters{0}; // concurrent Mongo writers; 0 = one, in sequence
+
+  bool batch() const noexcept { return !batchDir.empty() || !manifest.empty(); }
+};
+
+// Parses `bookslice [options] [book.pdf]`. Returns nullopt on bad usage.
+std::optional<CliOptions> parseCli(int argc, char **argv);
+
+void printUsage(const char *argv0);
@@ -0,0 +1,97 @@
+#pragma once
+#include <cstddef>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+#ifdef BOOKSLICE_HAVE_ZSTD
+#include <zstd.h>
+#endif
+
+#include "handle.hpp"
+#include "types.hpp"
+
+#ifdef BOOKSLICE_HAVE_ZSTD
+struct CDictDrop {
+  void operator()(ZSTD_CDict *d) const noexcept { ZSTD_freeCDict(d); }
+};
+struct DDictDrop {
+  void operator()(ZSTD_DDict *d) const noexcept { ZSTD_freeDDict(d); }
+};
+struct CCtxDrop {
+  void operator()(ZSTD_CCtx *c) const noexcept { ZSTD_freeCCtx(c); }
+};
+struct DCtxDrop {
+  void operator()(ZSTD_DCtx *c) const noexcept { ZSTD_freeDCtx(c); }
+};
+#endif
+
+// Section content compressed with a zstd dictionary trained on its book.
+// Sections are short, so plain zstd finds little to work with; a dictionary
+// built from the book's own chapter texts, which every section is cut from,
+// holds its vocabulary and recurring phrases. The dictionary is stored once
+// per book under id(), and every packed row names it.
+// pack() and unpack() may be called from several threads.
+// Built without zstd (BOOKSLICE_HAVE_ZSTD unset), no codec is ever valid.
+class ContentCodec {
+public:
+  // layout of packed content, stored with every packed row
+  static constexpr int kVersion = 1;
+  // bump when train() makes different dictionaries; books keep theirs
+  // until then (see bookCodec)
+  static constexpr int kTrainVersion = 1;
+#ifdef BOOKSLICE_HAVE_ZSTD
+  static constexpr bool kAvailable = true;
+#else
+  static constexpr bool kAvailable = false;
+#endif
+
+  // Most bytes unpack() allocates for a section, whatever its frame
+  // claims; pack() leaves longer content unpacked.
+  static constexpr std::size_t kMaxContentBytes = std::size_t{64} << 20;
+
+  struct Config {
+    std::size_t dictBytes{32 << 10}; // upper bound; small books get less
+    int level{9};
+  };
+
+  // A dictionary from train() or one stored earlier.
+  explicit ContentCodec(std::string dict, Config cfg);
+  explicit ContentCodec(std::string dict)
+      : ContentCodec(std::move(dict), Config{}) {}
+
+  // Dictionary bytes for a book; empty if its text is too short to train on.
+  static std::string train(const std::vector<std::string_view> &texts,
+                           Config cfg);
+  static std::string train(const std::vector<std::string_view> &texts) {
+    return train(texts, Config{});
+  }
+
+#ifdef BOOKSLICE_HAVE_ZSTD
+  bool isValid() const noexcept { return cdict_ && ddict_; }
+#else
+  bool isValid() const noexcept { return false; }
+#endif
+  // content id of the dictionary (see ContentStore::id)
+  const std::string &id() const noexcept { return id_; }
+  const std::string &dictionary() const noexcept { return dict_; }
+
+  // nullopt if content cannot be packed (compression failed, or it is
+  // longer than unpack() would accept); the caller stores it as it is
+  std::optional<PackedContent> pack(std::string_view content) const;
+  // nullopt if the frame is corrupt, was packed with another dictionary, or
+  // claims more than 4 bytes per recorded code point or kMaxContentBytes
+  std::optional<std::string> unpack(const PackedContent &packed) const;
+
+private:
+  std::string dict_;
+  std::string id_;
+#ifdef BOOKSLICE_HAVE_ZSTD
+  Handle<ZSTD_CDict, CDictDrop> cdict_;
+  Handle<ZSTD_DDict, DDictDrop> ddict_;
+  mutable std::mutex m_;
+  Handle<ZSTD_CCtx, CCtxDrop> cctx_;
+  Handle<ZSTD_DCtx, DCtxDrop> dctx_;
+#endif
+};
@@ -0,0 +1,56 @@
+#pragma once
+#include <filesystem>
+#include <optional>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "types.hpp"
+
+class Bundle;
+
+// Chapter texts kept once and addressed by content, in a directory
+// (<dir>/<id>.txt) or a bundle ("blobs/<id>"). Sections stored by reference
+// name a blob and a byte range of it instead of carrying their own copy.
+// Blobs nothing refers to any more are dropped with prune().
+class ContentStore {
+public:
+  static constexpr std::string_view kBundlePrefix = "blobs/";
+
+  explicit ContentStore(std::filesystem::path dir) noexcept
+      : dir_(std::move(dir)) {}
+  explicit ContentStore(Bundle &bundle) noexcept : bundle_(&bundle) {}
+
+  // FNV-1a of the bytes and their length
+  static std::string id(std::string_view text);
+  // the same from a hash already taken (Hash::file) and the length
+  static std::string id(std::uint64_t fnv1a, std::uint64_t size);
+
+  // Stores text under id(text) unless it is there already. A bundle keeps
+  // one copy of identical bytes, so a chapter already stored there costs
+  // nothing more. In a directory, source names a file holding text (the
+  // chapter file): the blob becomes a hard link to it, and is copied only
+  // where links are not possible. Whoever rewrites source must replace the
+  // file (as FileIO::writeText does), never write into it.
+  bool put(std::string_view text, const std::filesystem::path &source = {});
+  std::optional<std::string> get(std::string_view id) const;
+
+  // The section's text, read on demand; empty if the blob is missing or
+  // too short.
+  std::optional<std::string> resolve(const SectionRef &ref) const;
+
+  // Removes every blob whose id is not in keep; returns how many went.
+  std::size_t prune(const std::set<std::string> &keep);
+
+private:
+  std::filesystem::path path(std::string_view id) const {
+    return dir_ / (std::string(id) + ".txt");
+  }
+
+  std::filesystem::path dir_;
+  Bundle *bundle_ = nullptr;
+};
+
+// Byte range of text a reference points at; empty if out of range.
+std::optional<std::string_view> sectionText(std::string_view text,
+                                            const SectionRef &ref);
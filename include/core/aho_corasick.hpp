@@ -0,0 +1,44 @@
+#pragma once
+#include <array>
+#include <string>
+#include <vector>
+
+// Aho-Corasick automaton over bytes, built once for a set of patterns.
+// Feed text one byte at a time with next(); forEachMatch() reports every
+// pattern that ends at the current position. Transitions form a full DFA
+// over the byte classes that occur in the patterns, so a step is one table
+// lookup and never allocates.
+class AhoCorasick {
+public:
+  static constexpr int kRoot = 0;
+
+  explicit AhoCorasick(const std::vector<std::string> &patterns);
+
+  int next(int state, unsigned char c) const noexcept {
+    return delta_[static_cast<std::size_t>(state) * classes_ + class_[c]];
+  }
+
+  // fn(patternIndex) for each pattern that is a suffix of the text so far
+  template <class Fn> void forEachMatch(int state, Fn &&fn) const {
+    if (out_[state].empty())
+      state = dict_[state];
+    for (; state != kRoot; state = dict_[state])
+      for (int p : out_[state])
+        fn(p);
+  }
+
+  // some pattern is a suffix of the text so far
+  bool hasMatch(int state) const noexcept {
+    return !out_[state].empty() || dict_[state] != kRoot;
+  }
+
+  bool empty() const noexcept { return patterns_ == 0; }
+
+private:
+  std::array<int, 256> class_{}; // byte -> class; 0 = not in any pattern
+  int classes_ = 1;
+  std::vector<int> delta_;            // state * classes_ + class -> state
+  std::vector<std::vector<int>> out_; // patterns ending exactly here
+  std::vector<int> dict_;             // nearest proper suffix with output
+  std::size_t patterns_ = 0;
+};
@@ -0,0 +1,42 @@
+#pragma once
+#include <array>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Approximate substring search with Myers' bit-parallel edit distance
+// (Hyyrö's formulation), run on four patterns at once: each step updates
+// four independent 64-bit lanes, which compilers turn into SIMD.
+// Patterns longer than 64 bytes are not searched (callers keep their exact
+// result). Haystack lines are compared in Text::collapseWhitespace form.
+class ApproxMatcher {
+public:
+  static constexpr std::size_t kMaxPattern = 64;
+  static constexpr std::size_t kLanes = 4;
+
+  // maxErrors[i] is the edit budget of patterns[i]
+  ApproxMatcher(const std::vector<std::string> &patterns,
+                const std::vector<int> &maxErrors);
+
+  // first[i] holds pattern i's exact first line (-1 if none) and is lowered
+  // to the first line that matches within the budget. Lines are visited in
+  // order, or only those in candidates (ascending) when given.
+  void firstLines(const std::vector<std::string_view> &lines,
+                  const std::vector<int> *candidates,
+                  std::vector<int> &first) const;
+
+private:
+  struct Group {
+    std::array<int, kLanes> pattern{-1, -1, -1, -1};
+    std::array<std::uint64_t, kLanes> high{}; // bit m-1
+    std::array<int, kLanes> length{};
+    std::array<int, kLanes> budget{};
+    std::array<std::array<std::uint64_t, kLanes>, 256> peq{};
+  };
+
+  // lanes (bit l) that match somewhere in text; only active lanes count
+  static unsigned scan(const Group &g, std::string_view text, unsigned active);
+
+  std::vector<Group> groups_;
+};
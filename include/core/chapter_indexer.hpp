@@ -1,18 +1,23 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "core/trigram_index.hpp"
 #include "types.hpp"
 
 class ChapterIndex {
 public:
+  // bump whenever the same TOC can yield different positions
+  static constexpr std::string_view kVersion = "chapter-index/1";
+
   std::vector<int> indexChapters(const std::vector<std::string> &tocLines,
                                  const std::vector<ChapterMatch> &files,
                                  int startFrom = 0) const;
 
 private:
-  int findFirstTocMatch(const std::vector<std::string> &tocLines,
-                        const std::string &key, int startAt) const;
+  int findFirstTocMatch(const TrigramIndex &toc, const std::string &key,
+                        int startAt) const;
 
   static std::string stripLeadingThe(const std::string &key);
 };
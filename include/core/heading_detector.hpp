@@ -0,0 +1,31 @@
+#pragma once
+#include <optional>
+#include <string_view>
+#include <vector>
+
+#include "types.hpp"
+
+// Marks chapter lines that look like headings from their typography:
+// noticeably larger than the chapter's body text, or bold at body size.
+// The body size is the glyph size that covers the most glyphs.
+class HeadingDetector {
+public:
+  struct Config {
+    float sizeRatio{1.15f}; // heading size >= body size * ratio
+    std::size_t maxChars{120};
+  };
+
+  HeadingDetector() = default;
+  explicit HeadingDetector(Config cfg) : cfg_(cfg) {}
+
+  // Indices into chapterLines, ascending. Empty when nothing qualifies.
+  std::vector<int>
+  candidates(const std::vector<std::string_view> &chapterLines,
+             const std::vector<std::optional<PageLayout>> &layouts) const;
+
+  float bodySize(const std::vector<std::optional<PageLayout>> &layouts) const;
+  bool isHeading(const LineStyle &line, float bodySize) const noexcept;
+
+private:
+  Config cfg_{};
+};
@@ -1,21 +1,53 @@
 #pragma once
 #include <string>
+#include <string_view>
 #include <utility>
 #include <vector>
 
+// Pairs each TOC line with the first chapter line that contains it
+// (Title::isSubtitleMatch semantics: leading "The " dropped, whitespace runs
+// collapsed on both sides, case-sensitive).
+// With maxErrors > 0, a line also counts if it contains the TOC line within
+// an edit budget of min(maxErrors, length / charsPerError), which absorbs
+// ligature breaks, hyphenation and OCR typos (see ApproxMatcher).
 class Matcher {
 public:
+  // bump whenever the same lines can yield different matches
+  static constexpr std::string_view kVersion = "matcher/1";
+
+  struct Config {
+    int maxErrors{0}; // 0 = exact matching only
+    int charsPerError{8};
+  };
+
+  Matcher() = default;
+  explicit Matcher(Config cfg) : cfg_(cfg) {}
+
+  const Config &config() const noexcept { return cfg_; }
+
   std::vector<std::pair<int, int>>
   matchIndices(const std::vector<std::string> &tocLines,
-               const std::vector<std::string> &chapterLines,
+               const std::vector<std::string_view> &chapterLines,
                const std::string &chapterTitle) const;
 
-private:
-  bool skipLine(const std::string &line, const std::string &chapterTitle) const;
+  // Only the chapter lines listed in candidates (ascending) are tried.
+  std::vector<std::pair<int, int>>
+  matchIndices(const std::vector<std::string> &tocLines,
+               const std::vector<std::string_view> &chapterLines,
+               const std::string &chapterTitle,
+               const std::vector<int> &candidates) const;
 
-  int firstMatch(const std::vector<std::string> &chapterLines,
-                 const std::string &line) const;
+private:
+  // Both overloads: one automaton over every kept TOC line, one pass over
+  // the chapter (or over candidates only, when given).
+  std::vector<std::pair<int, int>>
+  match(const std::vector<std::string> &tocLines,
+        const std::vector<std::string_view> &chapterLines,
+        const std::string &chapterTitle,
+        const std::vector<int> *candidates) const;
 
   static bool byChapterLine(const std::pair<int, int> &a,
                             const std::pair<int, int> &b) noexcept;
+
+  Config cfg_{};
 };
@@ -0,0 +1,22 @@
+#pragma once
+#include <string>
+#include <string_view>
+
+#include "core/aho_corasick.hpp"
+
+// Whether a TOC line is noise for one chapter: it names the chapter itself,
+// holds a banned word, "()" or "//", has no letters, or is mostly upper
+// case. Built once per chapter and applied to every TOC line. The chapter
+// title and the banned words share one automaton, fed with the lower-cased,
+// whitespace-collapsed line while letter counts and "()"/"//" checks run in
+// the same pass. Classifying a line does not allocate.
+class NoiseFilter {
+public:
+  explicit NoiseFilter(const std::string &chapterTitle);
+
+  bool isNoisy(std::string_view line) const noexcept;
+
+private:
+  AhoCorasick words_;
+  bool everyLine_ = false; // an empty title is found in every line
+};
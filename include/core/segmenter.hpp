@@ -1,4 +1,5 @@
 #pragma once
+#include <string_view>
 #include <utility>
 #include <vector>
 
@@ -6,6 +7,9 @@
 
 class Segmenter {
 public:
+  // bump whenever the same matches can yield different sections
+  static constexpr std::string_view kVersion = "segmenter/1";
+
   std::vector<Section>
   buildSections(const std::vector<std::pair<int, int>> &matches, int totalLines,
                 int minGap) const;
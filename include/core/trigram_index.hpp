@@ -0,0 +1,45 @@
+#pragma once
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Inverted index from byte trigrams to the lines that contain them.
+// Substring lookups intersect the needle's posting lists and run find() only
+// on the surviving lines. Needles shorter than a trigram fall back to a
+// linear scan. Lines are copied in, so the index can outlive its input;
+// line numbers are positions in the vector it was built from.
+class TrigramIndex {
+public:
+  TrigramIndex() = default;
+  explicit TrigramIndex(std::vector<std::string> lines);
+
+  // First non-empty line at or after startAt that contains needle; -1 if none.
+  int findFirst(std::string_view needle, int startAt = 0) const;
+  // Every non-empty line that contains needle, ascending.
+  std::vector<int> findAll(std::string_view needle) const;
+
+  const std::string &line(int i) const { return lines_[i]; }
+  int size() const noexcept { return static_cast<int>(lines_.size()); }
+
+private:
+  static std::uint32_t trigram(std::string_view s, std::size_t i) noexcept {
+    return static_cast<std::uint32_t>(static_cast<unsigned char>(s[i])) << 16 |
+           static_cast<std::uint32_t>(static_cast<unsigned char>(s[i + 1]))
+               << 8 |
+           static_cast<unsigned char>(s[i + 2]);
+  }
+
+  bool matches(int i, std::string_view needle) const {
+    return !lines_[i].empty() && lines_[i].find(needle) != std::string::npos;
+  }
+
+  // Posting lists for needle's trigrams, shortest first; empty if one is
+  // missing entirely (no line can match).
+  std::vector<const std::vector<int> *> postings(std::string_view needle) const;
+  static bool inAll(const std::vector<const std::vector<int> *> &lists, int i);
+
+  std::vector<std::string> lines_;
+  std::unordered_map<std::uint32_t, std::vector<int>> postings_;
+};
@@ -0,0 +1,60 @@
+#pragma once
+#include <cstddef>
+#include <filesystem>
+#include <functional>
+#include <iosfwd>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "content_store.hpp"
+#include "db/repository.hpp"
+#include "pdf/metadata.hpp"
+
+// Ingests segment files on two sets of threads joined by a bounded queue.
+// Parsers read and parse the JSON files; writers turn each chapter's rows
+// into records and write them through a repository connection of their
+// own, skipping sections whose stored hash (fetched once for all writers)
+// matches. When the writers fall behind, the full queue stalls the parsers,
+// so at most queueDepth parsed chapters wait in memory.
+class ConcurrentIngestor {
+public:
+  struct Config {
+    unsigned parsers{2};
+    unsigned writers{4};
+    std::size_t queueDepth{16}; // parsed chapters waiting for a writer
+  };
+
+  struct Stats {
+    std::vector<std::filesystem::path> ingested; // files written, any order
+    std::size_t failed{}; // files not read or not completely written
+    std::size_t sections{};
+    std::size_t changed{}; // upserted or modified
+    double seconds{};      // wall time of the whole run
+    std::vector<double> latencies; // per write batch, milliseconds
+  };
+
+  // A repository on a connection of its own; called once per writer, on
+  // the calling thread, before any file is read. If it throws, the writers
+  // connected so far do the work. The first repository's ensure_ready()
+  // runs once, before the writers start.
+  using Connect = std::function<std::unique_ptr<Repository>()>;
+
+  ConcurrentIngestor(Connect connect, const ContentStore *blobs, Config cfg);
+  ConcurrentIngestor(Connect connect, const ContentStore *blobs)
+      : ConcurrentIngestor(std::move(connect), blobs, Config{}) {}
+
+  // chapters: the stems of every chapter the book has now, written or not;
+  // stored sections of other chapters are removed
+  Stats ingest(const std::vector<std::filesystem::path> &files,
+               const std::vector<std::string> &chapters,
+               const std::filesystem::path &pdfPath, const BookTitle &book);
+
+  // sections/s and the p50/p99/max latency of the bulk writes
+  static void report(const Stats &stats, std::ostream &os);
+
+private:
+  Connect connect_;
+  const ContentStore *blobs_;
+  Config cfg_;
+};
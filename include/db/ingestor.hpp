@@ -1,23 +1,107 @@
 #pragma once
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
 #include <utility>
+#include <vector>
 
+#include "content_codec.hpp"
+#include "content_store.hpp"
 #include "db/repository.hpp"
 #include "pdf/metadata.hpp"
+#include "types.hpp"
 
+// What ingesting one chapter did. ok is false if any of its sections could
+// not be written or removed, or the chapter could not be read at all; such
+// a chapter is ingested again on the next run.
+struct IngestCounts {
+  std::size_t changed{}; // sections upserted or modified
+  std::size_t total{};   // sections in the chapter
+  bool ok{true};
+  std::vector<double> batchMillis{}; // round trip of each write batch
+};
+
+// A section goes to the repository only if its Record::content_hash differs
+// from the stored one; the stored hashes are fetched once per book. Sections
+// and chapters the book no longer has are removed.
+// Rows stored by reference take their chapter text from the text passed
+// along or from the content store; it goes to the repository with the
+// chapter's changed sections. Packed rows are unpacked with the codec passed
+// along or with a dictionary from the content store; it goes to the
+// repository once. A repository that cannot keep texts or dictionaries gets
+// plain content.
 class Ingestor {
 public:
-  explicit Ingestor(Repository &repo);
+  // returned by ingest_directory / ingest_segments when a chapter failed
+  static constexpr int kIncomplete = 7;
+
+  explicit Ingestor(Repository &repo, const ContentStore *blobs = nullptr);
+
+  // the rows of a segments file; nullopt (reported) if it cannot be used
+  static std::optional<std::vector<SectionRow>>
+  read_rows(const std::filesystem::path &jsonPath);
 
-  std::pair<std::size_t, std::size_t>
+  IngestCounts
   ingest_chapter_file(const std::filesystem::path &jsonPath,
                       const std::filesystem::path &pdfPath,
                       const BookTitle &book);
 
+  // chapterFile is the segments file name ("NN_slug.json"); text is the
+  // chapter text referenced rows point into and codec the one that packed
+  // rows, if the caller has them
+  IngestCounts
+  ingest_rows(const std::string &chapterFile,
+              const std::vector<SectionRow> &rows,
+              const std::filesystem::path &pdfPath, const BookTitle &book,
+              std::string_view text = {}, const ContentCodec *codec = nullptr);
+
   int ingest_directory(const std::filesystem::path &outDir,
                        const std::filesystem::path &pdfPath,
                        const BookTitle &book);
 
+  // In-memory pipeline: same records as ingest_directory would produce.
+  int ingest_segments(const std::vector<ChapterSegments> &segments,
+                      const std::filesystem::path &pdfPath,
+                      const BookTitle &book);
+
+  // Removes the stored sections of the book's chapters that are not in
+  // chapters (file stems); returns how many went.
+  std::size_t removeMissingChapters(const BookTitle &book,
+                                    const std::vector<std::string> &chapters);
+
+  // Has the repository drop the texts and dictionaries no section names any
+  // more, if this ingestor rewrote or removed sections since the last call
+  // or wrote is set (by writers of their own); returns how many went.
+  std::size_t pruneTexts(bool wrote = false);
+
+  // Starts from section hashes fetched elsewhere instead of asking the
+  // repository for them.
+  void assumeStored(const std::string &book, SectionHashes hashes);
+
 private:
+  // what the repository holds for book: fetched once, then kept current as
+  // this ingestor writes; null if the repository cannot tell
+  const SectionHashes *stored(const std::string &book);
+  void remember(const std::vector<Record> &written, bool ok);
+  // titles empty = the whole chapter
+  void forget(const std::string &chapter,
+              const std::vector<std::string> &titles);
+
+  // the codec for a dictionary id: codec if it matches, else one loaded from
+  // the content store; null if neither has it
+  const ContentCodec *codecFor(const std::string &dict,
+                               const ContentCodec *codec);
+  // whether the repository holds the dictionary; asked once per id
+  bool storeDictionary(const ContentCodec &codec);
+
   Repository *repo_;
+  const ContentStore *blobs_;
+  std::unordered_map<std::string, std::unique_ptr<ContentCodec>> codecs_;
+  std::unordered_map<std::string, bool> dictStored_;
+  std::optional<std::string> storedBook_;
+  std::optional<SectionHashes> stored_;
+  bool rewrote_{false}; // since the last pruneTexts()
 };
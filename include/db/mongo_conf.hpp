@@ -1,8 +1,21 @@
 #pragma once
+#include <cstddef>
 #include <string>
 
 struct MongoConfig {
+  static constexpr int kMajority = -1;
+
   std::string uri{"mongodb://127.0.0.1:27017"};
   std::string db{"bookslice"};
   std::string coll{"sections"};
+  std::string texts{"chapter_texts"}; // texts sections point into
+  std::string dicts{"content_dicts"}; // dictionaries of packed content
+
+  // section upserts per bulk_write round trip
+  std::size_t batchSize{1000};
+  // write concern of bulk writes: acknowledged by w nodes, kMajority, or 0
+  // for unacknowledged (no counts come back)
+  int w{1};
+  bool journal{false};
+
 };
@@ -1,24 +1,51 @@
 #pragma once
+#include <memory>
 #include <mongocxx/client.hpp>
 #include <mongocxx/collection.hpp>
 #include <mongocxx/instance.hpp>
+#include <mongocxx/pool.hpp>
 #include <mongocxx/uri.hpp>
 
 #include "db/mongo_conf.hpp"
 #include "db/repository.hpp"
+#include "db/section_bson.hpp"
 
 class MongoRepository : public Repository {
 public:
   explicit MongoRepository(const MongoConfig &cfg = {});
+  // Holds a client taken from pool until destroyed, so each of several
+  // threads can write through a repository of its own. Indexes are left to
+  // one ensure_ready() call before the writers start.
+  MongoRepository(mongocxx::pool &pool, const MongoConfig &cfg);
   ~MongoRepository() override;
 
   void ensure_ready() override;
   bool upsert(const Record &rec) override;
+  std::vector<WriteCounts> upsertMany(std::span<const Record> recs) override;
+  bool putText(const std::string &id, std::string_view text) override;
+  bool putDictionary(const std::string &id, std::string_view dict) override;
+  std::optional<SectionHashes>
+  sectionHashes(const std::string &book_title) override;
+  std::size_t removeSections(const std::string &book_title,
+                             const std::string &chapter,
+                             std::span<const std::string> titles) override;
+  std::size_t pruneTexts() override;
+
+  // Connections for concurrent writers; the URI's maxPoolSize bounds how
+  // many are open at once. Constructing a repository on a pool with none
+  // left throws instead of waiting.
+  static std::unique_ptr<mongocxx::pool> makePool(const MongoConfig &cfg);
+  // maxPoolSize of cfg.uri, or the driver's default of 100
+  static unsigned maxPoolSize(const MongoConfig &cfg);
 
 private:
   static mongocxx::instance &driver();
 
   MongoConfig cfg_;
+  mongocxx::pool::entry pooled_; // empty unless made from a pool
   mongocxx::client client_;
   mongocxx::collection coll_;
+  mongocxx::collection texts_;
+  mongocxx::collection dicts_;
+  SectionBson bson_;
 };
@@ -1,7 +1,12 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <string_view>
 
-struct Record {
+// The book and chapter a section comes from. Every section of a chapter
+// has the same ones, so its records share a single copy.
+struct ChapterFields {
   std::string book_title;
   std::string book_title_src;
   std::string book_path;
@@ -9,10 +14,30 @@ struct Record {
   std::string chapter_file;
   std::string chapter;
   std::string chapter_title;
+};
+
+// One section as written to a repository. The string views point into the
+// rows and texts the record was built from, which must outlive it.
+struct Record {
+  std::shared_ptr<const ChapterFields> origin;
 
   int section_index{};
-  std::string title;
+  std::string_view title;
   int startline{};
   int endline{};
-  std::string content;
+  std::string_view content;
+  // by reference: content is empty and the section is bytes
+  // [content_offset, content_offset + content_length) of a stored text
+  std::string_view content_blob;
+  std::uint64_t content_offset{};
+  std::uint64_t content_length{};
+  // packed: content is empty and content_z is a zstd frame made with the
+  // dictionary content_dict, in layout content_codec (ContentCodec)
+  std::string_view content_z;
+  std::string_view content_dict;
+  int content_codec{};
+  std::uint64_t content_chars{};
+  // of every field above, stored with the section so an unchanged one need
+  // not be sent again (see Ingestor)
+  std::uint64_t content_hash{};
 };
@@ -1,12 +1,91 @@
 #pragma once
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <map>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
 #include "db/record.hpp"
 
+// What one write batch changed. Counts stay 0 when the write was not
+// acknowledged; failed counts the writes of the batch that did not happen.
+struct WriteCounts {
+  std::size_t upserted{};
+  std::size_t modified{};
+  std::size_t failed{};
+  double millis{}; // wall time of the batch's round trip
+};
+
+// Record::content_hash of a book's stored sections by (chapter, title)
+using SectionHashes =
+    std::map<std::pair<std::string, std::string>, std::uint64_t>;
+
 class Repository {
 public:
   virtual ~Repository() = default;
 
   virtual bool upsert(const Record &rec) = 0;
 
+  // Upserts recs in as few round trips as the repository allows and
+  // returns the counts of each batch. The default is one upsert() per
+  // record, counted as one batch; a write there counts as modified or, if
+  // upsert() returns false, as failed.
+  virtual std::vector<WriteCounts> upsertMany(std::span<const Record> recs) {
+    WriteCounts counts;
+    const auto start = std::chrono::steady_clock::now();
+    for (const auto &rec : recs)
+      ++(upsert(rec) ? counts.modified : counts.failed);
+    counts.millis = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    return {counts};
+  }
+
+  // Stores a text that records may reference by id (Record::content_blob).
+  // A repository that cannot gets records with their content inlined.
+  virtual bool putText(const std::string &id, std::string_view text) {
+    (void)id;
+    (void)text;
+    return false;
+  }
+
+  // Stores a compression dictionary that records may name
+  // (Record::content_dict). A repository that cannot gets plain content.
+  virtual bool putDictionary(const std::string &id, std::string_view dict) {
+    (void)id;
+    (void)dict;
+    return false;
+  }
+
+  // The sections stored for a book, in one query. nullopt if the
+  // repository cannot tell; then every section is written.
+  virtual std::optional<SectionHashes>
+  sectionHashes(const std::string &book_title) {
+    (void)book_title;
+    return std::nullopt;
+  }
+
+  // Removes the given sections of one chapter of a book, or all of the
+  // chapter's sections if titles is empty. Returns how many went.
+  virtual std::size_t removeSections(const std::string &book_title,
+                                     const std::string &chapter,
+                                     std::span<const std::string> titles) {
+    (void)book_title;
+    (void)chapter;
+    (void)titles;
+    return 0;
+  }
+
+  // Removes the stored texts and dictionaries that no section names any
+  // more; returns how many went. Only safe while no other writer is between
+  // putText() and the upsert of the sections naming it.
+  virtual std::size_t pruneTexts() { return 0; }
+
   // Optional hook to prepare indexes, etc.
   virtual void ensure_ready() {}
 };
@@ -0,0 +1,40 @@
+#pragma once
+#include <bsoncxx/builder/core.hpp>
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/types.hpp>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "db/record.hpp"
+
+// BinData (generic subtype) viewing bytes, which must outlive it
+inline bsoncxx::types::b_binary bsonBinary(std::string_view bytes) {
+  return {bsoncxx::binary_sub_type::k_binary,
+          static_cast<std::uint32_t>(bytes.size()),
+          reinterpret_cast<const std::uint8_t *>(bytes.data())};
+}
+
+// Encodes a record's upsert filter and update straight into BSON, with the
+// same builders reused from one record to the next so their buffers are
+// too. A chapter's fields (Record::origin) are encoded once and copied into
+// each of its updates as raw bytes. The views stay valid until the next
+// encode().
+class SectionBson {
+public:
+  void encode(const Record &r);
+
+  // the unique section key: book_title, chapter, title
+  bsoncxx::document::view filter() const { return filter_.view_document(); }
+  // $set of every field, $unset of the content forms not in use
+  bsoncxx::document::view update() const { return update_.view_document(); }
+
+private:
+  void encodeOrigin();
+
+  bsoncxx::builder::core filter_{false};
+  bsoncxx::builder::core update_{false};
+  bsoncxx::builder::core prefix_{false}; // the fields of origin_
+  // held so the address cannot be reused by another chapter's fields
+  std::shared_ptr<const ChapterFields> origin_;
+};
@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Streaming JSON emitter: values are escaped straight into a buffer that is
+// flushed to the stream in large blocks, so no DOM is ever built. Output is
+// compact unless pretty is set, which indents by 2 like nlohmann's
+// dump(2). Strings are escaped as nlohmann does; each invalid UTF-8
+// sequence becomes one U+FFFD, as with its replace error handler. Calls
+// must nest correctly; nothing is validated.
+class JsonWriter {
+public:
+  struct Config {
+    bool pretty{false};
+    std::size_t bufferBytes{std::size_t{1} << 16};
+  };
+
+  explicit JsonWriter(std::ostream &os) : JsonWriter(os, Config{}) {}
+  JsonWriter(std::ostream &os, Config cfg);
+  ~JsonWriter() { flush(); }
+
+  JsonWriter(const JsonWriter &) = delete;
+  JsonWriter &operator=(const JsonWriter &) = delete;
+
+  void beginArray() { open('['); }
+  void endArray() { close(']'); }
+  void beginObject() { open('{'); }
+  void endObject() { close('}'); }
+
+  void key(std::string_view k);
+  void value(std::string_view s);
+  void value(std::int64_t n);
+  void value(int n) { value(static_cast<std::int64_t>(n)); }
+
+  // hands the buffered bytes to the stream; also done by the destructor
+  void flush();
+
+  // appends s as a quoted JSON string
+  static void escape(std::string &out, std::string_view s);
+
+private:
+  void open(char bracket);
+  void close(char bracket);
+  void element(); // separator and indent before the next value
+  void maybeFlush() {
+    if (buf_.size() >= cfg_.bufferBytes)
+      flush();
+  }
+
+  std::ostream &os_;
+  Config cfg_;
+  std::string buf_;
+  std::vector<std::size_t> counts_; // values so far, per open container
+  bool afterKey_ = false;
+};
@@ -0,0 +1,51 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string_view>
+#include <vector>
+
+#include "handle.hpp"
+
+struct MunmapDrop {
+  std::size_t size{};
+  void operator()(char *p) const noexcept;
+};
+
+// Lines of a file (read-only mmap), split like
+// std::getline: on '\n', with no empty last line after a trailing newline.
+// Only a compact offsets array is allocated; lines and multi-line ranges
+// are views into the bytes, valid while the table lives.
+class LineTable {
+public:
+  LineTable() = default;
+  // logs and stays invalid when the file cannot be read
+  explicit LineTable(const std::filesystem::path &p);
+
+  bool isValid() const noexcept { return valid_; }
+  std::size_t size() const noexcept {
+    return offsets_.empty() ? 0 : offsets_.size() - 1;
+  }
+
+  std::string_view line(std::size_t i) const noexcept {
+    return {base() + offsets_[i], offsets_[i + 1] - offsets_[i] - 1};
+  }
+  // lines [first, last] with the '\n' between them, as one view
+  std::string_view range(std::size_t first, std::size_t last) const noexcept {
+    return {base() + offsets_[first],
+            offsets_[last + 1] - offsets_[first] - 1};
+  }
+  std::vector<std::string_view> views() const;
+  // the whole file
+  std::string_view bytes() const noexcept { return {base(), bytes_}; }
+
+private:
+  const char *base() const noexcept { return map_.get(); }
+  void index(std::size_t bytes);
+
+  Handle<char, MunmapDrop> map_;
+  // offsets_[i] = first byte of line i; offsets_[size()] = end + 1, as if
+  // the last line had a '\n'
+  std::vector<std::uint32_t> offsets_;
+  std::size_t bytes_ = 0;
+  bool valid_ = false;
+};
@@ -0,0 +1,13 @@
+#pragma once
+#include <mupdf/fitz.h>
+#include <string>
+
+// fz_stream over a read-only mmap of the whole file, for storage where each
+// read() is a round trip. The kernel is asked to prefetch the file up front
+// (MADV_WILLNEED), so MuPDF's scattered xref and object reads hit the page
+// cache instead of issuing one small read each.
+//
+// Returns nullptr (after logging) if the file cannot be mapped; the caller
+// falls back to fz_open_document. May throw a MuPDF exception, so call it
+// inside fz_try. The stream owns the mapping.
+fz_stream *openMappedStream(fz_context *ctx, const std::string &path);
@@ -0,0 +1,88 @@
+#pragma once
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <mupdf/fitz.h>
+#include <mutex>
+
+// Process-wide memory budget for extraction.
+// Half of the peak goes to the MuPDF store (PdfSession's max_store); the
+// rest is headroom for page objects and extracted text. Readers call
+// admit()/done() around each page: over the peak, the store is emptied and
+// further pages wait until RSS falls back, while at least one page is always
+// allowed through so extraction cannot stall. A single reader (the serial
+// path) is that one page, so it never waits: the budget only trims the store
+// for it.
+// The store is emptied once per excursion over the peak, and again only if
+// RSS keeps climbing by another step or after it fell below the low-water
+// mark; emptying it on every page would throw away the fonts and images the
+// next page needs.
+class MemoryBudget {
+public:
+  explicit MemoryBudget(std::size_t peakBytes) noexcept : peak_(peakBytes) {}
+
+  std::size_t peak() const noexcept { return peak_; }
+  std::size_t storeBytes() const noexcept { return peak_ / 2; }
+  // RSS under which the next excursion over the peak empties the store
+  std::size_t lowWater() const noexcept { return peak_ - peak_ / 8; }
+
+  void admit(fz_context *ctx);
+  void done() noexcept;
+
+  // Largest RSS seen by admit()/sample().
+  std::size_t highWater() const noexcept { return highWater_.load(); }
+  std::size_t sample() noexcept;
+
+  static std::size_t currentRss() noexcept;
+
+private:
+  bool over(fz_context *ctx);
+
+  std::size_t peak_;
+  std::atomic<std::size_t> highWater_{0};
+  std::mutex m_;
+  std::condition_variable cv_;
+  int inFlight_ = 0;
+  // under m_: RSS right after the store was last emptied, 0 once re-armed
+  std::size_t trimmedAt_ = 0;
+};
+
+// Largest RSS sampled while one book's pages were read. RSS belongs to the
+// process, so with several books in flight this is an upper bound on the
+// book's share rather than a measurement of it.
+class RssPeak {
+public:
+  void note(std::size_t rss) noexcept {
+    std::size_t seen = bytes_.load();
+    while (rss > seen && !bytes_.compare_exchange_weak(seen, rss)) {
+    }
+  }
+  std::size_t bytes() const noexcept { return bytes_.load(); }
+
+private:
+  std::atomic<std::size_t> bytes_{0};
+};
+
+// admit()/done() pair for one page; with a peak, the RSS once the page is
+// read is noted there
+class BudgetTicket {
+public:
+  BudgetTicket(MemoryBudget *budget, fz_context *ctx, RssPeak *peak = nullptr)
+      : budget_(budget), peak_(peak) {
+    if (budget_)
+      budget_->admit(ctx);
+  }
+  ~BudgetTicket() noexcept {
+    if (!budget_)
+      return;
+    if (peak_)
+      peak_->note(budget_->sample());
+    budget_->done();
+  }
+  BudgetTicket(const BudgetTicket &) = delete;
+  BudgetTicket &operator=(const BudgetTicket &) = delete;
+
+private:
+  MemoryBudget *budget_;
+  RssPeak *peak_;
+};
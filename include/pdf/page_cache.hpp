@@ -0,0 +1,58 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// On-disk cache of extracted page text.
+// One cache per (PDF content hash, extraction options) pair:
+//   <dir>/<pdf-hash>-<opts-hash>.idx   fixed-size slot per page
+//   <dir>/<pdf-hash>-<opts-hash>.dat   page text, append-only
+// A page lookup is one slot read; a warm cache never calls into MuPDF.
+// The options include the MuPDF version (kPageTextOptions), so cached text
+// and failures are dropped when MuPDF changes.
+class PageCache {
+public:
+  enum class State : std::uint32_t { Missing = 0, Ok = 1, Failed = 2 };
+
+  PageCache(std::filesystem::path dir, const std::filesystem::path &pdfPath,
+            int pageCount, std::string_view options);
+  ~PageCache() noexcept; // flushes pending pages
+
+  PageCache(const PageCache &) = delete;
+  PageCache &operator=(const PageCache &) = delete;
+
+  bool isValid() const noexcept { return !index_.empty(); }
+  State state(int page) const noexcept;
+  std::string_view text(int page) const noexcept; // empty unless State::Ok
+
+  void put(int page, std::string_view text);
+  // For pages that fail the same way on every try (permanentError()); a
+  // transient failure is left Missing so the next run tries again.
+  void putFailed(int page);
+  bool flush();
+
+  std::size_t hits() const noexcept { return hits_; }
+  std::size_t misses() const noexcept { return misses_; }
+
+private:
+  struct Slot {
+    std::uint64_t offset{};
+    std::uint32_t length{};
+    std::uint32_t state{};
+  };
+  static_assert(sizeof(Slot) == 16);
+
+  bool load();
+
+  std::filesystem::path idxPath_;
+  std::filesystem::path datPath_;
+  std::uint64_t fingerprint_{};
+  std::vector<Slot> index_;
+  std::string data_;         // whole data file plus pending appends
+  std::size_t persisted_{};  // prefix of data_ already on disk
+  bool dirty_{false};
+  mutable std::size_t hits_{};
+  mutable std::size_t misses_{};
+};
@@ -0,0 +1,36 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <vector>
+
+#include "pdf/page_text.hpp"
+#include "types.hpp"
+
+class PdfSession;
+
+// Extracts page text on several threads. Each worker runs on its own cloned
+// context and opens its own fz_document, so no MuPDF object is shared.
+// With a cache, only pages missing from it are handed to the workers.
+class PagePool {
+public:
+  struct Page {
+    std::string text;
+    std::optional<PageLayout> layout; // set when extracted with layout
+  };
+
+  // threads == 0 picks std::thread::hardware_concurrency()
+  PagePool(const PdfSession &session, std::string path, unsigned threads = 0,
+           PageReadOptions opts = {}) noexcept;
+
+  // Pages [first, last] (0-based), in page order.
+  // An empty optional marks a page that failed to load or render.
+  std::vector<std::optional<Page>> extract(int first, int last) const;
+
+  unsigned threads() const noexcept { return threads_; }
+
+private:
+  const PdfSession *session_ = nullptr;
+  PageReadOptions opts_;
+  std::string path_;
+  unsigned threads_ = 1;
+};
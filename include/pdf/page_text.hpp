@@ -3,6 +3,26 @@
 #include <string_view>
 
 #include "handle.hpp"
+#include "types.hpp"
+
+// Identifies how page text is produced (fz_new_buffer_from_page with default
+// stext options, by this MuPDF version). Bump it when extraction changes so
+// page caches invalidate.
+inline constexpr std::string_view kPageTextOptions =
+    "stext:default;v1;mupdf " FZ_VERSION;
+
+class MemoryBudget;
+class RssPeak;
+class PageCache;
+
+// How chapter readers and page pools fetch pages. Pointers are not owned.
+struct PageReadOptions {
+  PageCache *cache = nullptr;      // serve and record pages here
+  bool layout = false;             // structured text with line typography
+  MemoryBudget *budget = nullptr;  // throttle and shrink the store when over
+  RssPeak *peak = nullptr;         // with budget: the book's peak RSS
+  bool mapped = false;             // PagePool workers mmap the PDF
+};
 
 // Deleters carry the context to drop resources
 struct PageDrop {
@@ -13,6 +33,14 @@ struct PageDrop {
   }
 };
 
+struct StextDrop {
+  fz_context *ctx{};
+  void operator()(fz_stext_page *s) const noexcept {
+    if (s)
+      fz_drop_stext_page(ctx, s);
+  }
+};
+
 struct BufferDrop {
   fz_context *ctx{};
   void operator()(fz_buffer *b) const noexcept {
@@ -21,10 +49,27 @@ struct BufferDrop {
   }
 };
 
+// On failure these return null and, given error, set it to the FZ_ERROR_*
+// code MuPDF threw.
 Handle<fz_page, PageDrop> makePage(fz_context *ctx, fz_document *doc,
-                                   int index) noexcept;
+                                   int index, int *error = nullptr) noexcept;
+Handle<fz_buffer, BufferDrop> makeBuffer(fz_context *ctx, fz_page *page,
+                                         int *error = nullptr) noexcept;
+
+// Structured-text route: one stext page yields both the page text (the same
+// bytes makeBuffer(ctx, page) returns) and the line typography.
+Handle<fz_stext_page, StextDrop> makeStext(fz_context *ctx, fz_page *page,
+                                           int *error = nullptr) noexcept;
 Handle<fz_buffer, BufferDrop> makeBuffer(fz_context *ctx,
-                                         fz_page *page) noexcept;
+                                         fz_stext_page *stext,
+                                         int *error = nullptr) noexcept;
+
+// Whether a page that failed with error fails the same way every time with
+// this PDF and MuPDF version (the page is malformed), so a page cache may
+// keep the failure. Running out of memory, an abort or an error of unknown
+// kind may pass on a retry.
+bool permanentError(int error) noexcept;
+PageLayout pageLayout(fz_context *ctx, const fz_stext_page *stext);
 
 inline const char *bufferData(const Handle<fz_buffer, BufferDrop> &h) noexcept {
   return h ? reinterpret_cast<const char *>(h.get()->data) : nullptr;
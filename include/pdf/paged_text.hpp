@@ -0,0 +1,53 @@
+#pragma once
+#include <cstddef>
+#include <iosfwd>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <variant>
+#include <vector>
+
+#include "pdf/page_text.hpp"
+
+// Chapter text as a sequence of pages, read in place.
+// Pages stay in their MuPDF buffers (or an owned string when they came from
+// a worker thread or the page cache). The logical text is every page followed
+// by '\n', exactly what ChapterReader used to concatenate into one string.
+// Pages read through structured text also carry their line typography.
+class PagedText {
+public:
+  void append(Handle<fz_buffer, BufferDrop> page,
+              std::optional<PageLayout> layout = std::nullopt);
+  void append(std::string page,
+              std::optional<PageLayout> layout = std::nullopt);
+
+  std::size_t pageCount() const noexcept { return pages_.size(); }
+  std::string_view page(std::size_t i) const noexcept;
+  // Byte offset of page i in the logical text; pageOffset(pageCount()) == size()
+  std::size_t pageOffset(std::size_t i) const noexcept { return offsets_[i]; }
+  std::size_t size() const noexcept { return offsets_.back(); }
+  bool empty() const noexcept { return pages_.empty(); }
+
+  const std::vector<std::optional<PageLayout>> &layouts() const noexcept {
+    return layouts_;
+  }
+  // True when every page came with typography (none from plain text).
+  bool hasLayout() const noexcept;
+
+  // Lines as std::getline would split the logical text. Lines never cross
+  // a page, since every page is terminated by its own '\n'. pageEnds, if
+  // given, receives the index of each page's last line: the lines whose
+  // '\n' is not in the page's bytes, in increasing order.
+  std::vector<std::string_view>
+  lines(std::vector<int> *pageEnds = nullptr) const;
+  std::string str() const;
+
+  friend std::ostream &operator<<(std::ostream &os, const PagedText &t);
+
+private:
+  using Page = std::variant<Handle<fz_buffer, BufferDrop>, std::string>;
+
+  std::vector<Page> pages_;
+  std::vector<std::optional<PageLayout>> layouts_;
+  std::vector<std::size_t> offsets_{0};
+};
@@ -1,6 +1,9 @@
 #pragma once
 #include "handle.hpp"
+#include <array>
 #include <mupdf/fitz.h>
+#include <mutex>
+#include <string>
 #include <string_view>
 
 struct FzContextDrop {
@@ -12,30 +15,55 @@ struct FzDocumentDrop {
   void operator()(fz_document *doc) const noexcept;
 };
 // ── Session = engine lifetime (replaces MuPdfEnvironment) ───────────────────
+// Installs fz_locks_context callbacks so worker threads can run on cloned
+// contexts. The lock table lives in the session, so it must not move.
 
 class PdfSession {
 public:
-  PdfSession() noexcept;
+  // maxStore caps MuPDF's resource store (fonts, images, parsed objects)
+  explicit PdfSession(std::size_t maxStore = FZ_STORE_UNLIMITED) noexcept;
   ~PdfSession() noexcept;
+  PdfSession(const PdfSession &) = delete;
+  PdfSession &operator=(const PdfSession &) = delete;
+
   bool isValid() const noexcept { return static_cast<bool>(ctx_); }
   fz_context *ctx() const noexcept { return ctx_.get(); }
 
+  // New context sharing the store and locks; one per worker thread.
+  // Callable from any thread; clones are serialized.
+  Handle<fz_context, FzContextDrop> clone() const noexcept;
+
 private:
+  static void lock(void *user, int id) noexcept;
+  static void unlock(void *user, int id) noexcept;
+
+  std::array<std::mutex, FZ_LOCK_MAX> mutexes_{};
+  mutable std::mutex cloneMutex_;
+  fz_locks_context locks_{};
   Handle<fz_context, FzContextDrop> ctx_{};
 };
 
 // File = opened PDF tied to a session
 class PdfFile {
 public:
-  PdfFile(fz_context *ctx, std::string_view path) noexcept;
+  // Path: MuPDF's own file stream. Mapped: the file is mmap'ed and prefetched
+  // (see mapped_stream.hpp); falls back to Path if mapping fails.
+  enum class Open { Path, Mapped };
+
+  PdfFile(fz_context *ctx, std::string_view path,
+          Open mode = Open::Path) noexcept;
   ~PdfFile() noexcept; // out-of-line dtor
   bool isValid() const noexcept { return static_cast<bool>(doc_); }
   int pageCount() const noexcept;
 
   fz_document *doc() const noexcept { return doc_.get(); }
   fz_context *ctx() const noexcept { return ctx_; }
+  const std::string &path() const noexcept { return path_; }
+  Open mode() const noexcept { return mode_; }
 
 private:
   fz_context *ctx_ = nullptr; // not owned
+  std::string path_;
+  Open mode_ = Open::Path;
   Handle<fz_document, FzDocumentDrop> doc_{nullptr, FzDocumentDrop{nullptr}};
 };
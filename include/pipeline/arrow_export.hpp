@@ -0,0 +1,75 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "pdf/metadata.hpp"
+#include "types.hpp"
+
+// Sections as an Arrow IPC file (Feather v2), readable with
+// pyarrow.ipc.open_file / pyarrow.feather.read_table without a database.
+// Columns: book_title, chapter, section_index, title, startline, endline,
+// content. The repeated strings (book_title, chapter, title) are
+// dictionary-encoded with int32 indices. Every add() appends one record
+// batch, preceded by delta dictionaries for the values it introduces, so
+// memory stays bounded by a single book. add() may be called from several
+// threads. The file is written under a temporary name and renamed by
+// finish(), so a reader never sees one without its footer.
+class ArrowExport {
+public:
+  explicit ArrowExport(std::filesystem::path path) noexcept;
+  ~ArrowExport() { finish(); }
+
+  ArrowExport(const ArrowExport &) = delete;
+  ArrowExport &operator=(const ArrowExport &) = delete;
+
+  bool isValid() const noexcept { return valid_; }
+
+  // One record batch with the rows of every chapter of the book; chapter is
+  // the segments file stem, section_index the row's position, as in Mongo.
+  // Rows stored by reference are resolved against ChapterSegments::text,
+  // packed rows unpacked with ChapterSegments::codec.
+  bool add(const BookTitle &book, const std::vector<ChapterSegments> &segments);
+
+  // Writes the footer and moves the file into place; later calls are no-ops.
+  bool finish();
+
+  std::size_t rows() const noexcept { return rows_; }
+  const std::filesystem::path &path() const noexcept { return path_; }
+
+private:
+  // where a message sits in the file (Arrow's File.fbs Block struct)
+  struct Block {
+    std::int64_t offset;
+    std::int32_t metaDataLength;
+    std::int32_t pad;
+    std::int64_t bodyLength;
+  };
+
+  struct Dictionary {
+    std::unordered_map<std::string, std::int32_t> ids;
+    std::vector<std::string> values;
+    std::size_t written = 0; // values already sent in dictionary batches
+
+    std::int32_t id(const std::string &v);
+  };
+
+  Block message(const std::vector<std::uint8_t> &meta,
+                const std::string &body);
+
+  std::filesystem::path path_;
+  std::filesystem::path tmp_;
+  std::ofstream os_;
+  std::int64_t pos_ = 0;
+  Dictionary dicts_[3]; // book_title, chapter, title
+  std::vector<Block> dictBlocks_;
+  std::vector<Block> batchBlocks_;
+  std::size_t rows_ = 0;
+  bool valid_ = false;
+  bool finished_ = false;
+  std::mutex m_;
+};
@@ -0,0 +1,66 @@
+#pragma once
+#include <filesystem>
+#include <iosfwd>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "db/ingestor.hpp"
+#include "pipeline/arrow_export.hpp"
+#include "pipeline/book.hpp"
+
+// Runs many books on one MuPDF session and one repository connection.
+// Books are spread over a work-stealing pool, largest file first; each
+// worker opens its book on a cloned context. Ingestion is serialized
+// because the repository is not thread-safe.
+class BatchRunner {
+public:
+  struct Config {
+    BookConfig book;
+    unsigned workers{0}; // 0 = all cores
+    PdfFile::Open open{PdfFile::Open::Path};
+    // holds each book's manifest (BuildManifest::bookDir); empty = ingest
+    // every chapter
+    std::filesystem::path manifestDir;
+    bool force{false};                 // ignore recorded manifests
+    ArrowExport *arrow{nullptr};       // every book's sections, if set
+  };
+
+  struct BookStats {
+    std::filesystem::path pdf;
+    std::string title;
+    int rc{};
+    int pages{};
+    std::size_t chapters{};
+    std::size_t sections{};
+    std::size_t rssHighWater{}; // while this book was extracted (RssPeak)
+    double seconds{};       // opening, extracting and segmenting the book
+    double ingestSeconds{}; // writing it, not counting the wait for a turn
+  };
+
+  BatchRunner(const PdfSession &session, Ingestor &ingestor, Config cfg)
+      : session_(&session), ingestor_(&ingestor), cfg_(std::move(cfg)) {}
+
+  // Stats in input order.
+  std::vector<BookStats> run(const std::vector<std::filesystem::path> &pdfs);
+
+  static std::vector<std::filesystem::path>
+  fromDirectory(const std::filesystem::path &dir);
+  // One path per line; blank lines and lines starting with '#' are skipped.
+  // Relative paths resolve against the manifest's directory.
+  static std::vector<std::filesystem::path>
+  fromManifest(const std::filesystem::path &manifest);
+
+  static void report(const std::vector<BookStats> &stats, double wallSeconds,
+                     std::ostream &os);
+
+private:
+  BookStats runOne(const std::filesystem::path &pdfPath);
+  int ingest(const std::filesystem::path &pdfPath, const BookResult &book,
+             double &seconds);
+
+  const PdfSession *session_;
+  Ingestor *ingestor_;
+  Config cfg_;
+  std::mutex ingestMutex_;
+};
@@ -0,0 +1,59 @@
+#pragma once
+#include <filesystem>
+#include <memory>
+#include <vector>
+
+#include "chapters.hpp"
+#include "content_codec.hpp"
+#include "core/matcher.hpp"
+#include "pdf/metadata.hpp"
+#include "pdf/session.hpp"
+#include "pipeline/extract_chapters.hpp"
+#include "types.hpp"
+
+// In-memory pipeline for one book: extract chapters, slice the TOC and
+// segment every chapter, without touching the intermediate directories
+// unless dump is set. Safe to run concurrently for different books as long
+// as each call gets a PdfFile opened on its own (cloned) context.
+struct BookConfig {
+  ExtractConfig extract;
+  int minLinesBetweenChapters{5};
+  bool headings{false};
+  Matcher::Config matching;
+  bool dump{false};
+  bool prettyJson{false}; // indented segment files when dumping
+  bool sectionRefs{false}; // rows reference ChapterSegments::text
+  bool compress{false};    // rows packed with a dictionary trained on the book
+  std::filesystem::path chaptersDir{"chapters"};
+  std::filesystem::path tocDir{"toc_sections"};
+  std::filesystem::path outDir{"chapter_segments"};
+  std::filesystem::path blobsDir{"chapter_blobs"}; // dumped texts of refs
+  std::filesystem::path codecDir; // keeps the dictionary; see bookCodec
+  bool retrainCodec{false};
+};
+
+struct BookResult {
+  BookTitle title;
+  int totalPages{};
+  std::size_t chapters{};
+  std::size_t rssHighWater{}; // bytes, while extracting; 0 without a budget
+  std::vector<ChapterSegments> segments;
+};
+
+// A codec trained on the chapters' text; null (content stays plain) when the
+// book is too short to train on.
+std::shared_ptr<const ContentCodec>
+trainCodec(const std::vector<ChapterText> &texts);
+
+// The book's codec, trained once and kept in dir (the book's directory) for
+// later runs. Its id is part of every row and segment key, so a dictionary
+// trained afresh each run would rewrite every section. Trains again when
+// retrain is set, the file is missing or unreadable, or it was made with an
+// older ContentCodec::kTrainVersion. Without dir, trains every time.
+std::shared_ptr<const ContentCodec>
+bookCodec(const std::vector<ChapterText> &texts,
+          const std::filesystem::path &dir, bool retrain);
+
+// 0 on success; 2 = no outline, 3 = no TOC chapter, 4 = no TOC slices.
+int runBook(const PdfSession &session, const PdfFile &pdf,
+            const BookConfig &cfg, BookResult &out);
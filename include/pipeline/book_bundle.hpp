@@ -0,0 +1,42 @@
+#pragma once
+#include <optional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bundle.hpp"
+#include "chapters.hpp"
+#include "pipeline/section_writer.hpp"
+#include "types.hpp"
+
+// A book's stage outputs inside a Bundle, under the names the on-disk
+// pipeline gives its files ("chapters/NN_slug.txt", "toc_sections/...",
+// "chapter_segments/NN_slug.json") and with the same bytes. Chapters read
+// back carry no page layout. The put functions do not commit; a run commits
+// the bundle once at its end (see Bundle on what a commit costs).
+class BookBundle {
+public:
+  static constexpr std::string_view kChapters = "chapters/";
+  static constexpr std::string_view kTocSections = "toc_sections/";
+  static constexpr std::string_view kSegments = "chapter_segments/";
+
+  explicit BookBundle(Bundle &bundle) noexcept : bundle_(&bundle) {}
+
+  std::vector<ChapterText> chapters() const;
+  std::vector<TocSlice> tocSlices() const;
+  std::optional<ChapterSegments> segments(const std::string &file) const;
+
+  // Each replaces every blob of its stage.
+  bool putChapters(const std::vector<ChapterText> &texts);
+  bool putTocSlices(const std::vector<TocSlice> &slices);
+  // One chapter; segments of other chapters are kept.
+  bool putSegments(const ChapterSegments &segments,
+                   const SectionWriter &writer);
+
+  static std::string name(std::string_view stage, std::string_view file) {
+    return std::string(stage).append(file);
+  }
+
+private:
+  Bundle *bundle_;
+};
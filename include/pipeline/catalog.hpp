@@ -5,6 +5,7 @@
 #include <unordered_map>
 #include <vector>
 
+#include "chapters.hpp"
 #include "types.hpp"
 #include "utils.hpp"
 
@@ -27,19 +28,38 @@ public:
       if (Title::isTocLabel(fname))
         continue;
 
-      const auto t_norm = Title::extractChapterTitle(fname);
-      const auto key = Text::normalizeStr(t_norm);
-      v.push_back({f.path().string(), key});
+      v.push_back({f.path().string(), keyFor(fname)});
     }
 
+    sortByFile(v);
+    return v;
+  }
+
+  // In-memory counterpart of collect(); `file` holds the chapter file name.
+  static std::vector<ChapterMatch>
+  collect(const std::vector<ChapterText> &chapters) {
+    std::vector<ChapterMatch> v;
+    for (const auto &c : chapters) {
+      if (Title::isTocLabel(c.file))
+        continue;
+      v.push_back({c.file, keyFor(c.file)});
+    }
+    sortByFile(v);
+    return v;
+  }
+
+private:
+  static std::string keyFor(const std::string &fname) {
+    return Text::normalizeStr(Title::extractChapterTitle(fname));
+  }
+
+  static void sortByFile(std::vector<ChapterMatch> &v) {
     std::sort(v.begin(), v.end(),
               [](const ChapterMatch &a, const ChapterMatch &b) {
                 return a.file < b.file;
               });
-    return v;
   }
 
-private:
   std::filesystem::path chaptersDir_;
 };
 
@@ -71,6 +91,23 @@ public:
     return lookup;
   }
 
+  // In-memory counterpart of build(): chapter title -> its TOC slice.
+  static std::unordered_map<std::string, const TocSlice *>
+  build(const std::vector<TocSlice> &slices) {
+    std::unordered_map<std::string, const TocSlice *> lookup;
+    for (const auto &slice : slices) {
+      if (Title::isTocLabel(slice.file))
+        continue;
+
+      const auto title = Title::extractChapterTitle(slice.file);
+      if (Title::isTocLabel(title))
+        continue;
+
+      lookup.try_emplace(title, &slice);
+    }
+    return lookup;
+  }
+
 private:
   std::filesystem::path tocSectionsDir_;
 };
@@ -1,8 +1,30 @@
 #pragma once
+#include "chapters.hpp"
 #include "pdf/session.hpp"
 #include "types.hpp"
+#include <filesystem>
 #include <vector>
 
+class MemoryBudget;
+class RssPeak;
+
+struct ExtractConfig {
+  bool topLevelOnly{true};
+  unsigned threads{1};            // 1 = serial reader, 0 = all cores
+  std::filesystem::path cacheDir; // empty = no page-text cache
+  bool layout{false};             // keep line typography (structured text)
+  MemoryBudget *budget{nullptr};  // bounded-RSS extraction; not owned
+  RssPeak *peak{nullptr};         // with budget: this book's peak RSS
+  std::filesystem::path chaptersDir{"chapters"}; // extractChapters' output
+};
+
 bool extractChapters(const PdfSession &session, const PdfFile &pdf,
                      int &totalPages, std::vector<ChapterInfo> &chapters,
-                     bool topLevelOnly = true);
+                     const ExtractConfig &cfg = {});
+
+// Same as extractChapters, but keeps chapter text in memory instead of
+// writing cfg.chaptersDir/*.txt. Empty when the PDF has no outline.
+std::vector<ChapterText> loadChapters(const PdfSession &session,
+                                      const PdfFile &pdf, int &totalPages,
+                                      std::vector<ChapterInfo> &chapters,
+                                      const ExtractConfig &cfg = {});
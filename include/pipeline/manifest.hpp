@@ -0,0 +1,84 @@
+#pragma once
+#include <cstdint>
+#include <filesystem>
+#include <initializer_list>
+#include <map>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "db/concurrent_ingestor.hpp"
+#include "db/ingestor.hpp"
+#include "types.hpp"
+
+// Per-book record of what each stage produced from which inputs, so a re-run
+// only redoes stale items. Stored as JSON in <bookDir>/manifest.json, next to
+// the book's outputs.
+//
+// A stage maps items to the hash of their inputs. For file outputs the item
+// is the output path and the file's hash is kept too, so outputs edited or
+// overwritten by another book are rebuilt. Input hashes include the stage's
+// heuristics version (Matcher::kVersion, Segmenter::kVersion, ...); bumping
+// one reruns that stage and whatever consumes an output that really changed.
+class BuildManifest {
+public:
+  static constexpr std::string_view kExtract = "extract";
+  static constexpr std::string_view kSlice = "slice";
+  static constexpr std::string_view kSegment = "segment";
+  static constexpr std::string_view kIngest = "ingest";
+
+  // root holds one directory per book (bookDir)
+  BuildManifest(const std::filesystem::path &root,
+                const std::filesystem::path &pdfPath);
+
+  // <root>/<pdf stem>-<hash of the absolute pdf path>: where a book's
+  // outputs and manifest go, so books never list each other's files
+  static std::filesystem::path bookDir(const std::filesystem::path &root,
+                                       const std::filesystem::path &pdfPath);
+
+  // Hash of several inputs; parts are length-prefixed so they cannot run
+  // together.
+  static std::uint64_t key(std::initializer_list<std::string_view> parts);
+  // Content hash of a file, 0 if it cannot be read.
+  static std::uint64_t fileKey(const std::filesystem::path &p) noexcept;
+
+  // Recorded with these inputs and, for file items, the file is unchanged.
+  bool fresh(std::string_view stage, const std::string &item,
+             std::uint64_t input) const;
+  // Non-empty and every item is fresh for input.
+  bool stageFresh(std::string_view stage, std::uint64_t input) const;
+
+  // With output set, the file's current hash is recorded as well.
+  void record(std::string_view stage, const std::string &item,
+              std::uint64_t input, const std::filesystem::path &output = {});
+  void clear(std::string_view stage);
+  void clearAll() { stages_.clear(); }
+
+  bool save() const;
+  const std::filesystem::path &file() const noexcept { return file_; }
+
+private:
+  struct Entry {
+    std::uint64_t input{};
+    std::uint64_t output{}; // 0 = not a file item
+  };
+
+  bool valid(const std::string &item, const Entry &e) const;
+
+  std::filesystem::path file_;
+  std::map<std::string, std::map<std::string, Entry>, std::less<>> stages_;
+};
+
+// Ingests only chapters whose rows changed since the recorded ingestion.
+// Same return codes as Ingestor::ingest_directory / ingest_segments; a
+// chapter that failed is not recorded, so the next run retries it.
+int ingestChanged(Ingestor &ingestor, BuildManifest &manifest,
+                  const std::filesystem::path &outDir,
+                  const std::filesystem::path &pdfPath, const BookTitle &book);
+// Same, with the stale files spread over the ingestor's threads.
+int ingestChanged(ConcurrentIngestor &ingestor, BuildManifest &manifest,
+                  const std::filesystem::path &outDir,
+                  const std::filesystem::path &pdfPath, const BookTitle &book);
+int ingestChanged(Ingestor &ingestor, BuildManifest &manifest,
+                  const std::vector<ChapterSegments> &segments,
+                  const std::filesystem::path &pdfPath, const BookTitle &book);
@@ -1,25 +1,53 @@
 #pragma once
 #include <filesystem>
+#include <memory>
+#include <optional>
+#include <string_view>
 #include <unordered_map>
 #include <vector>
 
+#include "chapters.hpp"
+#include "content_codec.hpp"
+#include "content_store.hpp"
+#include "core/heading_detector.hpp"
 #include "core/matcher.hpp"
 #include "core/segmenter.hpp"
+#include "types.hpp"
 
 // SectionWriter
 // Orchestrates chapter segmentation and writes <chapter>_segments.json.
 // Inputs: chapPath (chapter .txt), tocLookup (title -> toc-slice paths)
+// The in-memory overload returns the rows instead of writing them.
+// By reference, a row names a byte range of the chapter text (kept once in
+// a ContentStore) instead of carrying a copy of it. With a codec, rows that
+// carry content hold it compressed with the book's dictionary.
 class SectionWriter {
 public:
+  // rows and JSON layout; see also Matcher/Segmenter::kVersion
+  static constexpr std::string_view kVersion = "section-writer/2";
+
   struct Config {
     int minLinesBetweenChapters{5};
     std::filesystem::path outDir{"chapter_segments"};
+    // match TOC lines only against typographic heading candidates when the
+    // chapter text carries layout; otherwise all lines are tried
+    bool headings{false};
+    // indented JSON for reading by eye; compact otherwise
+    bool pretty{false};
+    // rows carry a SectionRef into the chapter text instead of content
+    bool byReference{false};
+    // where runOne(chapPath, ...) and write() keep that text; unset, the
+    // caller stores ChapterSegments::text itself
+    ContentStore *blobs{nullptr};
+    // packs the content of rows that are not by reference
+    std::shared_ptr<const ContentCodec> codec;
   };
 
   explicit SectionWriter(Config cfg, Matcher matcher = {},
-                         Segmenter segmenter = {})
+                         Segmenter segmenter = {},
+                         HeadingDetector headings = {})
       : cfg_(std::move(cfg)), matcher_(std::move(matcher)),
-        segmenter_(std::move(segmenter)) {}
+        segmenter_(std::move(segmenter)), headings_(std::move(headings)) {}
 
   // Returns true if JSON was written for this chapter.
   bool runOne(
@@ -27,8 +55,39 @@ public:
       const std::unordered_map<std::string, std::vector<std::filesystem::path>>
           &tocLookup) const;
 
+  // Empty when the chapter has no TOC slice.
+  std::optional<ChapterSegments> runOne(
+      const ChapterText &chapter,
+      const std::unordered_map<std::string, const TocSlice *> &tocLookup)
+      const;
+
+  // Also stores segments.text when rows are by reference, linked to source
+  // if that is the chapter file holding it (see ContentStore::put).
+  void write(const ChapterSegments &segments,
+             const std::filesystem::path &source = {}) const;
+  // the bytes write() puts in the file
+  std::string json(const ChapterSegments &segments) const;
+  // A file written by write(); empty if it cannot be read or parsed.
+  static std::optional<ChapterSegments>
+  read(const std::filesystem::path &jsonPath);
+  static std::optional<ChapterSegments> parse(std::string file,
+                                              std::string_view json);
+
+  // where runOne(chapPath, ...) writes its JSON
+  std::filesystem::path outputFor(const std::filesystem::path &chapPath) const {
+    return cfg_.outDir / (chapPath.stem().string() + ".json");
+  }
+
 private:
+  std::vector<SectionRow>
+  segment(const std::string &chapTitle, const std::vector<std::string> &tocLines,
+          const std::vector<std::string_view> &allLines,
+          const std::vector<int> &breaks,
+          const std::vector<int> *candidates = nullptr,
+          const std::string *blob = nullptr) const;
+
   Config cfg_;
   Matcher matcher_;
   Segmenter segmenter_;
+  HeadingDetector headings_;
 };
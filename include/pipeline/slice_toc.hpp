@@ -1,13 +1,18 @@
 #pragma once
 #include <filesystem>
 #include <string>
+#include <string_view>
 #include <vector>
 
+#include "chapters.hpp"
 #include "core/chapter_indexer.hpp"
 #include "types.hpp"
 
 class SliceToc {
 public:
+  // window rules; see also ChapterIndex::kVersion
+  static constexpr std::string_view kVersion = "slice-toc/1";
+
   struct Config {
     int minLinesBetweenChapters{5};
     std::filesystem::path outDir{"toc_section"};
@@ -17,6 +22,13 @@ public:
 
   std::size_t run(const std::filesystem::path &tocPath,
                   const std::vector<ChapterMatch> &files) const;
+  // In-memory: slices the TOC chapter text without touching outDir.
+  std::vector<TocSlice> run(const ChapterText &toc,
+                            const std::vector<ChapterMatch> &files) const;
+
+  std::vector<TocSlice> slice(const std::vector<std::string> &tocLines,
+                              const std::vector<ChapterMatch> &files) const;
+  std::size_t write(const std::vector<TocSlice> &slices) const;
 
 private:
   std::vector<std::string>
@@ -28,7 +40,9 @@ private:
                    const std::vector<ChapterMatch> &files) const;
 
   bool isValid(int start, int end) const noexcept;
-  int writeSlice(const std::vector<std::string> &tocLines, int start, int end,
+  std::vector<std::string> keepLines(const std::vector<std::string> &tocLines,
+                                     int start, int end) const;
+  int writeSlice(const TocSlice &slice,
                  const std::filesystem::path &outFile) const;
 
 private:
@@ -0,0 +1,94 @@
+#pragma once
+#include <cstddef>
+#include <string_view>
+
+// Hand-written, constexpr equivalents of the std::regex patterns the title
+// helpers used to compile. ECMAScript semantics in the "C" locale: \s is
+// " \t\n\v\f\r", \d is [0-9], icase folds ASCII letters only. Prefix
+// matchers return the length of the match, 0 when there is none.
+struct TextMatch {
+  static constexpr bool isSpace(char c) noexcept {
+    return c == ' ' || (c >= '\t' && c <= '\r');
+  }
+  static constexpr bool isDigit(char c) noexcept {
+    return c >= '0' && c <= '9';
+  }
+  static constexpr bool isRoman(char c) noexcept { // [ivxlcdm], icase
+    switch (c | 0x20) {
+    case 'i': case 'v': case 'x': case 'l': case 'c': case 'd': case 'm':
+      return true;
+    default:
+      return false;
+    }
+  }
+
+  // ^\d+_
+  static constexpr std::size_t numberPrefix(std::string_view s) noexcept {
+    std::size_t i = 0;
+    while (i < s.size() && isDigit(s[i]))
+      ++i;
+    return (i > 0 && i < s.size() && s[i] == '_') ? i + 1 : 0;
+  }
+
+  // ^(chapter|ch)\s+([0-9]+|[ivxlcdm]+)\s*[:.\-]?\s*   (icase)
+  static constexpr std::size_t chapterTag(std::string_view s) noexcept {
+    std::size_t i = 0;
+    if (startsWithNoCase(s, "chapter") && s.size() > 7 && isSpace(s[7]))
+      i = 7;
+    else if (startsWithNoCase(s, "ch"))
+      i = 2;
+    else
+      return 0;
+
+    const std::size_t afterWord = i;
+    while (i < s.size() && isSpace(s[i]))
+      ++i;
+    if (i == afterWord || i == s.size())
+      return 0;
+
+    // the digit alternative wins whenever it can match; runs are greedy
+    // and the tail below always matches, so no backtracking is needed
+    const bool digits = isDigit(s[i]);
+    const std::size_t start = i;
+    while (i < s.size() && (digits ? isDigit(s[i]) : isRoman(s[i])))
+      ++i;
+    if (i == start)
+      return 0;
+
+    while (i < s.size() && isSpace(s[i]))
+      ++i;
+    if (i < s.size() && (s[i] == ':' || s[i] == '.' || s[i] == '-'))
+      ++i;
+    while (i < s.size() && isSpace(s[i]))
+      ++i;
+    return i;
+  }
+
+  // ^\s*[0-9ivxlcdm]+\s*$   (icase)
+  static constexpr bool pageNumber(std::string_view s) noexcept {
+    std::size_t i = 0;
+    while (i < s.size() && isSpace(s[i]))
+      ++i;
+    const std::size_t start = i;
+    while (i < s.size() && (isDigit(s[i]) || isRoman(s[i])))
+      ++i;
+    if (i == start)
+      return false;
+    while (i < s.size() && isSpace(s[i]))
+      ++i;
+    return i == s.size();
+  }
+
+private:
+  static constexpr bool startsWithNoCase(std::string_view s,
+                                         std::string_view lower) noexcept {
+    if (s.size() < lower.size())
+      return false;
+    for (std::size_t i = 0; i < lower.size(); ++i) {
+      const char c = s[i];
+      if ((c >= 'A' && c <= 'Z' ? c | 0x20 : c) != lower[i])
+        return false;
+    }
+    return true;
+  }
+};
@@ -0,0 +1,22 @@
+#pragma once
+#include <cstddef>
+
+// ASCII kernels behind Text's normalization helpers. Results match the
+// <cctype> functions in the "C" locale, the only one bookslice runs in:
+// bytes >= 0x80 are neither letters, digits nor spaces. On x86-64 they step
+// through 16-byte SSE2 blocks and drop to a per-byte loop only for blocks
+// that need it; elsewhere, or built with BOOKSLICE_NO_SIMD, they run the
+// per-byte loop throughout.
+struct TextSimd {
+  // A-Z -> a-z, in place
+  static void toLower(char *s, std::size_t n) noexcept;
+  // lower-cased [0-9A-Za-z] of in; out holds at least n bytes and may be in
+  static std::size_t lowerAlnum(const char *in, std::size_t n,
+                                char *out) noexcept;
+  // whitespace runs -> one ' ', none at either end; out holds at least n
+  static std::size_t collapseWhitespace(const char *in, std::size_t n,
+                                        char *out) noexcept;
+  static bool hasLetters(const char *s, std::size_t n) noexcept;
+  static void countLetters(const char *s, std::size_t n, int &letters,
+                           int &uppers) noexcept;
+};
@@ -1,5 +1,10 @@
 #pragma once
+#include <cstdint>
+#include <memory>
 #include <string>
+#include <vector>
+
+class ContentCodec;
 
 struct Outline {
   std::string title;
@@ -23,3 +28,59 @@ struct Section {
   int endLine;
   int tocEntry;
 };
+
+// Typography of one extracted text line (one fz_stext_line).
+struct LineStyle {
+  std::string text;
+  int glyphs{};
+  float size{}; // mean glyph size, points
+  bool bold{};  // most glyphs come from a bold font
+};
+
+struct PageLayout {
+  std::vector<LineStyle> lines;
+};
+
+// ── In-memory pipeline payloads ─────────────────────────────────────────────
+// Each carries the file name the on-disk pipeline would use, since chapter
+// keys and Mongo records are derived from those names. ChapterText lives in
+// chapters.hpp next to the reader that fills it.
+
+struct TocSlice {
+  std::string file; // same name as the chapter it belongs to
+  int start;
+  int end;
+  std::vector<std::string> lines;
+};
+
+// A section stored by reference: a byte range of its chapter's text, which
+// is kept once under its ContentStore id.
+struct SectionRef {
+  std::string blob; // empty: the row carries its content
+  std::uint64_t offset{};
+  std::uint64_t length{};
+};
+
+// A section's content as one zstd frame, compressed with its book's
+// dictionary (ContentCodec).
+struct PackedContent {
+  std::string dict;  // ContentCodec id; empty: the row is not packed
+  std::string bytes;
+  std::uint64_t chars{}; // code points of the content, for length filters
+};
+
+struct SectionRow {
+  std::string title;
+  int startline{};
+  int endline{};
+  std::string content; // empty when ref or packed is set
+  SectionRef ref;
+  PackedContent packed;
+};
+
+struct ChapterSegments {
+  std::string file; // "NN_slug.json"
+  std::vector<SectionRow> rows;
+  std::string text; // chapter text the refs point into, when known
+  std::shared_ptr<const ContentCodec> codec; // unpacks packed rows
+};
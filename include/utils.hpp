@@ -1,11 +1,15 @@
 #pragma once
+#include <array>
+#include <cstdint>
 #include <filesystem>
 #include <nlohmann/json_fwd.hpp>
+#include <optional>
 #include <span>
 #include <string>
 #include <string_view>
 #include <vector>
 
+struct ChapterText;
 struct Outline;
 
 struct Text {
@@ -14,6 +18,7 @@ struct Text {
   static double upperRatio(std::string_view s) noexcept;
   static bool isSpace(char c) noexcept;
   static std::string trim(const std::string &s);
+  static std::string_view trimView(std::string_view s) noexcept;
   static std::string collapseWhitespace(std::string_view s);
   static std::string normalizeStr(std::string s);
   static bool contains(std::string_view hay, std::string_view needle);
@@ -23,21 +28,22 @@ struct Text {
 };
 
 struct Title {
+  // what makes a TOC line noise (see NoiseFilter)
+  static constexpr std::array<std::string_view, 4> kBannedWords{
+      "download", "wowebook", "copyright", "page"};
+  static constexpr double kUpperRatioCap = 0.6; // noisy at or above
+
   static void replaceAll(std::string &s, const std::string &from,
                          const std::string &to);
   static std::string stripLeadingChapterTag(const std::string &s);
   static std::string stripLeadingThe(std::string s);
   static std::string slugify(const std::string &s);
   static std::filesystem::path findToc(const std::filesystem::path &dir);
+  static const ChapterText *findToc(const std::vector<ChapterText> &chapters);
   static bool isTocLabel(const std::string_view text);
   static bool looksLikeTocName(const std::string &filename);
-  static bool hasChapterName(std::string_view s,
-                             const std::string &chapterTitle);
   static bool containsAnyOf(std::string_view s,
                             std::span<const std::string_view> words);
-  static bool hasBannedWord(std::string_view lower);
-  static bool hasWeirdChars(std::string_view s);
-  static bool isNoisy(const std::string &s, const std::string &chapterTitle);
   static std::string extractChapterTitle(const std::string &path);
   static bool isSubtitleMatch(std::string_view tocLine,
                               std::string_view chapterLine);
@@ -47,10 +53,30 @@ struct FileIO {
   static std::vector<std::string> readLines(const std::filesystem::path &p);
   static void writeJson(const std::filesystem::path &outPath,
                         const nlohmann::json &j);
+  // Writes a temporary next to outPath and renames it over, so a reader
+  // or a hard link to the old file never sees a half-written one.
+  static bool writeText(const std::filesystem::path &outPath,
+                        std::string_view text);
   static std::vector<std::filesystem::path>
   listChapters(const std::filesystem::path &dir, std::string_view ext);
 };
 
+// 64-bit FNV-1a; stable across runs and platforms, used for cache keys.
+struct Hash {
+  static constexpr std::uint64_t kSeed = 0xcbf29ce484222325ull;
+  static std::uint64_t fnv1a(std::string_view s,
+                             std::uint64_t seed = kSeed) noexcept;
+  static std::uint64_t file(const std::filesystem::path &p);
+  static std::string hex(std::uint64_t h);
+};
+
+// RFC 4648 with padding; carries binary fields inside JSON.
+struct Base64 {
+  static std::string encode(std::string_view bytes);
+  // nullopt on characters outside the alphabet or a bad length
+  static std::optional<std::string> decode(std::string_view text);
+};
+
 struct OutlineView {
   static void print(const std::vector<Outline> &outline, int totalPages);
 };
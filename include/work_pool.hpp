@@ -0,0 +1,43 @@
+#pragma once
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Fixed set of workers, one deque each. A worker takes from the front of its
+// own deque and, when that is empty, steals from the back of the others.
+// Queued longest-first, each worker starts on its longest task while thieves
+// pick up the shortest ones left to fill the gaps.
+// All tasks are queued before run(); run() returns once every task is done.
+class WorkStealingPool {
+public:
+  using Task = std::function<void()>;
+
+  // workers == 0 picks std::thread::hardware_concurrency()
+  explicit WorkStealingPool(unsigned workers = 0);
+
+  // Tasks are dealt round-robin, so queue the longest ones first.
+  void submit(Task task);
+  void run();
+
+  unsigned workers() const noexcept {
+    return static_cast<unsigned>(queues_.size());
+  }
+  std::size_t steals() const noexcept { return steals_; }
+
+private:
+  struct Queue {
+    std::mutex m;
+    std::deque<Task> tasks;
+  };
+
+  bool popOwn(std::size_t self, Task &out);
+  bool steal(std::size_t self, Task &out);
+
+  std::vector<std::unique_ptr<Queue>> queues_;
+  std::size_t next_{0};
+  std::size_t steals_{0};
+  std::mutex statsMutex_;
+};
@@ -0,0 +1,48 @@
+"""
+Reads sections from an Arrow IPC file written by `bookslice --arrow`.
+The file is memory-mapped, so no database round trip is needed and the
+content column is not copied until a Section is built from it.
+"""
+
+from typing import Optional
+
+import pyarrow as pa
+import pyarrow.compute as pc
+import pyarrow.ipc as ipc
+
+from knowledge_base.domain import Section
+from knowledge_base.domain.types import BookTitle, SectionMap, create_key
+
+from .extract import MIN_CHARS
+
+
+def read_sections_table(
+    path: str, book_title: Optional[BookTitle] = None
+) -> pa.Table:
+    """Returns the sections table, optionally for a single book"""
+    with pa.memory_map(path, "r") as source:
+        table = ipc.open_file(source).read_all()
+    if book_title is not None:
+        table = table.filter(
+            pc.equal(table["book_title"].cast(pa.string()), book_title)
+        )
+    return table
+
+
+def load_sections(path: str, book_title: BookTitle) -> SectionMap:
+    """Same sections as SectionExtractor.get_sections_for_book"""
+    table = read_sections_table(path, book_title)
+    table = table.filter(
+        pc.greater_equal(pc.utf8_length(table["content"]), MIN_CHARS)
+    )
+    out = {}
+    for row in table.to_pylist():
+        s = Section(
+            id=f"{row['book_title']}/{row['chapter']}/{row['section_index']}",
+            book_title=row["book_title"],
+            chapter=row["chapter"],
+            section_index=int(row["section_index"]),
+            content=row["content"],
+        )
+        out[create_key(s)] = s
+    return out
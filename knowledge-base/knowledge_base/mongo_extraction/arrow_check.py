@@ -0,0 +1,95 @@
+"""
+Round-trips an Arrow IPC file written by `bookslice --arrow` through
+pyarrow: opens it by its footer, checks the schema and every buffer, and
+compares it with what the feather reader and a pyarrow rewrite of the
+same table give back. Exits non-zero on the first mismatch, so it can
+check the C++ writer against the reader the knowledge-base uses.
+"""
+
+import sys
+from typing import List
+
+import pyarrow as pa
+import pyarrow.feather as feather
+import pyarrow.ipc as ipc
+
+DICT = pa.dictionary(pa.int32(), pa.string())
+
+SCHEMA = pa.schema(
+    [
+        pa.field("book_title", DICT, nullable=False),
+        pa.field("chapter", DICT, nullable=False),
+        pa.field("section_index", pa.int32(), nullable=False),
+        pa.field("title", DICT, nullable=False),
+        pa.field("startline", pa.int32(), nullable=False),
+        pa.field("endline", pa.int32(), nullable=False),
+        pa.field("content", pa.string(), nullable=False),
+    ]
+)
+
+
+def check_file(path: str) -> List[str]:
+    """Problems found in the file; empty if it round-trips"""
+    problems = []
+    with pa.memory_map(path, "r") as source:
+        reader = ipc.open_file(source)
+        if not reader.schema.equals(SCHEMA):
+            problems.append(f"schema differs:\n{reader.schema}")
+        batches = [reader.get_batch(i) for i in range(reader.num_record_batches)]
+    for i, batch in enumerate(batches):
+        try:
+            batch.validate(full=True)
+        except pa.ArrowInvalid as e:
+            problems.append(f"batch {i}: {e}")
+        if batch.num_rows and batch.column("content").null_count:
+            problems.append(f"batch {i}: null content")
+        idx = batch.column("section_index").to_pylist()
+        chapters = batch.column("chapter").to_pylist()
+        for row in range(batch.num_rows):
+            first = row == 0 or chapters[row] != chapters[row - 1]
+            expected = 0 if first else idx[row - 1] + 1
+            if idx[row] != expected:
+                problems.append(
+                    f"batch {i} row {row}: section_index {idx[row]}, "
+                    f"expected {expected}"
+                )
+                break
+    if problems:
+        return problems
+
+    table = pa.Table.from_batches(batches, schema=SCHEMA)
+    if not feather.read_table(path).equals(table):
+        problems.append("feather.read_table disagrees with ipc.open_file")
+
+    sink = pa.BufferOutputStream()
+    with ipc.new_file(sink, table.schema) as writer:
+        writer.write_table(table)
+    again = ipc.open_file(sink.getvalue()).read_all()
+    if not again.equals(table):
+        problems.append("table changed when rewritten by pyarrow")
+    print(
+        f"{path}: {table.num_rows} sections in {len(batches)} batches, "
+        f"{len(table.column('book_title').unique())} books"
+    )
+    return problems
+
+
+if __name__ == "__main__":
+    import argparse
+
+    parser = argparse.ArgumentParser(
+        description="Check Arrow files written by bookslice --arrow"
+    )
+    parser.add_argument("files", nargs="+", help="Arrow IPC files")
+    args = parser.parse_args()
+
+    failed = False
+    for f in args.files:
+        try:
+            problems = check_file(f)
+        except (pa.ArrowInvalid, OSError) as e:
+            problems = [str(e)]
+        for p in problems:
+            print(f"✗ {f}: {p}", file=sys.stderr)
+            failed = True
+    sys.exit(1 if failed else 0)
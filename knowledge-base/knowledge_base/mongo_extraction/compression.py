@@ -0,0 +1,46 @@
+"""
+Decodes section content written by `bookslice --compress`: a zstd frame
+(`content_z`) made with the book's dictionary, stored once in the
+`content_dicts` collection under the id the section names (`content_dict`).
+"""
+
+from typing import Any, Dict, Iterable, Mapping
+
+import zstandard
+from pymongo.database import Database
+
+CODEC_VERSION = 1
+DICTS = "content_dicts"
+
+
+def load_dictionaries(
+    db: Database, ids: Iterable[str]
+) -> Dict[str, zstandard.ZstdCompressionDict]:
+    """Fetches the dictionaries with the given ids in one query"""
+    wanted = sorted(set(ids))
+    if not wanted:
+        return {}
+    out = {}
+    for doc in db[DICTS].find({"_id": {"$in": wanted}}):
+        if doc.get("codec") != CODEC_VERSION:
+            raise ValueError(f"dictionary {doc['_id']}: unsupported codec")
+        out[doc["_id"]] = zstandard.ZstdCompressionDict(bytes(doc["dict"]))
+    return out
+
+
+def decode_content(
+    doc: Mapping[str, Any],
+    dicts: Mapping[str, zstandard.ZstdCompressionDict],
+) -> str:
+    """The section's content, packed or not"""
+    if "content_z" not in doc:
+        return str(doc.get("content", "") or "")
+    if doc.get("content_codec") != CODEC_VERSION:
+        raise ValueError(f"section {doc.get('_id')}: unsupported codec")
+    d = dicts.get(doc["content_dict"])
+    if d is None:
+        raise KeyError(f"dictionary {doc['content_dict']} not loaded")
+    raw = zstandard.ZstdDecompressor(dict_data=d).decompress(
+        bytes(doc["content_z"])
+    )
+    return raw.decode("utf-8")
@@ -17,9 +17,12 @@ from knowledge_base.domain.types import (
     create_key,
 )
 
+from .compression import decode_content, load_dictionaries
+
 MIN_CHARS = 100
 DB_NAME = "bookslice"
 COLLECTION = "sections"
+TEXTS = "chapter_texts"
 
 _PROJECT_DOC_FIELDS = {
     "book_title": 1,
@@ -27,6 +30,9 @@ _PROJECT_DOC_FIELDS = {
     "title": 1,
     "section_index": 1,
     "content": 1,
+    "content_z": 1,
+    "content_dict": 1,
+    "content_codec": 1,
 }
 
 
@@ -43,8 +49,13 @@ class SectionExtractor:
         out: SectionMap = {}
         pipeline = self._pipeline(book_title, mode="docs")
 
-        for doc in self._coll().aggregate(pipeline, allowDiskUse=True):
-            s = self._to_section(doc)
+        docs = list(self._coll().aggregate(pipeline, allowDiskUse=True))
+        dicts = load_dictionaries(
+            self.client[self.db_name],
+            (d["content_dict"] for d in docs if "content_dict" in d),
+        )
+        for doc in docs:
+            s = self._to_section(doc, decode_content(doc, dicts))
             out[create_key(s)] = s
         return out
 
@@ -60,11 +71,21 @@ class SectionExtractor:
     def _pipeline(self, book_title: BookTitle, mode: str) -> List[Dict]:
         base = [
             {"$match": {"book_title": book_title}},
+            *_resolve_content_refs(),
             {
                 "$match": {
                     "$expr": {
                         "$gte": [
-                            {"$strLenCP": {"$ifNull": ["$content", ""]}},
+                            {
+                                "$ifNull": [
+                                    "$content_chars",
+                                    {
+                                        "$strLenCP": {
+                                            "$ifNull": ["$content", ""]
+                                        }
+                                    },
+                                ]
+                            },
                             int(MIN_CHARS),
                         ]
                     }
@@ -83,16 +104,61 @@ class SectionExtractor:
         raise ValueError("mode must be 'docs' or 'count'")
 
     @staticmethod
-    def _to_section(doc: Dict[str, Any]) -> Section:
+    def _to_section(doc: Dict[str, Any], content: str) -> Section:
         return Section(
             id=str(doc.get("_id", "")),
             book_title=str(doc.get("book_title", "") or ""),
             chapter=str(doc.get("chapter", "") or ""),
             section_index=int(doc.get("section_index", 0) or 0),
-            content=str(doc.get("content", "") or ""),
+            content=content,
         )
 
 
+def _resolve_content_refs() -> List[Dict]:
+    """Fills in content of sections stored by reference (`--section-refs`):
+    bytes [content_offset, content_offset + content_length) of the chapter
+    text whose _id is content_blob. Inline sections pass through."""
+    return [
+        {
+            "$lookup": {
+                "from": TEXTS,
+                "let": {
+                    "blob": "$content_blob",
+                    "offset": "$content_offset",
+                    "length": "$content_length",
+                },
+                "pipeline": [
+                    {"$match": {"$expr": {"$eq": ["$_id", "$$blob"]}}},
+                    {
+                        "$project": {
+                            "_id": 0,
+                            "content": {
+                                "$substrBytes": [
+                                    "$text",
+                                    "$$offset",
+                                    "$$length",
+                                ]
+                            },
+                        }
+                    },
+                ],
+                "as": "_ref",
+            }
+        },
+        {
+            "$set": {
+                "content": {
+                    "$ifNull": [
+                        "$content",
+                        {"$arrayElemAt": ["$_ref.content", 0]},
+                    ]
+                }
+            }
+        },
+        {"$unset": "_ref"},
+    ]
+
+
 def save_sections(sections_by_id: SectionMap, out_path: str) -> str:
     """Save each section to a pickle"""
     os.makedirs(os.path.dirname(out_path) or ".", exist_ok=True)
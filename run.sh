@@ -3,7 +3,10 @@ set -euo pipefail
 
 BUILD_DIR="build"
 TARGET="${BUILD_DIR}/bookslice"
-OUTPUT_DIRS=(chapters toc_sections chapter_segments)
+# books/ holds one directory per PDF
+OUTPUT_DIRS=(books)
+# the shared layout from before per-book directories; nothing reads it now
+LEGACY_DIRS=(chapters toc_sections chapter_segments chapter_blobs .bookslice)
 
 clean_outputs() {
   for d in "${OUTPUT_DIRS[@]}"; do
@@ -11,11 +14,23 @@ clean_outputs() {
   done
 }
 
-echo "[run.sh] removing previous outputs (if any)"
-clean_outputs
+remove_legacy_outputs() {
+  for d in "${LEGACY_DIRS[@]}"; do
+    if [[ -e "$d" ]]; then
+      echo "[run.sh] removing ${d}/ from the old shared layout (outputs now go to books/<book>/)"
+      rm -rf "$d"
+    fi
+  done
+}
 
-echo "[run.sh] cleaning previous build"
-make clean
+# Outputs and the build are kept between runs so bookslice can skip stages
+# whose inputs did not change. Set CLEAN=1 for a from-scratch run.
+if [[ "${CLEAN:-0}" == "1" ]]; then
+  echo "[run.sh] removing previous outputs and build"
+  clean_outputs
+  make clean
+fi
+remove_legacy_outputs
 
 echo "[run.sh] building"
 make build
@@ -24,8 +39,4 @@ make build
 echo "[run.sh] running ${TARGET} with args: $*"
 "${TARGET}" "$@"
 
-# Optional: delete outputs after run (as requested)
-echo "[run.sh] cleaning outputs after run"
-clean_outputs
-
 echo "[run.sh] done"
@@ -0,0 +1,369 @@
+#include "bundle.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <set>
+#include <sys/file.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "utils.hpp"
+
+// File layout (little endian):
+//   "BSBUNDL1"
+//   blob bytes, index blocks and trailers, in append order
+//   index:   u32 count, then per blob u32 name length, name, u64 offset,
+//            u64 size, u64 FNV-1a hash
+//   trailer: u64 offset of the index, "BSINDEX1" (always the last 16 bytes)
+namespace {
+
+constexpr char kMagic[8] = {'B', 'S', 'B', 'U', 'N', 'D', 'L', '1'};
+constexpr char kTrailerMagic[8] = {'B', 'S', 'I', 'N', 'D', 'E', 'X', '1'};
+constexpr std::uint64_t kTrailerBytes = 16;
+// bytes read at a time when looking back for the last trailer
+constexpr std::uint64_t kScanWindow = 1 << 20;
+
+bool preadAll(int fd, char *p, std::uint64_t n, std::uint64_t off) {
+  while (n > 0) {
+    const ssize_t r = ::pread(fd, p, n, static_cast<off_t>(off));
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    p += r;
+    n -= static_cast<std::uint64_t>(r);
+    off += static_cast<std::uint64_t>(r);
+  }
+  return true;
+}
+
+bool pwriteAll(int fd, const char *p, std::uint64_t n, std::uint64_t off) {
+  while (n > 0) {
+    const ssize_t r = ::pwrite(fd, p, n, static_cast<off_t>(off));
+    if (r < 0 && errno == EINTR)
+      continue;
+    if (r <= 0)
+      return false;
+    p += r;
+    n -= static_cast<std::uint64_t>(r);
+    off += static_cast<std::uint64_t>(r);
+  }
+  return true;
+}
+
+// Opens path for reading and appending and takes an exclusive flock on it;
+// -1 if it cannot be opened or another Bundle holds it. compact() replaces
+// the file by rename, so a lock won on a file no longer at path is given up
+// and taken again on the one that is.
+int openLocked(const std::filesystem::path &path) {
+  for (;;) {
+    const int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) {
+      std::cerr << "Bundle: cannot open " << path << ": "
+                << std::strerror(errno) << '\n';
+      return -1;
+    }
+    if (::flock(fd, LOCK_EX | LOCK_NB) != 0) {
+      if (errno == EWOULDBLOCK)
+        std::cerr << "Bundle: " << path << " is in use by another process\n";
+      else
+        std::cerr << "Bundle: cannot lock " << path << ": "
+                  << std::strerror(errno) << '\n';
+      ::close(fd);
+      return -1;
+    }
+    struct stat held {}, named {};
+    if (::fstat(fd, &held) == 0 && ::stat(path.c_str(), &named) == 0 &&
+        held.st_dev == named.st_dev && held.st_ino == named.st_ino)
+      return fd;
+    ::close(fd);
+  }
+}
+
+template <class T> void putInt(std::string &out, T v) {
+  out.append(reinterpret_cast<const char *>(&v), sizeof v);
+}
+
+template <class T> bool getInt(std::string_view &in, T &v) {
+  if (in.size() < sizeof v)
+    return false;
+  std::memcpy(&v, in.data(), sizeof v);
+  in.remove_prefix(sizeof v);
+  return true;
+}
+
+} // namespace
+
+Bundle::Bundle(std::filesystem::path path) noexcept : path_(std::move(path)) {
+  std::error_code ec;
+  if (path_.has_parent_path())
+    std::filesystem::create_directories(path_.parent_path(), ec);
+  fd_ = openLocked(path_);
+  if (fd_ < 0)
+    return;
+  if (!load()) {
+    std::cerr << "Bundle: " << path_ << " is not a bundle or is truncated\n";
+    ::close(fd_);
+    fd_ = -1;
+    return;
+  }
+  for (const auto &[name, e] : index_)
+    byHash_.try_emplace(e.hash, e);
+}
+
+Bundle::~Bundle() {
+  if (fd_ >= 0)
+    ::close(fd_);
+}
+
+bool Bundle::load() {
+  struct stat st {};
+  if (fstat(fd_, &st) != 0)
+    return false;
+  const auto size = static_cast<std::uint64_t>(st.st_size);
+  if (size <= sizeof kMagic) { // new, or never written past the magic
+    char head[sizeof kMagic];
+    if (size > 0 && (!preadAll(fd_, head, size, 0) ||
+                     std::memcmp(head, kMagic, size) != 0))
+      return false;
+    end_ = sizeof kMagic;
+    dirty_ = true; // a new bundle gets an (empty) index on commit
+    return pwriteAll(fd_, kMagic, sizeof kMagic, 0);
+  }
+
+  char magic[sizeof kMagic];
+  if (!preadAll(fd_, magic, sizeof magic, 0) ||
+      std::memcmp(magic, kMagic, sizeof kMagic) != 0)
+    return false;
+
+  // Normally the trailer is the last 16 bytes. A run that stopped between
+  // put() and commit() leaves blobs after it; those are cut off, back to
+  // the last trailer whose index reads.
+  const std::string_view trailerMagic(kTrailerMagic, sizeof kTrailerMagic);
+  std::string window;
+  std::uint64_t hi = size; // trailers ending at or before hi
+  for (;;) {
+    const std::uint64_t lo =
+        hi - sizeof kMagic > kScanWindow ? hi - kScanWindow : sizeof kMagic;
+    window.resize(hi - lo);
+    if (!preadAll(fd_, window.data(), window.size(), lo))
+      return false;
+    const std::string_view w = window;
+    for (auto at = w.rfind(trailerMagic); at != std::string_view::npos;
+         at = at ? w.rfind(trailerMagic, at - 1) : std::string_view::npos) {
+      const std::uint64_t committed = lo + at + sizeof kTrailerMagic;
+      if (readIndex(committed))
+        return truncateTo(committed, size);
+    }
+    if (lo == sizeof kMagic)
+      break;
+    hi = lo + sizeof kTrailerMagic - 1; // a magic across the window edge
+  }
+
+  // nothing was ever committed
+  index_.clear();
+  dirty_ = true;
+  return truncateTo(sizeof kMagic, size);
+}
+
+bool Bundle::readIndex(std::uint64_t committed) {
+  index_.clear();
+  char trailer[kTrailerBytes];
+  if (committed < sizeof kMagic + kTrailerBytes ||
+      !preadAll(fd_, trailer, kTrailerBytes, committed - kTrailerBytes) ||
+      std::memcmp(trailer + 8, kTrailerMagic, sizeof kTrailerMagic) != 0)
+    return false;
+
+  std::uint64_t at = 0;
+  std::memcpy(&at, trailer, sizeof at);
+  if (at < sizeof kMagic || at > committed - kTrailerBytes)
+    return false;
+  std::string block(committed - kTrailerBytes - at, '\0');
+  if (!preadAll(fd_, block.data(), block.size(), at))
+    return false;
+
+  std::string_view in = block;
+  std::uint32_t count = 0;
+  if (!getInt(in, count))
+    return false;
+  for (std::uint32_t i = 0; i < count; ++i) {
+    std::uint32_t len = 0;
+    if (!getInt(in, len) || in.size() < len)
+      break;
+    std::string name(in.substr(0, len));
+    in.remove_prefix(len);
+    Entry e;
+    if (!getInt(in, e.offset) || !getInt(in, e.size) || !getInt(in, e.hash) ||
+        e.offset + e.size > at)
+      break;
+    index_.insert_or_assign(std::move(name), e);
+  }
+  if (index_.size() != count || !in.empty()) {
+    index_.clear();
+    return false;
+  }
+  return true;
+}
+
+bool Bundle::truncateTo(std::uint64_t committed, std::uint64_t size) {
+  end_ = committed;
+  if (committed == size)
+    return true;
+  std::cerr << "Bundle: dropping " << size - committed
+            << " uncommitted bytes from " << path_ << '\n';
+  return ::ftruncate(fd_, static_cast<off_t>(committed)) == 0;
+}
+
+std::optional<std::string> Bundle::read(std::string_view name) const {
+  const auto it = index_.find(name);
+  if (it == index_.end())
+    return std::nullopt;
+  std::string out(it->second.size, '\0');
+  if (!preadAll(fd_, out.data(), out.size(), it->second.offset)) {
+    std::cerr << "Bundle: cannot read " << name << " from " << path_ << '\n';
+    return std::nullopt;
+  }
+  return out;
+}
+
+std::vector<std::string> Bundle::list(std::string_view prefix) const {
+  std::vector<std::string> names;
+  for (auto it = index_.lower_bound(prefix);
+       it != index_.end() && it->first.starts_with(prefix); ++it)
+    names.push_back(it->first);
+  return names;
+}
+
+bool Bundle::put(std::string_view name, std::string_view bytes) {
+  if (fd_ < 0)
+    return false;
+  Entry e{end_, bytes.size(), Hash::fnv1a(bytes)};
+  const auto it = index_.find(name);
+  if (it != index_.end() && it->second.size == e.size &&
+      it->second.hash == e.hash)
+    return true;
+  if (const Entry *same = find(bytes, e.hash)) {
+    e = *same;
+  } else {
+    if (!pwriteAll(fd_, bytes.data(), bytes.size(), end_)) {
+      std::cerr << "Bundle: cannot write " << name << " to " << path_ << ": "
+                << std::strerror(errno) << '\n';
+      return false;
+    }
+    end_ += e.size;
+    byHash_.insert_or_assign(e.hash, e);
+  }
+  if (it != index_.end())
+    it->second = e;
+  else
+    index_.emplace(std::string(name), e);
+  dirty_ = true;
+  return true;
+}
+
+const Bundle::Entry *Bundle::find(std::string_view bytes,
+                                  std::uint64_t hash) const {
+  const auto it = byHash_.find(hash);
+  if (it == byHash_.end() || it->second.size != bytes.size())
+    return nullptr;
+  std::string stored(it->second.size, '\0');
+  if (!preadAll(fd_, stored.data(), stored.size(), it->second.offset) ||
+      stored != bytes)
+    return nullptr;
+  return &it->second;
+}
+
+void Bundle::remove(std::string_view name) {
+  const auto it = index_.find(name);
+  if (it == index_.end())
+    return;
+  index_.erase(it);
+  dirty_ = true;
+}
+
+void Bundle::clear(std::string_view prefix) {
+  auto it = index_.lower_bound(prefix);
+  while (it != index_.end() && it->first.starts_with(prefix)) {
+    it = index_.erase(it);
+    dirty_ = true;
+  }
+}
+
+std::uint64_t Bundle::liveBytes() const {
+  std::set<std::pair<std::uint64_t, std::uint64_t>> seen;
+  std::uint64_t live = 0;
+  for (const auto &[name, e] : index_)
+    if (seen.emplace(e.offset, e.size).second)
+      live += e.size;
+  return live;
+}
+
+bool Bundle::commit() {
+  if (fd_ < 0)
+    return false;
+  if (!dirty_)
+    return true;
+  const std::uint64_t live = liveBytes();
+  if (end_ - live > std::max<std::uint64_t>(live, 1 << 20))
+    return compact();
+
+  std::string block;
+  putInt(block, static_cast<std::uint32_t>(index_.size()));
+  for (const auto &[name, e] : index_) {
+    putInt(block, static_cast<std::uint32_t>(name.size()));
+    block += name;
+    putInt(block, e.offset);
+    putInt(block, e.size);
+    putInt(block, e.hash);
+  }
+  putInt(block, end_);
+  block.append(kTrailerMagic, sizeof kTrailerMagic);
+
+  // the blobs are on disk before a trailer vouches for them, and the
+  // trailer before commit() returns
+  if (::fdatasync(fd_) != 0 ||
+      !pwriteAll(fd_, block.data(), block.size(), end_) ||
+      ::fdatasync(fd_) != 0) {
+    std::cerr << "Bundle: cannot write the index of " << path_ << ": "
+              << std::strerror(errno) << '\n';
+    return false;
+  }
+  end_ += block.size();
+  dirty_ = false;
+  return true;
+}
+
+// Copies the live blobs, in name order, into a fresh file that replaces
+// this one. The fresh file is locked before it is renamed into place and
+// this bundle takes over its descriptor, so the lock is never let go.
+bool Bundle::compact() {
+  auto tmpPath = path_;
+  tmpPath += ".tmp";
+  std::error_code ec;
+  std::filesystem::remove(tmpPath, ec);
+
+  Bundle fresh(tmpPath);
+  bool ok = fresh.isValid();
+  for (auto it = index_.begin(); ok && it != index_.end(); ++it) {
+    const auto bytes = read(it->first);
+    ok = bytes && fresh.put(it->first, *bytes);
+  }
+  ok = ok && fresh.commit();
+  if (ok)
+    std::filesystem::rename(tmpPath, path_, ec);
+  if (!ok || ec) {
+    std::cerr << "Bundle: cannot compact " << path_ << '\n';
+    std::filesystem::remove(tmpPath, ec);
+    return false;
+  }
+
+  std::swap(fd_, fresh.fd_); // fresh closes the old file
+  end_ = fresh.end_;
+  index_ = std::move(fresh.index_);
+  byHash_ = std::move(fresh.byHash_);
+  dirty_ = false;
+  return true;
+}
@@ -3,9 +3,13 @@
 #include <fstream>
 #include <iomanip>
 #include <iostream>
+#include <optional>
 #include <sstream>
 
 #include "chapters.hpp"
+#include "pdf/memory_budget.hpp"
+#include "pdf/page_cache.hpp"
+#include "pdf/page_pool.hpp"
 #include "pdf/page_text.hpp"
 #include "types.hpp"
 #include "utils.hpp"
@@ -36,34 +40,145 @@ std::vector<ChapterInfo> computeChapters(const std::vector<Outline> &outline,
   return chapters;
 }
 
-std::string ChapterReader::text(const ChapterInfo &ch) const {
-  std::string out;
+PagedText ChapterReader::text(const ChapterInfo &ch) const {
+  PagedText out;
   if (!ctx_ || !doc_)
     return out;
-
-  const int count = ch.pageEnd - ch.pageStart + 1;
-  if (count <= 0)
-    return out;
-
-  out.reserve(count * 1024);
+  PageCache *cache = opts_.cache;
 
   for (int p = ch.pageStart - 1; p <= ch.pageEnd - 1; ++p) {
-    auto page = makePage(ctx_, doc_, p);
+    if (cache) {
+      const auto st = cache->state(p);
+      if (st == PageCache::State::Ok) {
+        out.append(std::string(cache->text(p)));
+        continue;
+      }
+      if (st == PageCache::State::Failed) {
+        std::cerr << "Skipping page " << (p + 1) << " (cached failure)\n";
+        continue;
+      }
+    }
+    BudgetTicket ticket(opts_.budget, ctx_, opts_.peak);
+    // a failure is cached only if a retry would fail the same way
+    int error = FZ_ERROR_NONE;
+    auto page = makePage(ctx_, doc_, p, &error);
     if (!page) {
       std::cerr << "Skipping page " << (p + 1) << " (load failed)\n";
+      if (cache && permanentError(error))
+        cache->putFailed(p);
       continue;
     }
-    auto buf = makeBuffer(ctx_, page.get());
+    std::optional<PageLayout> layout;
+    Handle<fz_buffer, BufferDrop> buf;
+    if (opts_.layout) {
+      auto stext = makeStext(ctx_, page.get(), &error);
+      page.reset(); // display list is no longer needed
+      buf = makeBuffer(ctx_, stext.get(), &error);
+      if (buf)
+        layout = pageLayout(ctx_, stext.get());
+    } else {
+      buf = makeBuffer(ctx_, page.get(), &error);
+      page.reset();
+    }
     if (!buf) {
       std::cerr << "Skipping page " << (p + 1) << " (render failed)\n";
+      if (cache && permanentError(error))
+        cache->putFailed(p);
       continue;
     }
-    out.append(bufferView(buf));
-    out.push_back('\n');
+    if (cache)
+      cache->put(p, bufferView(buf));
+    out.append(std::move(buf), std::move(layout));
+  }
+  return out;
+}
+
+std::string chapterFileName(std::size_t i, const ChapterInfo &ch) {
+  std::ostringstream name;
+  name << std::setw(2) << std::setfill('0') << (i + 1) << '_'
+       << Title::slugify(ch.title) << ".txt";
+  return name.str();
+}
+
+std::vector<ChapterText>
+readChapters(const ChapterReader &reader,
+             const std::vector<ChapterInfo> &chapters) {
+  std::vector<ChapterText> out;
+  out.reserve(chapters.size());
+  for (size_t i = 0; i < chapters.size(); ++i)
+    out.push_back({chapterFileName(i, chapters[i]), reader.text(chapters[i])});
+  return out;
+}
+
+std::vector<ChapterText> readChapters(const PagePool &pool,
+                                      const std::vector<ChapterInfo> &chapters) {
+  if (chapters.empty())
+    return {};
+
+  int first = chapters.front().pageStart;
+  int last = chapters.front().pageEnd;
+  for (const auto &ch : chapters) {
+    first = std::min(first, ch.pageStart);
+    last = std::max(last, ch.pageEnd);
+  }
+  // pages[k] holds 1-based page (first + k)
+  auto pages = pool.extract(first - 1, last - 1);
+
+  // a page is moved into the last chapter that uses it, copied before that
+  std::vector<int> uses(pages.size(), 0);
+  for (const auto &ch : chapters)
+    for (int p = ch.pageStart; p <= ch.pageEnd; ++p)
+      ++uses[p - first];
+
+  std::vector<ChapterText> out;
+  out.reserve(chapters.size());
+  for (size_t i = 0; i < chapters.size(); ++i) {
+    const auto &ch = chapters[i];
+    PagedText body;
+    for (int p = ch.pageStart; p <= ch.pageEnd; ++p) {
+      auto &page = pages[p - first];
+      if (!page) {
+        std::cerr << "Skipping page " << p << " (extraction failed)\n";
+        continue;
+      }
+      if (--uses[p - first])
+        body.append(page->text, page->layout);
+      else
+        body.append(std::move(page->text), std::move(page->layout));
+    }
+    out.push_back({chapterFileName(i, ch), std::move(body)});
   }
   return out;
 }
 
+bool ChapterWriter::writeOne(const std::string &file,
+                             const PagedText &body) const {
+  // written aside and renamed over the old file, which a chapter blob may
+  // be a hard link to (ContentStore)
+  const std::string name = dir_ + '/' + file;
+  const std::string tmp = name + ".tmp";
+  {
+    std::ofstream os(tmp);
+    if (!os) {
+      std::cerr << "✗ cannot open " << tmp << " for write\n";
+      return false;
+    }
+    os << body;
+    if (!os.flush()) {
+      std::cerr << "✗ cannot write " << tmp << '\n';
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, name, ec);
+  if (ec) {
+    std::cerr << "✗ cannot replace " << name << ": " << ec.message() << '\n';
+    return false;
+  }
+  std::cout << "✓ saved " << name << std::endl;
+  return true;
+}
+
 std::size_t
 ChapterWriter::writeAll(const ChapterReader &reader,
                         const std::vector<ChapterInfo> &chapters) const {
@@ -71,21 +186,24 @@ ChapterWriter::writeAll(const ChapterReader &reader,
   std::size_t written = 0;
 
   for (size_t i = 0; i < chapters.size(); ++i) {
-    const auto &ch = chapters[i];
-    const std::string body = reader.text(ch);
+    if (writeOne(chapterFileName(i, chapters[i]), reader.text(chapters[i])))
+      ++written;
+  }
+  return written;
+}
 
-    std::ostringstream name;
-    name << dir_ << '/' << std::setw(2) << std::setfill('0') << (i + 1) << '_'
-         << Title::slugify(ch.title) << ".txt";
+std::size_t
+ChapterWriter::writeAll(const PagePool &pool,
+                        const std::vector<ChapterInfo> &chapters) const {
+  return write(readChapters(pool, chapters));
+}
 
-    std::ofstream os(name.str());
-    if (!os) {
-      std::cerr << "✗ cannot open " << name.str() << " for write\n";
-      continue;
-    }
-    os << body;
-    std::cout << "✓ saved " << name.str() << std::endl;
-    ++written;
+std::size_t ChapterWriter::write(const std::vector<ChapterText> &texts) const {
+  std::filesystem::create_directories(dir_);
+  std::size_t written = 0;
+  for (const auto &t : texts) {
+    if (writeOne(t.file, t.body))
+      ++written;
   }
   return written;
 }
@@ -0,0 +1,203 @@
+#include "cli.hpp"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <string_view>
+
+#include "content_codec.hpp"
+
+namespace {
+
+std::filesystem::path defaultPdf() {
+  const char *home = std::getenv("HOME");
+  if (!home)
+    return {};
+  return std::filesystem::path(home) / "Downloads" /
+         "Head-First-Design-Patterns.pdf";
+}
+
+bool parseUnsigned(std::string_view s, unsigned &out) {
+  if (s.empty())
+    return false;
+  unsigned v = 0;
+  for (char c : s) {
+    if (c < '0' || c > '9')
+      return false;
+    v = v * 10 + static_cast<unsigned>(c - '0');
+  }
+  out = v;
+  return true;
+}
+
+} // namespace
+
+void printUsage(const char *argv0) {
+  std::cerr << "usage: " << argv0 << " [options] [book.pdf]\n"
+            << "  -j, --threads N   extract pages on N threads (0 = all "
+               "cores, default 1)\n"
+            << "  --cache DIR       reuse extracted page text cached in DIR\n"
+            << "  --in-memory       keep chapters, TOC slices and sections in "
+               "memory\n"
+            << "  --dump            with --in-memory, also write the "
+               "intermediate dirs\n"
+            << "  --headings        match TOC lines against typographic "
+               "headings only\n"
+            << "                    (implies --in-memory)\n"
+            << "  --fuzzy N         let TOC lines match with up to N edits "
+               "(1 per 8 chars)\n"
+            << "  --batch DIR       process every PDF in DIR (in memory)\n"
+            << "  --manifest FILE   process the PDFs listed in FILE (in "
+               "memory)\n"
+            << "  --workers N       books processed at once in batch mode "
+               "(0 = all cores)\n"
+            << "  --mem-budget MB   keep extraction under MB of resident "
+               "memory\n"
+            << "  --mmap            read PDFs through a prefetched memory "
+               "map\n"
+            << "  --force           rerun every stage even if its inputs are "
+               "unchanged\n"
+            << "  --pretty-json     indent the chapter segment JSON files\n"
+            << "  --arrow FILE      also write the sections to FILE as Arrow "
+               "IPC (Feather v2)\n"
+            << "  --bundle FILE     keep chapters, TOC slices and segments in "
+               "one bundle file\n"
+            << "  --section-refs    store sections as byte ranges of their "
+               "chapter text\n"
+            << "  --compress        store section content compressed with a "
+               "per-book zstd dictionary\n"
+            << "  --retrain-dict    with --compress, train the book's "
+               "dictionary again\n"
+            << "  --ingest-writers N  ingest segment files on N pooled Mongo "
+               "connections\n";
+}
+
+std::optional<CliOptions> parseCli(int argc, char **argv) {
+  CliOptions opts;
+  bool havePdf = false;
+
+  for (int i = 1; i < argc; ++i) {
+    const std::string_view arg = argv[i];
+    auto value = [&]() -> const char * {
+      if (i + 1 >= argc) {
+        std::cerr << "missing value for " << arg << '\n';
+        return nullptr;
+      }
+      return argv[++i];
+    };
+
+    if (arg == "-h" || arg == "--help") {
+      return std::nullopt;
+    } else if (arg == "-j" || arg == "--threads") {
+      const char *v = value();
+      if (!v || !parseUnsigned(v, opts.threads)) {
+        std::cerr << "invalid thread count\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--cache") {
+      const char *v = value();
+      if (!v)
+        return std::nullopt;
+      opts.cacheDir = v;
+    } else if (arg == "--in-memory") {
+      opts.inMemory = true;
+    } else if (arg == "--headings") {
+      opts.headings = true;
+      opts.inMemory = true;
+    } else if (arg == "--fuzzy") {
+      const char *v = value();
+      unsigned n = 0;
+      if (!v || !parseUnsigned(v, n) || n > 16) {
+        std::cerr << "invalid edit budget\n";
+        return std::nullopt;
+      }
+      opts.fuzzy = static_cast<int>(n);
+    } else if (arg == "--batch" || arg == "--manifest") {
+      const char *v = value();
+      if (!v)
+        return std::nullopt;
+      (arg == "--batch" ? opts.batchDir : opts.manifest) = v;
+      opts.inMemory = true;
+    } else if (arg == "--workers") {
+      const char *v = value();
+      if (!v || !parseUnsigned(v, opts.workers)) {
+        std::cerr << "invalid worker count\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--ingest-writers") {
+      const char *v = value();
+      if (!v || !parseUnsigned(v, opts.ingestWriters)) {
+        std::cerr << "invalid writer count\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--mem-budget") {
+      const char *v = value();
+      if (!v || !parseUnsigned(v, opts.memBudgetMb) || opts.memBudgetMb == 0) {
+        std::cerr << "invalid memory budget\n";
+        return std::nullopt;
+      }
+    } else if (arg == "--force") {
+      opts.force = true;
+    } else if (arg == "--bundle") {
+      const char *v = value();
+      if (!v)
+        return std::nullopt;
+      opts.bundlePath = v;
+    } else if (arg == "--arrow") {
+      const char *v = value();
+      if (!v)
+        return std::nullopt;
+      opts.arrowPath = v;
+    } else if (arg == "--section-refs") {
+      opts.sectionRefs = true;
+    } else if (arg == "--compress") {
+      if (!ContentCodec::kAvailable) {
+        std::cerr << "--compress needs a build with zstd\n";
+        return std::nullopt;
+      }
+      opts.compress = true;
+    } else if (arg == "--retrain-dict") {
+      opts.retrainDict = true;
+    } else if (arg == "--pretty-json") {
+      opts.prettyJson = true;
+    } else if (arg == "--mmap") {
+      opts.mmap = true;
+    } else if (arg == "--dump") {
+      opts.dump = true;
+    } else if (!arg.empty() && arg.front() == '-') {
+      std::cerr << "unknown option " << arg << '\n';
+      return std::nullopt;
+    } else if (!havePdf) {
+      opts.pdfPath = arg;
+      havePdf = true;
+    } else {
+      std::cerr << "unexpected argument " << arg << '\n';
+      return std::nullopt;
+    }
+  }
+
+  if (opts.batch()) {
+    if (havePdf) {
+      std::cerr << "a PDF path cannot be combined with --batch/--manifest\n";
+      return std::nullopt;
+    }
+    if (opts.dump || !opts.bundlePath.empty()) {
+      std::cerr << "--dump and --bundle are not supported in batch mode\n";
+      return std::nullopt;
+    }
+    if (opts.ingestWriters > 0) {
+      std::cerr << "--ingest-writers is not supported in batch mode\n";
+      return std::nullopt;
+    }
+    return opts;
+  }
+
+  if (!havePdf) {
+    opts.pdfPath = defaultPdf();
+    if (opts.pdfPath.empty()) {
+      std::cerr << "HOME not set!" << std::endl;
+      return std::nullopt;
+    }
+  }
+  return opts;
+}
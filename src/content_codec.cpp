@@ -0,0 +1,149 @@
+#include "content_codec.hpp"
+
+#include <algorithm>
+#include <iostream>
+#ifdef BOOKSLICE_HAVE_ZSTD
+#include <zdict.h>
+#endif
+
+#include "content_store.hpp"
+
+#ifdef BOOKSLICE_HAVE_ZSTD
+namespace {
+
+// Training samples should look like what gets compressed: section-sized
+// pieces, cut at line ends.
+constexpr std::size_t kSampleBytes = 4096;
+// zstd's advice: about a hundred times more samples than dictionary
+constexpr std::size_t kSamplesPerDictByte = 100;
+constexpr std::size_t kMinDictBytes = 1024;
+// UTF-8 needs at most this many bytes for a code point
+constexpr std::uint64_t kMaxBytesPerChar = 4;
+
+std::uint64_t codePoints(std::string_view s) noexcept {
+  return static_cast<std::uint64_t>(std::count_if(
+      s.begin(), s.end(), [](char c) { return (c & 0xC0) != 0x80; }));
+}
+
+} // namespace
+
+ContentCodec::ContentCodec(std::string dict, Config cfg)
+    : dict_(std::move(dict)), id_(ContentStore::id(dict_)) {
+  if (dict_.empty())
+    return;
+  cdict_ = Handle<ZSTD_CDict, CDictDrop>(
+      ZSTD_createCDict(dict_.data(), dict_.size(), cfg.level), CDictDrop{});
+  ddict_ = Handle<ZSTD_DDict, DDictDrop>(
+      ZSTD_createDDict(dict_.data(), dict_.size()), DDictDrop{});
+  cctx_ = Handle<ZSTD_CCtx, CCtxDrop>(ZSTD_createCCtx(), CCtxDrop{});
+  dctx_ = Handle<ZSTD_DCtx, DCtxDrop>(ZSTD_createDCtx(), DCtxDrop{});
+  if (!cdict_ || !ddict_ || !cctx_ || !dctx_) {
+    std::cerr << "ContentCodec: cannot load dictionary " << id_ << '\n';
+    cdict_.reset();
+    ddict_.reset();
+  }
+}
+
+std::string ContentCodec::train(const std::vector<std::string_view> &texts,
+                                Config cfg) {
+  std::string samples;
+  std::vector<std::size_t> sizes;
+  for (std::string_view text : texts) {
+    while (!text.empty()) {
+      std::size_t n = std::min(text.size(), kSampleBytes);
+      if (n < text.size()) {
+        const auto nl = text.rfind('\n', n);
+        if (nl != std::string_view::npos && nl > 0)
+          n = nl + 1;
+      }
+      samples.append(text.substr(0, n));
+      sizes.push_back(n);
+      text.remove_prefix(n);
+    }
+  }
+
+  const std::size_t capacity =
+      std::min(cfg.dictBytes, samples.size() / kSamplesPerDictByte);
+  if (capacity < kMinDictBytes)
+    return {};
+  std::string dict(capacity, '\0');
+  const std::size_t n =
+      ZDICT_trainFromBuffer(dict.data(), dict.size(), samples.data(),
+                            sizes.data(), static_cast<unsigned>(sizes.size()));
+  if (ZDICT_isError(n)) {
+    std::cerr << "ContentCodec: training failed: " << ZDICT_getErrorName(n)
+              << '\n';
+    return {};
+  }
+  dict.resize(n);
+  return dict;
+}
+
+std::optional<PackedContent>
+ContentCodec::pack(std::string_view content) const {
+  // what unpack() would refuse (invalid UTF-8 can have more bytes than
+  // code points allow) stays plain
+  const std::uint64_t chars = codePoints(content);
+  if (!isValid() || content.size() > kMaxContentBytes ||
+      content.size() > chars * kMaxBytesPerChar)
+    return std::nullopt;
+  PackedContent out{id_, std::string(ZSTD_compressBound(content.size()), '\0'),
+                    chars};
+  std::size_t n = 0;
+  {
+    std::lock_guard lock(m_);
+    n = ZSTD_compress_usingCDict(cctx_.get(), out.bytes.data(),
+                                 out.bytes.size(), content.data(),
+                                 content.size(), cdict_.get());
+  }
+  if (ZSTD_isError(n)) {
+    std::cerr << "ContentCodec: cannot pack a section: "
+              << ZSTD_getErrorName(n) << '\n';
+    return std::nullopt;
+  }
+  out.bytes.resize(n);
+  return out;
+}
+
+std::optional<std::string>
+ContentCodec::unpack(const PackedContent &packed) const {
+  if (packed.dict != id_ || !isValid())
+    return std::nullopt;
+  // the frame header is as untrusted as the rest of the stored row: its
+  // size is checked before anything is allocated for it
+  const auto size =
+      ZSTD_getFrameContentSize(packed.bytes.data(), packed.bytes.size());
+  if (size == ZSTD_CONTENTSIZE_ERROR || size == ZSTD_CONTENTSIZE_UNKNOWN ||
+      size > kMaxContentBytes || size > packed.chars * kMaxBytesPerChar)
+    return std::nullopt;
+  std::string out(size, '\0');
+  std::lock_guard lock(m_);
+  const std::size_t n =
+      ZSTD_decompress_usingDDict(dctx_.get(), out.data(), out.size(),
+                                 packed.bytes.data(), packed.bytes.size(),
+                                 ddict_.get());
+  if (ZSTD_isError(n) || n != out.size())
+    return std::nullopt;
+  return out;
+}
+
+#else // built without zstd: nothing is packed or unpacked
+
+ContentCodec::ContentCodec(std::string dict, Config)
+    : dict_(std::move(dict)), id_(ContentStore::id(dict_)) {}
+
+std::string ContentCodec::train(const std::vector<std::string_view> &,
+                                Config) {
+  std::cerr << "ContentCodec: built without zstd\n";
+  return {};
+}
+
+std::optional<PackedContent> ContentCodec::pack(std::string_view) const {
+  return std::nullopt;
+}
+
+std::optional<std::string> ContentCodec::unpack(const PackedContent &) const {
+  return std::nullopt;
+}
+
+#endif
@@ -0,0 +1,89 @@
+#include "content_store.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <sstream>
+
+#include "bundle.hpp"
+#include "utils.hpp"
+
+std::optional<std::string_view> sectionText(std::string_view text,
+                                            const SectionRef &ref) {
+  if (ref.offset > text.size() || ref.length > text.size() - ref.offset)
+    return std::nullopt;
+  return text.substr(ref.offset, ref.length);
+}
+
+std::string ContentStore::id(std::string_view text) {
+  return id(Hash::fnv1a(text), text.size());
+}
+
+std::string ContentStore::id(std::uint64_t fnv1a, std::uint64_t size) {
+  return Hash::hex(fnv1a) + '-' + std::to_string(size);
+}
+
+bool ContentStore::put(std::string_view text,
+                       const std::filesystem::path &source) {
+  const std::string key = id(text);
+  if (bundle_)
+    return bundle_->put(std::string(kBundlePrefix) + key, text);
+
+  const auto dest = path(key);
+  std::error_code ec;
+  if (std::filesystem::exists(dest, ec))
+    return true;
+  // a source that no longer holds text (rewritten since) is not linked
+  if (!source.empty() && std::filesystem::file_size(source, ec) == text.size()
+      && !ec) {
+    std::filesystem::create_directories(dir_, ec);
+    std::filesystem::create_hard_link(source, dest, ec);
+    if (!ec)
+      return true;
+  }
+  return FileIO::writeText(dest, text);
+}
+
+std::optional<std::string> ContentStore::get(std::string_view id) const {
+  if (bundle_)
+    return bundle_->read(std::string(kBundlePrefix) + std::string(id));
+
+  std::ifstream is(path(id), std::ios::binary);
+  if (!is)
+    return std::nullopt;
+  std::ostringstream text;
+  text << is.rdbuf();
+  return std::move(text).str();
+}
+
+std::size_t ContentStore::prune(const std::set<std::string> &keep) {
+  std::size_t removed = 0;
+  if (bundle_) {
+    for (const auto &blob : bundle_->list(kBundlePrefix))
+      if (!keep.contains(blob.substr(kBundlePrefix.size()))) {
+        bundle_->remove(blob);
+        ++removed;
+      }
+    return removed;
+  }
+
+  std::error_code ec;
+  for (const auto &entry : std::filesystem::directory_iterator(dir_, ec)) {
+    const auto &file = entry.path();
+    if (file.extension() == ".txt" && !keep.contains(file.stem().string()) &&
+        std::filesystem::remove(file, ec))
+      ++removed;
+  }
+  return removed;
+}
+
+std::optional<std::string> ContentStore::resolve(const SectionRef &ref) const {
+  const auto text = get(ref.blob);
+  if (!text) {
+    std::cerr << "ContentStore: blob " << ref.blob << " not found\n";
+    return std::nullopt;
+  }
+  const auto range = sectionText(*text, ref);
+  if (!range)
+    return std::nullopt;
+  return std::string(*range);
+}
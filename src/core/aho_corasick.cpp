@@ -0,0 +1,65 @@
+#include "core/aho_corasick.hpp"
+
+#include <queue>
+
+AhoCorasick::AhoCorasick(const std::vector<std::string> &patterns) {
+  for (const auto &p : patterns) {
+    if (p.empty())
+      continue;
+    ++patterns_;
+    for (unsigned char c : p)
+      if (class_[c] == 0)
+        class_[c] = classes_++;
+  }
+
+  // trie; -1 = no edge yet
+  const auto cls = static_cast<std::size_t>(classes_);
+  delta_.assign(cls, -1);
+  out_.emplace_back();
+  for (int i = 0; i < static_cast<int>(patterns.size()); ++i) {
+    if (patterns[i].empty())
+      continue;
+    int s = kRoot;
+    for (unsigned char c : patterns[i]) {
+      int &edge = delta_[static_cast<std::size_t>(s) * cls + class_[c]];
+      if (edge < 0) {
+        edge = static_cast<int>(out_.size());
+        out_.emplace_back();
+        delta_.resize(delta_.size() + cls, -1);
+      }
+      s = delta_[static_cast<std::size_t>(s) * cls + class_[c]];
+    }
+    out_[s].push_back(i);
+  }
+
+  // BFS: fill missing edges from the failure state, link outputs
+  const std::size_t states = out_.size();
+  std::vector<int> fail(states, kRoot);
+  dict_.assign(states, kRoot);
+  std::queue<int> q;
+  for (std::size_t c = 0; c < cls; ++c) {
+    int &edge = delta_[c];
+    if (edge < 0) {
+      edge = kRoot;
+    } else {
+      q.push(edge);
+    }
+  }
+  while (!q.empty()) {
+    const int s = q.front();
+    q.pop();
+    const std::size_t row = static_cast<std::size_t>(s) * cls;
+    for (std::size_t c = 0; c < cls; ++c) {
+      int &edge = delta_[row + c];
+      const int viaFail =
+          delta_[static_cast<std::size_t>(fail[s]) * cls + c];
+      if (edge < 0) {
+        edge = viaFail;
+        continue;
+      }
+      fail[edge] = viaFail;
+      dict_[edge] = out_[viaFail].empty() ? dict_[viaFail] : viaFail;
+      q.push(edge);
+    }
+  }
+}
@@ -0,0 +1,104 @@
+#include "core/approx_matcher.hpp"
+
+#include <algorithm>
+
+#include "text_simd.hpp"
+
+ApproxMatcher::ApproxMatcher(const std::vector<std::string> &patterns,
+                             const std::vector<int> &maxErrors) {
+  std::size_t lane = kLanes;
+  for (std::size_t i = 0; i < patterns.size(); ++i) {
+    const std::string &p = patterns[i];
+    // deleting the whole pattern would match every line
+    const int budget = std::min(maxErrors[i], static_cast<int>(p.size()) - 1);
+    if (p.empty() || p.size() > kMaxPattern || budget <= 0)
+      continue; // exact search already has the answer
+    if (lane == kLanes) {
+      groups_.emplace_back();
+      lane = 0;
+    }
+    Group &g = groups_.back();
+    g.pattern[lane] = static_cast<int>(i);
+    g.length[lane] = static_cast<int>(p.size());
+    g.budget[lane] = budget;
+    g.high[lane] = std::uint64_t{1} << (p.size() - 1);
+    for (std::size_t j = 0; j < p.size(); ++j)
+      g.peq[static_cast<unsigned char>(p[j])][lane] |= std::uint64_t{1} << j;
+    ++lane;
+  }
+}
+
+unsigned ApproxMatcher::scan(const Group &g, std::string_view text,
+                             unsigned active) {
+  std::array<std::uint64_t, kLanes> pv, mv{};
+  std::array<int, kLanes> score;
+  pv.fill(~std::uint64_t{0});
+  score = g.length;
+
+  unsigned hits = 0;
+  for (unsigned char c : text) {
+    const auto &eq = g.peq[c];
+    std::array<int, kLanes> ok{};
+    for (std::size_t l = 0; l < kLanes; ++l) {
+      const std::uint64_t xv = eq[l] | mv[l];
+      const std::uint64_t xh = (((eq[l] & pv[l]) + pv[l]) ^ pv[l]) | eq[l];
+      std::uint64_t ph = mv[l] | ~(xh | pv[l]);
+      std::uint64_t mh = pv[l] & xh;
+      score[l] += ((ph & g.high[l]) != 0) - ((mh & g.high[l]) != 0);
+      // search variant: the top row stays 0, so nothing is shifted in
+      ph <<= 1;
+      mh <<= 1;
+      pv[l] = mh | ~(xv | ph);
+      mv[l] = ph & xv;
+      ok[l] = score[l] <= g.budget[l];
+    }
+    for (std::size_t l = 0; l < kLanes; ++l)
+      hits |= static_cast<unsigned>(ok[l]) << l;
+    if ((hits & active) == active)
+      break;
+  }
+  return hits & active;
+}
+
+void ApproxMatcher::firstLines(const std::vector<std::string_view> &lines,
+                               const std::vector<int> *candidates,
+                               std::vector<int> &first) const {
+  if (groups_.empty())
+    return;
+
+  std::string collapsed;
+  auto visit = [&](int lineIndex) {
+    bool ready = false; // collapse only if some lane still needs this line
+    for (const Group &g : groups_) {
+      // lanes still waiting for a line before their current first
+      unsigned active = 0;
+      for (std::size_t l = 0; l < kLanes; ++l) {
+        const int p = g.pattern[l];
+        if (p >= 0 && (first[p] < 0 || first[p] > lineIndex))
+          active |= 1u << l;
+      }
+      if (!active)
+        continue;
+      if (!ready) {
+        const std::string_view raw = lines[lineIndex];
+        collapsed.resize(raw.size());
+        collapsed.resize(TextSimd::collapseWhitespace(
+            raw.data(), raw.size(), collapsed.data()));
+        ready = true;
+      }
+      const unsigned hits = scan(g, collapsed, active);
+      for (std::size_t l = 0; l < kLanes; ++l)
+        if (hits & (1u << l))
+          first[g.pattern[l]] = lineIndex;
+    }
+  };
+
+  if (candidates) {
+    for (int lineIndex : *candidates)
+      visit(lineIndex);
+  } else {
+    for (int lineIndex = 0; lineIndex < static_cast<int>(lines.size());
+         ++lineIndex)
+      visit(lineIndex);
+  }
+}
@@ -8,16 +8,17 @@ ChapterIndex::indexChapters(const std::vector<std::string> &tocLines,
                             int startFrom) const {
   std::vector<int> positions(files.size(), -1);
   int cursor = startFrom;
+  const TrigramIndex toc(tocLines);
 
   for (std::size_t k = 0; k < files.size(); ++k) {
     const std::string &key = files[k].key;
 
-    int found = findFirstTocMatch(tocLines, key, cursor);
+    int found = findFirstTocMatch(toc, key, cursor);
 
     if (found < 0) {
       const std::string noThe = stripLeadingThe(key);
       if (noThe.size() != key.size()) {
-        found = findFirstTocMatch(tocLines, noThe, cursor);
+        found = findFirstTocMatch(toc, noThe, cursor);
       }
     }
 
@@ -28,14 +29,9 @@ ChapterIndex::indexChapters(const std::vector<std::string> &tocLines,
   return positions;
 }
 
-int ChapterIndex::findFirstTocMatch(const std::vector<std::string> &tocLines,
+int ChapterIndex::findFirstTocMatch(const TrigramIndex &toc,
                                     const std::string &key, int startAt) const {
-  for (int i = startAt; i < static_cast<int>(tocLines.size()); ++i) {
-    const std::string &ln = tocLines[i];
-    if (!ln.empty() && ln.find(key) != std::string::npos)
-      return i;
-  }
-  return -1;
+  return toc.findFirst(key, startAt);
 }
 
 std::string ChapterIndex::stripLeadingThe(const std::string &key) {
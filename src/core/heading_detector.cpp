@@ -0,0 +1,64 @@
+#include "core/heading_detector.hpp"
+
+#include <cmath>
+#include <map>
+#include <string>
+#include <unordered_set>
+
+#include "utils.hpp"
+
+float HeadingDetector::bodySize(
+    const std::vector<std::optional<PageLayout>> &layouts) const {
+  // half-point buckets -> glyph count
+  std::map<int, long> glyphs;
+  for (const auto &page : layouts) {
+    if (!page)
+      continue;
+    for (const auto &ln : page->lines)
+      glyphs[static_cast<int>(std::lround(ln.size * 2.f))] += ln.glyphs;
+  }
+  int best = 0;
+  long bestCount = -1;
+  for (auto [bucket, count] : glyphs) {
+    if (count > bestCount) {
+      best = bucket;
+      bestCount = count;
+    }
+  }
+  return static_cast<float>(best) / 2.f;
+}
+
+bool HeadingDetector::isHeading(const LineStyle &line,
+                                float bodySize) const noexcept {
+  const std::string_view text = Text::trimView(line.text);
+  if (text.empty() || text.size() > cfg_.maxChars || !Text::hasLetters(text))
+    return false;
+  if (line.size >= bodySize * cfg_.sizeRatio)
+    return true;
+  return line.bold && line.size >= bodySize;
+}
+
+std::vector<int> HeadingDetector::candidates(
+    const std::vector<std::string_view> &chapterLines,
+    const std::vector<std::optional<PageLayout>> &layouts) const {
+  const float body = bodySize(layouts);
+
+  std::unordered_set<std::string_view> headings;
+  for (const auto &page : layouts) {
+    if (!page)
+      continue;
+    for (const auto &ln : page->lines) {
+      if (isHeading(ln, body))
+        headings.insert(Text::trimView(ln.text));
+    }
+  }
+
+  std::vector<int> out;
+  if (headings.empty())
+    return out;
+  for (int i = 0; i < static_cast<int>(chapterLines.size()); ++i) {
+    if (headings.count(Text::trimView(chapterLines[i])))
+      out.push_back(i);
+  }
+  return out;
+}
@@ -1,41 +1,113 @@
 #include "core/matcher.hpp"
+#include "core/aho_corasick.hpp"
+#include "core/approx_matcher.hpp"
+#include "core/noise_filter.hpp"
 #include "utils.hpp"
 #include <algorithm>
+#include <cctype>
+
+namespace {
+
+// Feeds line to the automaton as Text::collapseWhitespace would see it and
+// records the first line each pattern occurs in. Patterns never start or end
+// with a space, so the collapsed form needs no trimming here.
+void scanLine(const AhoCorasick &ac, std::string_view line, int lineIndex,
+              std::vector<int> &first, std::size_t &left) {
+  int state = AhoCorasick::kRoot;
+  bool inSpace = false;
+  for (unsigned char ch : line) {
+    if (std::isspace(ch)) {
+      inSpace = true;
+      continue;
+    }
+    if (inSpace) {
+      state = ac.next(state, ' ');
+      inSpace = false;
+    }
+    state = ac.next(state, ch);
+    ac.forEachMatch(state, [&](int p) {
+      if (first[p] < 0) {
+        first[p] = lineIndex;
+        --left;
+      }
+    });
+  }
+}
+
+} // namespace
 
 std::vector<std::pair<int, int>>
 Matcher::matchIndices(const std::vector<std::string> &tocLines,
-                      const std::vector<std::string> &chapterLines,
+                      const std::vector<std::string_view> &chapterLines,
                       const std::string &chapterTitle) const {
-  std::vector<std::pair<int, int>> matches;
+  return match(tocLines, chapterLines, chapterTitle, nullptr);
+}
 
+std::vector<std::pair<int, int>>
+Matcher::matchIndices(const std::vector<std::string> &tocLines,
+                      const std::vector<std::string_view> &chapterLines,
+                      const std::string &chapterTitle,
+                      const std::vector<int> &candidates) const {
+  return match(tocLines, chapterLines, chapterTitle, &candidates);
+}
+
+std::vector<std::pair<int, int>>
+Matcher::match(const std::vector<std::string> &tocLines,
+               const std::vector<std::string_view> &chapterLines,
+               const std::string &chapterTitle,
+               const std::vector<int> *candidates) const {
+  // patterns[k] belongs to tocLines[tocIds[k]]
+  std::vector<int> tocIds;
+  std::vector<std::string> patterns;
+  const NoiseFilter noise(chapterTitle);
   for (int tocIndex = 0; tocIndex < static_cast<int>(tocLines.size());
        ++tocIndex) {
     const std::string &line = tocLines[tocIndex];
-    if (skipLine(line, chapterTitle))
+    if (noise.isNoisy(line))
+      continue;
+    std::string pattern =
+        Text::collapseWhitespace(Title::stripLeadingThe(line));
+    if (pattern.empty())
       continue;
+    tocIds.push_back(tocIndex);
+    patterns.push_back(std::move(pattern));
+  }
 
-    const int lineIndex = firstMatch(chapterLines, line);
-    if (lineIndex >= 0) {
-      matches.emplace_back(tocIndex, lineIndex);
+  std::vector<int> first(patterns.size(), -1);
+  std::size_t left = patterns.size();
+  const AhoCorasick ac(patterns);
+  if (candidates) {
+    for (int lineIndex : *candidates) {
+      if (left == 0)
+        break;
+      scanLine(ac, chapterLines[lineIndex], lineIndex, first, left);
     }
+  } else {
+    for (int lineIndex = 0;
+         left > 0 && lineIndex < static_cast<int>(chapterLines.size());
+         ++lineIndex)
+      scanLine(ac, chapterLines[lineIndex], lineIndex, first, left);
   }
-  std::sort(matches.begin(), matches.end(), byChapterLine);
-  return matches;
-}
 
-bool Matcher::skipLine(const std::string &line,
-                       const std::string &chapterTitle) const {
-  return Title::isNoisy(line, chapterTitle);
-}
+  // approximate pass: can only move a pattern's first line earlier, and
+  // never looks past its exact match
+  if (cfg_.maxErrors > 0) {
+    std::vector<int> budgets(patterns.size());
+    for (std::size_t k = 0; k < patterns.size(); ++k)
+      budgets[k] = std::min(cfg_.maxErrors,
+                            static_cast<int>(patterns[k].size()) /
+                                std::max(1, cfg_.charsPerError));
+    ApproxMatcher(patterns, budgets).firstLines(chapterLines, candidates,
+                                                first);
+  }
 
-int Matcher::firstMatch(const std::vector<std::string> &chapterLines,
-                        const std::string &line) const {
-  for (int lineIndex = 0; lineIndex < static_cast<int>(chapterLines.size());
-       ++lineIndex) {
-    if (Title::isSubtitleMatch(line, chapterLines[lineIndex]))
-      return lineIndex;
+  std::vector<std::pair<int, int>> matches;
+  for (std::size_t k = 0; k < patterns.size(); ++k) {
+    if (first[k] >= 0)
+      matches.emplace_back(tocIds[k], first[k]);
   }
-  return -1;
+  std::sort(matches.begin(), matches.end(), byChapterLine);
+  return matches;
 }
 
 bool Matcher::byChapterLine(const std::pair<int, int> &a,
@@ -0,0 +1,63 @@
+#include "core/noise_filter.hpp"
+
+#include <vector>
+
+#include "utils.hpp"
+
+namespace {
+
+std::vector<std::string> patterns(const std::string &chapterTitle) {
+  std::vector<std::string> v{chapterTitle};
+  for (auto w : Title::kBannedWords)
+    v.emplace_back(w);
+  return v;
+}
+
+constexpr bool isSpace(unsigned char c) noexcept {
+  return c == ' ' || (c >= '\t' && c <= '\r');
+}
+constexpr bool isUpper(unsigned char c) noexcept {
+  return c >= 'A' && c <= 'Z';
+}
+constexpr bool isLower(unsigned char c) noexcept {
+  return c >= 'a' && c <= 'z';
+}
+
+} // namespace
+
+NoiseFilter::NoiseFilter(const std::string &chapterTitle)
+    : words_(patterns(chapterTitle)), everyLine_(chapterTitle.empty()) {}
+
+bool NoiseFilter::isNoisy(std::string_view line) const noexcept {
+  if (everyLine_)
+    return true;
+
+  int state = AhoCorasick::kRoot;
+  bool inSpace = false;
+  unsigned char prev = 0;
+  int letters = 0, uppers = 0;
+  for (unsigned char c : line) {
+    if ((c == ')' && prev == '(') || (c == '/' && prev == '/'))
+      return true;
+    prev = c;
+
+    if (isSpace(c)) {
+      inSpace = true;
+      continue;
+    }
+    if (inSpace) {
+      state = words_.next(state, ' ');
+      inSpace = false;
+    }
+    const bool upper = isUpper(c);
+    letters += upper || isLower(c);
+    uppers += upper;
+    state = words_.next(state, upper ? c | 0x20 : c);
+    if (words_.hasMatch(state))
+      return true; // chapter name or banned word
+  }
+
+  if (letters == 0)
+    return true;
+  return static_cast<double>(uppers) / letters >= Title::kUpperRatioCap;
+}
@@ -0,0 +1,81 @@
+#include "core/trigram_index.hpp"
+
+#include <algorithm>
+
+TrigramIndex::TrigramIndex(std::vector<std::string> lines)
+    : lines_(std::move(lines)) {
+  for (int i = 0; i < static_cast<int>(lines_.size()); ++i) {
+    const std::string_view ln = lines_[i];
+    for (std::size_t j = 0; j + 3 <= ln.size(); ++j) {
+      auto &list = postings_[trigram(ln, j)];
+      if (list.empty() || list.back() != i) // lines arrive in order
+        list.push_back(i);
+    }
+  }
+}
+
+std::vector<const std::vector<int> *>
+TrigramIndex::postings(std::string_view needle) const {
+  std::vector<const std::vector<int> *> lists;
+  for (std::size_t j = 0; j + 3 <= needle.size(); ++j) {
+    auto it = postings_.find(trigram(needle, j));
+    if (it == postings_.end())
+      return {};
+    lists.push_back(&it->second);
+  }
+  std::sort(lists.begin(), lists.end(), [](const auto *a, const auto *b) {
+    return a->size() < b->size();
+  });
+  lists.erase(std::unique(lists.begin(), lists.end()), lists.end());
+  return lists;
+}
+
+bool TrigramIndex::inAll(const std::vector<const std::vector<int> *> &lists,
+                         int i) {
+  for (std::size_t k = 1; k < lists.size(); ++k) {
+    if (!std::binary_search(lists[k]->begin(), lists[k]->end(), i))
+      return false;
+  }
+  return true;
+}
+
+int TrigramIndex::findFirst(std::string_view needle, int startAt) const {
+  if (startAt < 0)
+    startAt = 0;
+  if (needle.size() < 3) {
+    for (int i = startAt; i < size(); ++i)
+      if (matches(i, needle))
+        return i;
+    return -1;
+  }
+
+  const auto lists = postings(needle);
+  if (lists.empty())
+    return -1;
+  const auto &base = *lists.front();
+  for (auto it = std::lower_bound(base.begin(), base.end(), startAt);
+       it != base.end(); ++it) {
+    if (inAll(lists, *it) && matches(*it, needle))
+      return *it;
+  }
+  return -1;
+}
+
+std::vector<int> TrigramIndex::findAll(std::string_view needle) const {
+  std::vector<int> out;
+  if (needle.size() < 3) {
+    for (int i = 0; i < size(); ++i)
+      if (matches(i, needle))
+        out.push_back(i);
+    return out;
+  }
+
+  const auto lists = postings(needle);
+  if (lists.empty())
+    return out;
+  for (int i : *lists.front()) {
+    if (inAll(lists, i) && matches(i, needle))
+      out.push_back(i);
+  }
+  return out;
+}
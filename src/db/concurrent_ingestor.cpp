@@ -0,0 +1,152 @@
+#include "db/concurrent_ingestor.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+#include "bounded_queue.hpp"
+#include "db/ingestor.hpp"
+
+namespace {
+
+struct ParsedChapter {
+  std::filesystem::path file;
+  std::vector<SectionRow> rows;
+};
+
+// nearest-rank percentile of sorted values
+double percentile(const std::vector<double> &sorted, double p) {
+  if (sorted.empty())
+    return 0.0;
+  const auto rank = static_cast<std::size_t>(
+      std::ceil(p * static_cast<double>(sorted.size())));
+  return sorted[std::clamp<std::size_t>(rank, 1, sorted.size()) - 1];
+}
+
+} // namespace
+
+ConcurrentIngestor::ConcurrentIngestor(Connect connect,
+                                       const ContentStore *blobs, Config cfg)
+    : connect_(std::move(connect)), blobs_(blobs), cfg_(cfg) {
+  cfg_.parsers = std::max(cfg_.parsers, 1u);
+  cfg_.writers = std::max(cfg_.writers, 1u);
+}
+
+ConcurrentIngestor::Stats
+ConcurrentIngestor::ingest(const std::vector<std::filesystem::path> &files,
+                           const std::vector<std::string> &chapters,
+                           const std::filesystem::path &pdfPath,
+                           const BookTitle &book) {
+  Stats stats;
+  const auto t0 = std::chrono::steady_clock::now();
+
+  // connect first, before any thread starts; writers that get no
+  // connection (a pool with none left throws) are not started
+  std::vector<std::unique_ptr<Repository>> repos;
+  try {
+    for (unsigned i = 0; i < cfg_.writers; ++i)
+      if (auto repo = connect_())
+        repos.push_back(std::move(repo));
+  } catch (const std::exception &e) {
+    std::cerr << "ingest: writer connection " << repos.size() + 1 << " of "
+              << cfg_.writers << ": " << e.what() << '\n';
+  }
+  if (repos.empty()) {
+    std::cerr << "ingest: no repository connection\n";
+    stats.failed = files.size();
+    return stats;
+  }
+  if (repos.size() < cfg_.writers)
+    std::cerr << "ingest: writing on " << repos.size() << " connections\n";
+  // indexes once, not once per connection
+  repos.front()->ensure_ready();
+
+  // one query for the whole book; every writer starts from a copy
+  auto known = repos.front()->sectionHashes(book.value);
+
+  BoundedQueue<ParsedChapter> queue(cfg_.queueDepth);
+  std::atomic<std::size_t> next{0};
+  std::atomic<unsigned> parsing{cfg_.parsers};
+  std::mutex statsMutex;
+
+  auto parse = [&] {
+    for (std::size_t i = next++; i < files.size(); i = next++) {
+      auto rows = Ingestor::read_rows(files[i]);
+      if (!rows) {
+        std::lock_guard lock(statsMutex);
+        ++stats.failed;
+        continue;
+      }
+      if (!queue.push({files[i], std::move(*rows)}))
+        break;
+    }
+    // the last parser out lets the writers drain and stop
+    if (--parsing == 0)
+      queue.close();
+  };
+
+  auto write = [&](Repository &repo) {
+    Ingestor ingestor(repo, blobs_);
+    if (known)
+      ingestor.assumeStored(book.value, *known);
+    while (auto chapter = queue.pop()) {
+      IngestCounts counts{.total = chapter->rows.size(), .ok = false};
+      try {
+        counts = ingestor.ingest_rows(chapter->file.filename().string(),
+                                      chapter->rows, pdfPath, book);
+      } catch (const std::exception &e) {
+        std::cerr << "ingest: " << chapter->file << ": " << e.what() << '\n';
+      }
+      std::lock_guard lock(statsMutex);
+      stats.changed += counts.changed;
+      stats.sections += counts.total;
+      stats.latencies.insert(stats.latencies.end(), counts.batchMillis.begin(),
+                             counts.batchMillis.end());
+      if (counts.ok)
+        stats.ingested.push_back(chapter->file);
+      else
+        ++stats.failed;
+    }
+  };
+
+  {
+    std::vector<std::jthread> threads;
+    for (auto &repo : repos)
+      threads.emplace_back(write, std::ref(*repo));
+    for (unsigned i = 0; i < cfg_.parsers; ++i)
+      threads.emplace_back(parse);
+  }
+
+  Ingestor pruner(*repos.front(), blobs_);
+  if (known) {
+    pruner.assumeStored(book.value, std::move(*known));
+    pruner.removeMissingChapters(book, chapters);
+  }
+  // every writer has finished, so no text is waiting for its sections
+  pruner.pruneTexts(stats.changed > 0);
+
+  stats.seconds = std::chrono::duration<double>(
+                      std::chrono::steady_clock::now() - t0)
+                      .count();
+  return stats;
+}
+
+void ConcurrentIngestor::report(const Stats &stats, std::ostream &os) {
+  auto sorted = stats.latencies;
+  std::sort(sorted.begin(), sorted.end());
+  const double rate =
+      stats.seconds > 0 ? static_cast<double>(stats.sections) / stats.seconds
+                        : 0.0;
+  os << "◆ ingest: " << stats.sections << " sections in " << std::fixed
+     << std::setprecision(2) << stats.seconds << "s (" << std::setprecision(0)
+     << rate << " sections/s); bulk write p50 " << std::setprecision(1)
+     << percentile(sorted, 0.50) << " ms, p99 " << percentile(sorted, 0.99)
+     << " ms, max " << (sorted.empty() ? 0.0 : sorted.back()) << " ms over "
+     << sorted.size() << (sorted.size() == 1 ? " batch\n" : " batches\n")
+     << std::defaultfloat;
+}
@@ -1,12 +1,50 @@
 #include "db/ingestor.hpp"
 
+#include <algorithm>
+#include <deque>
 #include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <set>
+#include <sstream>
 
 #include "pdf/metadata.hpp"
 #include "utils.hpp"
 
+// Every field a section document holds, so equal hashes mean an upsert
+// would change nothing. Bump the tag when the document layout changes.
+// The chapter's fields come first and are hashed once per chapter; the
+// state after them seeds the hash of each of its sections.
+static void hashField(std::uint64_t &h, std::string_view field) {
+  h = Hash::fnv1a(field, h);
+  h = Hash::fnv1a(std::string_view("\0", 1), h);
+}
+
+static std::uint64_t originHash(const ChapterFields &c) {
+  std::uint64_t h = Hash::fnv1a("section-record/1");
+  for (const std::string *f : {&c.book_title, &c.book_title_src, &c.book_path,
+                               &c.chapter_file, &c.chapter, &c.chapter_title})
+    hashField(h, *f);
+  return h;
+}
+
+static std::uint64_t recordHash(const Record &r, std::uint64_t origin) {
+  std::uint64_t h = origin;
+  hashField(h, std::to_string(r.section_index));
+  hashField(h, r.title);
+  hashField(h, std::to_string(r.startline));
+  hashField(h, std::to_string(r.endline));
+  hashField(h, r.content);
+  hashField(h, r.content_blob);
+  hashField(h, std::to_string(r.content_offset));
+  hashField(h, std::to_string(r.content_length));
+  hashField(h, r.content_z);
+  hashField(h, r.content_dict);
+  hashField(h, std::to_string(r.content_codec));
+  hashField(h, std::to_string(r.content_chars));
+  return h;
+}
+
 static nlohmann::json read_json_file(const std::filesystem::path &p) {
   std::ifstream is(p);
   if (!is)
@@ -16,58 +54,272 @@ static nlohmann::json read_json_file(const std::filesystem::path &p) {
   return j;
 }
 
-Ingestor::Ingestor(Repository &repo) : repo_(&repo) {}
+Ingestor::Ingestor(Repository &repo, const ContentStore *blobs)
+    : repo_(&repo), blobs_(blobs) {}
 
-std::pair<std::size_t, std::size_t>
-Ingestor::ingest_chapter_file(const std::filesystem::path &jsonPath,
-                              const std::filesystem::path &pdfPath,
-                              const BookTitle &book) {
+std::optional<std::vector<SectionRow>>
+Ingestor::read_rows(const std::filesystem::path &jsonPath) {
   nlohmann::json j;
   try {
     j = read_json_file(jsonPath);
   } catch (const std::exception &e) {
     std::cerr << "ingest_chapter_file: " << e.what() << '\n';
-    return {0, 0};
+    return std::nullopt;
   }
   if (!j.is_array()) {
     std::cerr << "ingest_chapter_file: JSON is not an array: " << jsonPath
               << '\n';
-    return {0, 0};
+    return std::nullopt;
+  }
+
+  std::vector<SectionRow> rows;
+  rows.reserve(j.size());
+  for (const auto &item : j) {
+    SectionRow row{
+        .title = item.value("title", ""),
+        .startline = item.value("startline", 0),
+        .endline = item.value("endline", 0),
+        .content = item.value("content", ""),
+        .ref = {item.value("blob", ""), item.value("offset", std::uint64_t{}),
+                item.value("length", std::uint64_t{})},
+        .packed = {}};
+    if (item.contains("packed")) {
+      auto bytes = Base64::decode(item.value("packed", ""));
+      if (item.value("codec", 0) != ContentCodec::kVersion || !bytes) {
+        std::cerr << "ingest_chapter_file: unsupported packed content in "
+                  << jsonPath << '\n';
+        return std::nullopt;
+      }
+      row.packed = {item.value("dict", ""), std::move(*bytes),
+                    item.value("chars", std::uint64_t{})};
+    }
+    rows.push_back(std::move(row));
+  }
+  return rows;
+}
+
+IngestCounts
+Ingestor::ingest_chapter_file(const std::filesystem::path &jsonPath,
+                              const std::filesystem::path &pdfPath,
+                              const BookTitle &book) {
+  const auto rows = read_rows(jsonPath);
+  if (!rows)
+    return {.changed = 0, .total = 0, .ok = false};
+  return ingest_rows(jsonPath.filename().string(), *rows, pdfPath, book);
+}
+
+IngestCounts
+Ingestor::ingest_rows(const std::string &chapterFile,
+                      const std::vector<SectionRow> &rows,
+                      const std::filesystem::path &pdfPath,
+                      const BookTitle &book, std::string_view text,
+                      const ContentCodec *codec) {
+  // the text referenced rows point into
+  std::string fetched;
+  std::string_view blobText;
+  std::string blob;
+  for (const auto &row : rows) {
+    if (row.ref.blob.empty() || row.ref.blob == blob)
+      continue;
+    if (!blob.empty()) {
+      std::cerr << "ingest_rows: " << chapterFile
+                << " references more than one text\n";
+      return {.changed = 0, .total = rows.size(), .ok = false};
+    }
+    blob = row.ref.blob;
+    if (!text.empty() && ContentStore::id(text) == blob) {
+      blobText = text;
+    } else if (auto got = blobs_ ? blobs_->get(blob) : std::nullopt) {
+      fetched = std::move(*got);
+      blobText = fetched;
+    } else {
+      std::cerr << "ingest_rows: text " << blob << " of " << chapterFile
+                << " not found\n";
+      return {.changed = 0, .total = rows.size(), .ok = false};
+    }
   }
 
-  const std::string chapterFile = jsonPath.filename().string();
-  const std::string chapterStem = jsonPath.stem().string();
-  const std::string chapterTitle = Title::extractChapterTitle(chapterFile);
+  // the dictionary packed rows were made with
+  const ContentCodec *unpacker = nullptr;
+  for (const auto &row : rows) {
+    if (row.packed.dict.empty())
+      continue;
+    unpacker = codecFor(row.packed.dict, codec);
+    if (!unpacker) {
+      std::cerr << "ingest_rows: dictionary " << row.packed.dict << " of "
+                << chapterFile << " not found\n";
+      return {.changed = 0, .total = rows.size(), .ok = false};
+    }
+    break;
+  }
+
+  const std::string chapterStem =
+      std::filesystem::path(chapterFile).stem().string();
+  const auto origin = std::make_shared<const ChapterFields>(ChapterFields{
+      .book_title = book.value,
+      .book_title_src =
+          book.fromMetadata ? ("metadata:" + book.source) : "filename",
+      .book_path = pdfPath.string(),
+      .chapter_file = chapterFile,
+      .chapter = chapterStem,
+      .chapter_title = Title::extractChapterTitle(chapterFile)});
+  const std::uint64_t originSeed = originHash(*origin);
 
-  std::size_t changed = 0;
-  const std::size_t total = j.size();
+  const std::size_t total = rows.size();
+  std::vector<Record> recs;
+  recs.reserve(rows.size());
 
+  // every row in the form it was stored in, viewing the row's strings;
+  // whether the repository can take that form is only asked if a changed
+  // section needs it
+  bool complete = true; // every section written or unchanged
   int section_index = 0;
-  for (const auto &item : j) {
+  for (const auto &row : rows) {
     Record rec;
-    rec.book_title = book.value;
-    rec.book_title_src =
-        book.fromMetadata ? ("metadata:" + book.source) : "filename";
-    rec.book_path = pdfPath.string();
+    rec.origin = origin;
+    rec.section_index = section_index++;
+    rec.title = row.title;
+    rec.startline = row.startline;
+    rec.endline = row.endline;
+    if (!row.packed.dict.empty()) {
+      if (row.packed.dict != unpacker->id()) {
+        std::cerr << "ingest_rows: section " << row.title << " of "
+                  << chapterFile << " cannot be unpacked\n";
+        complete = false;
+        continue;
+      }
+      rec.content_z = row.packed.bytes;
+      rec.content_dict = row.packed.dict;
+      rec.content_codec = ContentCodec::kVersion;
+      rec.content_chars = row.packed.chars;
+    } else if (row.ref.blob.empty()) {
+      rec.content = row.content;
+    } else if (sectionText(blobText, row.ref)) {
+      rec.content_blob = row.ref.blob;
+      rec.content_offset = row.ref.offset;
+      rec.content_length = row.ref.length;
+    } else {
+      std::cerr << "ingest_rows: section " << row.title << " of "
+                << chapterFile << " lies outside its text\n";
+      complete = false;
+      continue;
+    }
+    rec.content_hash = recordHash(rec, originSeed);
+    recs.push_back(std::move(rec));
+  }
+
+  // a title seen twice is one document, and the last row is what it holds
+  {
+    std::set<std::string_view> seen;
+    std::vector<bool> shadowed(recs.size());
+    for (std::size_t i = recs.size(); i-- > 0;)
+      shadowed[i] = !seen.insert(recs[i].title).second;
+    std::vector<Record> last;
+    for (std::size_t i = 0; i < recs.size(); ++i)
+      if (!shadowed[i])
+        last.push_back(std::move(recs[i]));
+    recs = std::move(last);
+  }
+
+  const SectionHashes *known = stored(book.value);
+  const auto unchanged = [&](const Record &r) {
+    if (!known)
+      return false;
+    const auto it = known->find({chapterStem, std::string(r.title)});
+    return it != known->end() && it->second == r.content_hash;
+  };
+  std::erase_if(recs, unchanged);
 
-    rec.chapter_file = chapterFile;
-    rec.chapter = chapterStem;
-    rec.chapter_title = chapterTitle;
+  // the stored text and dictionary, if changed sections refer to them
+  const bool refs = std::ranges::any_of(
+      recs, [](const Record &r) { return !r.content_blob.empty(); });
+  if (refs && !repo_->putText(blob, blobText)) {
+    for (auto &rec : recs) {
+      if (rec.content_blob.empty())
+        continue;
+      const SectionRef ref{std::string(rec.content_blob), rec.content_offset,
+                           rec.content_length};
+      rec.content = *sectionText(blobText, ref);
+      rec.content_blob = {};
+      rec.content_offset = rec.content_length = 0;
+      rec.content_hash = recordHash(rec, originSeed);
+    }
+  }
+  const bool packed = std::ranges::any_of(
+      recs, [](const Record &r) { return !r.content_dict.empty(); });
+  std::deque<std::string> unpacked; // what plain records view
+  if (packed && !storeDictionary(*unpacker)) {
+    std::erase_if(recs, [&](Record &rec) {
+      if (rec.content_dict.empty())
+        return false;
+      auto plain = unpacker->unpack({std::string(rec.content_dict),
+                                     std::string(rec.content_z),
+                                     rec.content_chars});
+      if (!plain) {
+        std::cerr << "ingest_rows: section " << rec.title << " of "
+                  << chapterFile << " cannot be unpacked\n";
+        complete = false;
+        return true;
+      }
+      rec.content = unpacked.emplace_back(std::move(*plain));
+      rec.content_z = rec.content_dict = {};
+      rec.content_codec = 0;
+      rec.content_chars = 0;
+      rec.content_hash = recordHash(rec, originSeed);
+      return false;
+    });
+  }
+  // sections turned plain may be stored plain already
+  std::erase_if(recs, unchanged);
 
-    rec.section_index = section_index;
-    rec.title = item.value("title", "");
-    rec.startline = item.value("startline", 0);
-    rec.endline = item.value("endline", 0);
-    rec.content = item.value("content", "");
+  // the chapter's changed sections in as few round trips as the repository
+  // allows
+  std::size_t upserted = 0, modified = 0, batches = 0, failed = 0;
+  std::vector<double> batchMillis;
+  if (!recs.empty()) {
+    for (const auto &counts : repo_->upsertMany(recs)) {
+      upserted += counts.upserted;
+      modified += counts.modified;
+      ++batches;
+      failed += counts.failed;
+      batchMillis.push_back(counts.millis);
+    }
+  }
+  const std::size_t changed = upserted + modified;
 
-    if (repo_->upsert(rec))
-      ++changed;
-    ++section_index;
+  // sections the chapter no longer has
+  std::vector<std::string> gone;
+  if (known) {
+    std::set<std::string_view> titles;
+    for (const auto &row : rows)
+      titles.insert(row.title);
+    for (auto it = known->lower_bound({chapterStem, ""});
+         it != known->end() && it->first.first == chapterStem; ++it)
+      if (!titles.contains(it->first.second))
+        gone.push_back(it->first.second);
   }
+  const std::size_t removed =
+      gone.empty() ? 0 : repo_->removeSections(book.value, chapterStem, gone);
+  remember(recs, failed == 0);
+  if (removed == gone.size())
+    forget(chapterStem, gone);
+  complete = complete && failed == 0 && removed == gone.size();
 
-  std::cout << "DB: upserted/updated " << changed << " / " << total
-            << " sections for " << chapterFile << '\n';
-  return {changed, total};
+  // one write, so lines from concurrent ingestors do not interleave
+  std::ostringstream line;
+  line << "DB: upserted/updated " << changed << " / " << total
+       << " sections for " << chapterFile << " (" << upserted << " new, "
+       << modified << " modified, " << total - recs.size() << " unchanged, "
+       << removed << " removed, " << batches
+       << (batches == 1 ? " batch" : " batches");
+  if (failed)
+    line << ", " << failed << " failed";
+  line << ")\n";
+  std::cout << line.str();
+  return {.changed = changed,
+          .total = total,
+          .ok = complete,
+          .batchMillis = std::move(batchMillis)};
 }
 
 int Ingestor::ingest_directory(const std::filesystem::path &outDir,
@@ -81,24 +333,162 @@ int Ingestor::ingest_directory(const std::filesystem::path &outDir,
   std::size_t total_files = 0;
   std::size_t total_changed = 0;
   std::size_t total_sections = 0;
+  std::size_t failed = 0;
+  std::vector<std::string> chapters;
 
   for (const auto &e : std::filesystem::directory_iterator(outDir)) {
     if (!e.is_regular_file() || e.path().extension() != ".json")
       continue;
     ++total_files;
 
-    auto [changed, total] = ingest_chapter_file(e.path(), pdfPath, book);
-    total_changed += changed;
-    total_sections += total;
+    const auto counts = ingest_chapter_file(e.path(), pdfPath, book);
+    total_changed += counts.changed;
+    total_sections += counts.total;
+    failed += !counts.ok;
+    chapters.push_back(e.path().stem().string());
   }
 
   if (total_files == 0) {
     std::cerr << "ingest_directory: no JSON files found in " << outDir << "\n";
     return 2;
   }
+  removeMissingChapters(book, chapters);
+  pruneTexts();
 
   std::cout << "DB summary: upserted/updated " << total_changed << " / "
             << total_sections << " sections across " << total_files
             << " chapter files.\n";
-  return 0;
+  return failed ? kIncomplete : 0;
+}
+
+int Ingestor::ingest_segments(const std::vector<ChapterSegments> &segments,
+                              const std::filesystem::path &pdfPath,
+                              const BookTitle &book) {
+  if (segments.empty()) {
+    std::cerr << "ingest_segments: no chapter segments to ingest\n";
+    return 2;
+  }
+
+  std::size_t total_changed = 0;
+  std::size_t total_sections = 0;
+  std::size_t failed = 0;
+  std::vector<std::string> chapters;
+  for (const auto &seg : segments) {
+    const auto counts = ingest_rows(seg.file, seg.rows, pdfPath, book,
+                                    seg.text, seg.codec.get());
+    total_changed += counts.changed;
+    total_sections += counts.total;
+    failed += !counts.ok;
+    chapters.push_back(std::filesystem::path(seg.file).stem().string());
+  }
+  removeMissingChapters(book, chapters);
+  pruneTexts();
+
+  std::cout << "DB summary: upserted/updated " << total_changed << " / "
+            << total_sections << " sections across " << segments.size()
+            << " chapters.\n";
+  return failed ? kIncomplete : 0;
+}
+
+std::size_t
+Ingestor::removeMissingChapters(const BookTitle &book,
+                                const std::vector<std::string> &chapters) {
+  const SectionHashes *known = stored(book.value);
+  if (!known)
+    return 0;
+  const std::set<std::string_view> keep(chapters.begin(), chapters.end());
+  std::vector<std::string> gone;
+  for (const auto &[key, hash] : *known)
+    if (!keep.contains(key.first) && (gone.empty() || gone.back() != key.first))
+      gone.push_back(key.first);
+
+  std::size_t removed = 0;
+  for (const auto &chapter : gone) {
+    const std::size_t n = repo_->removeSections(book.value, chapter, {});
+    if (n > 0)
+      forget(chapter, {});
+    removed += n;
+  }
+  if (removed > 0)
+    std::cout << "DB: removed " << removed << " sections of " << gone.size()
+              << " chapters no longer in the book\n";
+  return removed;
+}
+
+void Ingestor::assumeStored(const std::string &book, SectionHashes hashes) {
+  storedBook_ = book;
+  stored_ = std::move(hashes);
+}
+
+std::size_t Ingestor::pruneTexts(bool wrote) {
+  if (!rewrote_ && !wrote)
+    return 0;
+  rewrote_ = false;
+  const std::size_t removed = repo_->pruneTexts();
+  if (removed > 0)
+    std::cout << "DB: removed " << removed
+              << " texts and dictionaries no section refers to\n";
+  return removed;
+}
+
+const SectionHashes *Ingestor::stored(const std::string &book) {
+  if (storedBook_ != book) {
+    stored_ = repo_->sectionHashes(book);
+    storedBook_ = book;
+  }
+  return stored_ ? &*stored_ : nullptr;
+}
+
+void Ingestor::remember(const std::vector<Record> &written, bool ok) {
+  rewrote_ = rewrote_ || !written.empty();
+  if (!stored_)
+    return;
+  for (const auto &r : written) {
+    // a failed batch leaves the section unknown: written again next time
+    std::pair key{r.origin->chapter, std::string(r.title)};
+    if (ok)
+      (*stored_)[std::move(key)] = r.content_hash;
+    else
+      stored_->erase(key);
+  }
+}
+
+void Ingestor::forget(const std::string &chapter,
+                      const std::vector<std::string> &titles) {
+  rewrote_ = true;
+  if (!stored_)
+    return;
+  if (titles.empty()) {
+    std::erase_if(*stored_,
+                  [&](const auto &e) { return e.first.first == chapter; });
+    return;
+  }
+  for (const auto &title : titles)
+    stored_->erase({chapter, title});
+}
+
+const ContentCodec *Ingestor::codecFor(const std::string &dict,
+                                       const ContentCodec *codec) {
+  if (codec && codec->id() == dict)
+    return codec;
+  auto it = codecs_.find(dict);
+  if (it == codecs_.end()) {
+    auto bytes = blobs_ ? blobs_->get(dict) : std::nullopt;
+    auto loaded = bytes ? std::make_unique<ContentCodec>(std::move(*bytes))
+                        : nullptr;
+    if (loaded && !loaded->isValid())
+      loaded.reset();
+    it = codecs_.emplace(dict, std::move(loaded)).first;
+  }
+  return it->second.get();
+}
+
+bool Ingestor::storeDictionary(const ContentCodec &codec) {
+  auto it = dictStored_.find(codec.id());
+  if (it == dictStored_.end())
+    it = dictStored_
+             .emplace(codec.id(),
+                      repo_->putDictionary(codec.id(), codec.dictionary()))
+             .first;
+  return it->second;
 }
@@ -1,14 +1,32 @@
 
 #include "db/mongo_repo.hpp"
 
+#include <algorithm>
+#include <bsoncxx/builder/basic/document.hpp>
+#include <bsoncxx/builder/basic/kvp.hpp>
 #include <bsoncxx/builder/stream/document.hpp>
+#include <bsoncxx/types.hpp>
+#include <chrono>
 #include <iostream>
+#include <mongocxx/bulk_write.hpp>
+#include <mongocxx/exception/bulk_write_exception.hpp>
+#include <mongocxx/model/update_one.hpp>
+#include <mongocxx/options/bulk_write.hpp>
+#include <mongocxx/options/find.hpp>
 #include <mongocxx/options/index.hpp>
 #include <mongocxx/options/update.hpp>
+#include <mongocxx/pipeline.hpp>
+#include <mongocxx/write_concern.hpp>
+#include <stdexcept>
 
+#include "content_codec.hpp"
+#include "utils.hpp"
+
+using bsoncxx::builder::stream::close_array;
 using bsoncxx::builder::stream::close_document;
 using bsoncxx::builder::stream::document;
 using bsoncxx::builder::stream::finalize;
+using bsoncxx::builder::stream::open_array;
 using bsoncxx::builder::stream::open_document;
 
 static void ensure_unique_index(mongocxx::collection &coll) {
@@ -24,6 +42,18 @@ static void ensure_unique_index(mongocxx::collection &coll) {
   }
 }
 
+// what pruneTexts() looks sections up by
+static void ensure_ref_index(mongocxx::collection &coll, const char *field) {
+  auto keys = document{} << field << 1 << finalize;
+  mongocxx::options::index opts;
+  opts.name(std::string(field) + "_v1");
+  try {
+    coll.create_index(keys.view(), opts);
+  } catch (const std::exception &e) {
+    std::cerr << "ensure_ref_index: " << e.what() << '\n';
+  }
+}
+
 mongocxx::instance &MongoRepository::driver() {
   static mongocxx::instance inst{};
   return inst;
@@ -34,37 +64,327 @@ MongoRepository::MongoRepository(const MongoConfig &cfg) : cfg_(cfg) {
   (void)driver();
   client_ = mongocxx::client{mongocxx::uri{cfg_.uri}};
   coll_ = client_[cfg_.db][cfg_.coll];
+  texts_ = client_[cfg_.db][cfg_.texts];
+  dicts_ = client_[cfg_.db][cfg_.dicts];
   ensure_ready();
 }
 
+// acquire() would wait for a connection that may never be returned
+static mongocxx::pool::entry take_connection(mongocxx::pool &pool) {
+  auto entry = pool.try_acquire();
+  if (!entry)
+    throw std::runtime_error("Mongo connection pool exhausted (maxPoolSize)");
+  return std::move(*entry);
+}
+
+MongoRepository::MongoRepository(mongocxx::pool &pool, const MongoConfig &cfg)
+    : cfg_(cfg), pooled_(take_connection(pool)) {
+  auto &client = *pooled_;
+  coll_ = client[cfg_.db][cfg_.coll];
+  texts_ = client[cfg_.db][cfg_.texts];
+  dicts_ = client[cfg_.db][cfg_.dicts];
+}
+
 MongoRepository::~MongoRepository() = default;
 
-void MongoRepository::ensure_ready() { ensure_unique_index(coll_); }
+std::unique_ptr<mongocxx::pool>
+MongoRepository::makePool(const MongoConfig &cfg) {
+  (void)driver();
+  return std::make_unique<mongocxx::pool>(mongocxx::uri{cfg.uri});
+}
+
+unsigned MongoRepository::maxPoolSize(const MongoConfig &cfg) {
+  constexpr std::int32_t kDriverDefault = 100;
+  const auto size = mongocxx::uri{cfg.uri}.max_pool_size();
+  return static_cast<unsigned>(std::max(size.value_or(kDriverDefault), 1));
+}
+
+void MongoRepository::ensure_ready() {
+  ensure_unique_index(coll_);
+  ensure_ref_index(coll_, "content_blob");
+  ensure_ref_index(coll_, "content_dict");
+}
+
+static mongocxx::write_concern write_concern(const MongoConfig &cfg) {
+  mongocxx::write_concern wc;
+  if (cfg.w == MongoConfig::kMajority)
+    wc.majority(std::chrono::milliseconds{0});
+  else if (cfg.w == 0)
+    wc.acknowledge_level(mongocxx::write_concern::level::k_unacknowledged);
+  else
+    wc.nodes(cfg.w);
+  wc.journal(cfg.journal);
+  return wc;
+}
+
+// The counts of an unordered batch that failed in part, from the server's
+// reply. Without one, or with a write concern error, none of the writes can
+// be relied on.
+static WriteCounts partial_counts(const mongocxx::bulk_write_exception &ex,
+                                  std::size_t ops) {
+  WriteCounts counts;
+  counts.failed = ops;
+  const auto &reply = ex.raw_server_error();
+  if (!reply)
+    return counts;
+  const auto doc = reply->view();
+  const auto count = [&](std::string_view key) -> std::size_t {
+    const auto e = doc[key];
+    if (!e)
+      return 0;
+    if (e.type() == bsoncxx::type::k_int32)
+      return static_cast<std::size_t>(e.get_int32().value);
+    if (e.type() == bsoncxx::type::k_int64)
+      return static_cast<std::size_t>(e.get_int64().value);
+    return 0;
+  };
+  const auto entries = [&](std::string_view key) -> std::size_t {
+    const auto e = doc[key];
+    if (!e || e.type() != bsoncxx::type::k_array)
+      return 0;
+    std::size_t n = 0;
+    for (const auto &item : e.get_array().value) {
+      (void)item;
+      ++n;
+    }
+    return n;
+  };
+  if (entries("writeConcernErrors") > 0)
+    return counts;
+  counts.upserted = count("nUpserted");
+  counts.modified = count("nModified");
+  counts.failed = std::min(entries("writeErrors"), ops);
+  return counts;
+}
 
 bool MongoRepository::upsert(const Record &r) {
   mongocxx::options::update opts;
   opts.upsert(true);
-
-  auto filter = document{} << "book_title" << r.book_title << "chapter"
-                           << r.chapter << "title" << r.title << finalize;
-
-  auto update =
-      document{} << "$set" << open_document << "book_title" << r.book_title
-                 << "book_title_src" << r.book_title_src << "book_path"
-                 << r.book_path << "chapter_file" << r.chapter_file << "chapter"
-                 << r.chapter << "chapter_title" << r.chapter_title
-                 << "section_index" << r.section_index << "title" << r.title
-                 << "startline" << r.startline << "endline" << r.endline
-                 << "content" << r.content << close_document << finalize;
+  bson_.encode(r);
 
   try {
-    auto res = coll_.update_one(filter.view(), update.view(), opts);
+    auto res = coll_.update_one(bson_.filter(), bson_.update(), opts);
     if (!res)
       return false;
     return (res->modified_count() > 0) || bool(res->upserted_id());
   } catch (const std::exception &ex) {
-    std::cerr << "Mongo upsert failed for [" << r.chapter_file << " | "
-              << r.title << "]: " << ex.what() << '\n';
+    std::cerr << "Mongo upsert failed for [" << r.origin->chapter_file
+              << " | " << r.title << "]: " << ex.what() << '\n';
+    return false;
+  }
+}
+
+// Unordered, so one bad record does not stop the rest of its batch and the
+// server may apply the batch in parallel.
+std::vector<WriteCounts>
+MongoRepository::upsertMany(std::span<const Record> recs) {
+  mongocxx::options::bulk_write opts;
+  opts.ordered(false);
+  opts.write_concern(write_concern(cfg_));
+
+  const std::size_t batch = std::max<std::size_t>(cfg_.batchSize, 1);
+  std::vector<WriteCounts> out;
+  for (std::size_t at = 0; at < recs.size(); at += batch) {
+    const auto part = recs.subspan(at, std::min(batch, recs.size() - at));
+    // append() copies the documents into the pending batch, so the
+    // encoder's buffers can take the next record
+    auto bulk = coll_.create_bulk_write(opts);
+    for (const auto &r : part) {
+      bson_.encode(r);
+      mongocxx::model::update_one op{bson_.filter(), bson_.update()};
+      op.upsert(true);
+      bulk.append(op);
+    }
+
+    WriteCounts counts;
+    const auto start = std::chrono::steady_clock::now();
+    try {
+      // empty when the write concern is unacknowledged
+      if (const auto res = coll_.bulk_write(bulk)) {
+        counts.upserted = static_cast<std::size_t>(res->upserted_count());
+        counts.modified = static_cast<std::size_t>(res->modified_count());
+      }
+    } catch (const mongocxx::bulk_write_exception &ex) {
+      // unordered: the server ran every write it could and says which failed
+      counts = partial_counts(ex, part.size());
+      std::cerr << "Mongo bulk upsert: " << counts.failed << " of "
+                << part.size() << " sections from ["
+                << part.front().origin->chapter_file
+                << "] failed: " << ex.what() << '\n';
+    } catch (const std::exception &ex) {
+      std::cerr << "Mongo bulk upsert of " << part.size() << " sections from ["
+                << part.front().origin->chapter_file
+                << "] failed: " << ex.what() << '\n';
+      counts.failed = part.size();
+    }
+    counts.millis = std::chrono::duration<double, std::milli>(
+                        std::chrono::steady_clock::now() - start)
+                        .count();
+    out.push_back(counts);
+  }
+  return out;
+}
+
+// Only the key and the hash come back, so the answer stays small even for a
+// large book; sections written before hashes were stored come back with 0
+// and are written again.
+std::optional<SectionHashes>
+MongoRepository::sectionHashes(const std::string &book_title) {
+  auto filter = document{} << "book_title" << book_title << finalize;
+  auto projection = document{} << "_id" << 0 << "chapter" << 1 << "title" << 1
+                               << "content_hash" << 1 << finalize;
+  mongocxx::options::find opts;
+  opts.projection(projection.view());
+
+  SectionHashes out;
+  try {
+    for (const auto &doc : coll_.find(filter.view(), opts)) {
+      const auto chapter = doc["chapter"];
+      const auto title = doc["title"];
+      if (!chapter || !title || chapter.type() != bsoncxx::type::k_string ||
+          title.type() != bsoncxx::type::k_string)
+        continue;
+      std::uint64_t hash = 0;
+      if (const auto h = doc["content_hash"];
+          h && h.type() == bsoncxx::type::k_string) {
+        try {
+          hash = std::stoull(std::string(h.get_string().value), nullptr, 16);
+        } catch (const std::exception &) {
+        }
+      }
+      out.emplace(std::pair{std::string(chapter.get_string().value),
+                            std::string(title.get_string().value)},
+                  hash);
+    }
+  } catch (const std::exception &ex) {
+    std::cerr << "Mongo sectionHashes failed for " << book_title << ": "
+              << ex.what() << '\n';
+    return std::nullopt;
+  }
+  return out;
+}
+
+std::size_t
+MongoRepository::removeSections(const std::string &book_title,
+                                const std::string &chapter,
+                                std::span<const std::string> titles) {
+  using bsoncxx::builder::basic::kvp;
+  using bsoncxx::builder::basic::sub_array;
+  using bsoncxx::builder::basic::sub_document;
+
+  bsoncxx::builder::basic::document filter;
+  filter.append(kvp("book_title", book_title), kvp("chapter", chapter));
+  if (!titles.empty())
+    filter.append(kvp("title", [&](sub_document in) {
+      in.append(kvp("$in", [&](sub_array list) {
+        for (const auto &t : titles)
+          list.append(t);
+      }));
+    }));
+  try {
+    const auto res = coll_.delete_many(filter.view());
+    return res ? static_cast<std::size_t>(res->deleted_count()) : 0;
+  } catch (const std::exception &ex) {
+    std::cerr << "Mongo removeSections failed for [" << chapter
+              << "]: " << ex.what() << '\n';
+    return 0;
+  }
+}
+
+// The ids in items that no section of the collection named sections holds
+// in field. Each lookup is one probe of field's index, stopped at the first
+// section found.
+static std::vector<std::string> unreferenced(mongocxx::collection &items,
+                                             const std::string &sections,
+                                             const std::string &field) {
+  auto lookup = document{} << "from" << sections << "let" << open_document
+                           << "id" << "$_id" << close_document << "pipeline"
+                           << open_array << open_document << "$match"
+                           << open_document << "$expr" << open_document
+                           << "$eq" << open_array << "$" + field << "$$id"
+                           << close_array << close_document << close_document
+                           << close_document << open_document << "$limit" << 1
+                           << close_document << close_array << "as" << "refs"
+                           << finalize;
+  auto none = document{} << "refs" << open_document << "$size" << 0
+                         << close_document << finalize;
+  auto id = document{} << "_id" << 1 << finalize;
+  mongocxx::pipeline stages;
+  stages.lookup(lookup.view()).match(none.view()).project(id.view());
+
+  std::vector<std::string> out;
+  for (const auto &doc : items.aggregate(stages))
+    if (const auto v = doc["_id"]; v && v.type() == bsoncxx::type::k_string)
+      out.emplace_back(v.get_string().value);
+  return out;
+}
+
+static std::size_t remove_ids(mongocxx::collection &items,
+                              std::span<const std::string> ids) {
+  using bsoncxx::builder::basic::kvp;
+  using bsoncxx::builder::basic::sub_array;
+  using bsoncxx::builder::basic::sub_document;
+  constexpr std::size_t kPerDelete = 1000;
+
+  std::size_t removed = 0;
+  for (std::size_t i = 0; i < ids.size(); i += kPerDelete) {
+    const auto part = ids.subspan(i, std::min(kPerDelete, ids.size() - i));
+    bsoncxx::builder::basic::document filter;
+    filter.append(kvp("_id", [&](sub_document in) {
+      in.append(kvp("$in", [&](sub_array list) {
+        for (const auto &id : part)
+          list.append(id);
+      }));
+    }));
+    const auto res = items.delete_many(filter.view());
+    removed += res ? static_cast<std::size_t>(res->deleted_count()) : 0;
+  }
+  return removed;
+}
+
+// Texts and dictionaries are shared by content across books, so one goes
+// only when no section of any book names it.
+std::size_t MongoRepository::pruneTexts() {
+  try {
+    return remove_ids(texts_, unreferenced(texts_, cfg_.coll, "content_blob")) +
+           remove_ids(dicts_, unreferenced(dicts_, cfg_.coll, "content_dict"));
+  } catch (const std::exception &ex) {
+    std::cerr << "Mongo pruneTexts failed: " << ex.what() << '\n';
+    return 0;
+  }
+}
+
+// Texts are content-addressed, so one already stored is never rewritten.
+bool MongoRepository::putText(const std::string &id, std::string_view text) {
+  mongocxx::options::update opts;
+  opts.upsert(true);
+  auto filter = document{} << "_id" << id << finalize;
+  auto update = document{} << "$setOnInsert" << open_document << "text"
+                           << bsoncxx::types::b_string{text} << close_document
+                           << finalize;
+  try {
+    return bool(texts_.update_one(filter.view(), update.view(), opts));
+  } catch (const std::exception &ex) {
+    std::cerr << "Mongo putText failed for " << id << ": " << ex.what()
+              << '\n';
+    return false;
+  }
+}
+
+bool MongoRepository::putDictionary(const std::string &id,
+                                    std::string_view dict) {
+  mongocxx::options::update opts;
+  opts.upsert(true);
+  auto filter = document{} << "_id" << id << finalize;
+  auto update = document{} << "$setOnInsert" << open_document << "dict"
+                           << bsonBinary(dict) << "codec"
+                           << ContentCodec::kVersion << close_document
+                           << finalize;
+  try {
+    return bool(dicts_.update_one(filter.view(), update.view(), opts));
+  } catch (const std::exception &ex) {
+    std::cerr << "Mongo putDictionary failed for " << id << ": " << ex.what()
+              << '\n';
     return false;
   }
 }
@@ -0,0 +1,79 @@
+#include "db/section_bson.hpp"
+
+#include <span>
+#include <string_view>
+
+#include "utils.hpp"
+
+namespace {
+
+// a section holds its content, a reference or packed content, and never a
+// stale copy of another form
+constexpr std::string_view kNotRef[] = {
+    "content", "content_z", "content_dict", "content_codec", "content_chars"};
+constexpr std::string_view kNotPacked[] = {
+    "content", "content_blob", "content_offset", "content_length"};
+constexpr std::string_view kNotPlain[] = {
+    "content_blob", "content_offset", "content_length", "content_z",
+    "content_dict", "content_codec",  "content_chars"};
+
+} // namespace
+
+void SectionBson::encodeOrigin() {
+  prefix_.clear();
+  prefix_.key_view("book_title").append(std::string_view(origin_->book_title));
+  prefix_.key_view("book_title_src")
+      .append(std::string_view(origin_->book_title_src));
+  prefix_.key_view("book_path").append(std::string_view(origin_->book_path));
+  prefix_.key_view("chapter_file")
+      .append(std::string_view(origin_->chapter_file));
+  prefix_.key_view("chapter").append(std::string_view(origin_->chapter));
+  prefix_.key_view("chapter_title")
+      .append(std::string_view(origin_->chapter_title));
+}
+
+void SectionBson::encode(const Record &r) {
+  if (r.origin != origin_) {
+    origin_ = r.origin;
+    encodeOrigin();
+  }
+
+  filter_.clear();
+  filter_.key_view("book_title").append(std::string_view(origin_->book_title));
+  filter_.key_view("chapter").append(std::string_view(origin_->chapter));
+  filter_.key_view("title").append(r.title);
+
+  update_.clear();
+  update_.key_view("$set").open_document();
+  update_.concatenate(prefix_.view_document());
+  update_.key_view("section_index").append(std::int32_t{r.section_index});
+  update_.key_view("title").append(r.title);
+  update_.key_view("startline").append(std::int32_t{r.startline});
+  update_.key_view("endline").append(std::int32_t{r.endline});
+  update_.key_view("content_hash")
+      .append(std::string_view(Hash::hex(r.content_hash)));
+  std::span<const std::string_view> unset = kNotPlain;
+  if (!r.content_blob.empty()) {
+    update_.key_view("content_blob").append(r.content_blob);
+    update_.key_view("content_offset")
+        .append(static_cast<std::int64_t>(r.content_offset));
+    update_.key_view("content_length")
+        .append(static_cast<std::int64_t>(r.content_length));
+    unset = kNotRef;
+  } else if (!r.content_dict.empty()) {
+    update_.key_view("content_z").append(bsonBinary(r.content_z));
+    update_.key_view("content_dict").append(r.content_dict);
+    update_.key_view("content_codec").append(std::int32_t{r.content_codec});
+    update_.key_view("content_chars")
+        .append(static_cast<std::int64_t>(r.content_chars));
+    unset = kNotPacked;
+  } else {
+    update_.key_view("content").append(r.content);
+  }
+  update_.close_document();
+
+  update_.key_view("$unset").open_document();
+  for (std::string_view field : unset)
+    update_.key_view(field).append(std::string_view{});
+  update_.close_document();
+}
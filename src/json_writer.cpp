@@ -0,0 +1,158 @@
+#include "json_writer.hpp"
+
+#include <charconv>
+
+namespace {
+
+// Bytes of the UTF-8 sequence at s[i]. valid if it is well-formed;
+// otherwise the longest prefix of one that s holds there (at least the one
+// byte), which nlohmann's decoder also replaces with a single U+FFFD before
+// starting again at the byte that broke it.
+std::size_t utf8Length(std::string_view s, std::size_t i,
+                       bool &valid) noexcept {
+  const auto at = [&](std::size_t k) {
+    return static_cast<unsigned char>(s[k]);
+  };
+  valid = false;
+  const unsigned char c = at(i);
+  std::size_t n = 0;
+  unsigned char lo = 0x80, hi = 0xBF; // range of the second byte
+  if (c >= 0xC2 && c <= 0xDF) {
+    n = 2;
+  } else if (c >= 0xE0 && c <= 0xEF) {
+    n = 3;
+    if (c == 0xE0)
+      lo = 0xA0;
+    else if (c == 0xED)
+      hi = 0x9F; // no surrogates
+  } else if (c >= 0xF0 && c <= 0xF4) {
+    n = 4;
+    if (c == 0xF0)
+      lo = 0x90;
+    else if (c == 0xF4)
+      hi = 0x8F;
+  } else {
+    return 1;
+  }
+  std::size_t k = 1;
+  if (i + 1 < s.size() && at(i + 1) >= lo && at(i + 1) <= hi) {
+    k = 2;
+    while (k < n && i + k < s.size() && (at(i + k) & 0xC0) == 0x80)
+      ++k;
+  }
+  valid = k == n;
+  return k;
+}
+
+constexpr bool plain(unsigned char c) noexcept {
+  return c >= 0x20 && c < 0x80 && c != '"' && c != '\\';
+}
+
+} // namespace
+
+JsonWriter::JsonWriter(std::ostream &os, Config cfg)
+    : os_(os), cfg_(cfg) {
+  buf_.reserve(cfg_.bufferBytes + 256);
+}
+
+void JsonWriter::escape(std::string &out, std::string_view s) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  out.push_back('"');
+  std::size_t i = 0;
+  while (i < s.size()) {
+    // copy the longest run that needs no escaping in one go
+    std::size_t j = i;
+    while (j < s.size() && plain(static_cast<unsigned char>(s[j])))
+      ++j;
+    out.append(s.data() + i, j - i);
+    if (j == s.size())
+      break;
+    i = j;
+
+    const auto c = static_cast<unsigned char>(s[i]);
+    if (c >= 0x80) {
+      bool valid = false;
+      const std::size_t n = utf8Length(s, i, valid);
+      if (valid)
+        out.append(s.data() + i, n);
+      else
+        out += "\xEF\xBF\xBD";
+      i += n;
+      continue;
+    }
+    out.push_back('\\');
+    switch (c) {
+    case '"': out.push_back('"'); break;
+    case '\\': out.push_back('\\'); break;
+    case '\b': out.push_back('b'); break;
+    case '\f': out.push_back('f'); break;
+    case '\n': out.push_back('n'); break;
+    case '\r': out.push_back('r'); break;
+    case '\t': out.push_back('t'); break;
+    default:
+      out += "u00";
+      out.push_back(kHex[c >> 4]);
+      out.push_back(kHex[c & 0xF]);
+    }
+    ++i;
+  }
+  out.push_back('"');
+}
+
+void JsonWriter::element() {
+  if (afterKey_) {
+    afterKey_ = false;
+    return;
+  }
+  if (counts_.empty())
+    return;
+  if (counts_.back()++ > 0)
+    buf_.push_back(',');
+  if (cfg_.pretty) {
+    buf_.push_back('\n');
+    buf_.append(2 * counts_.size(), ' ');
+  }
+}
+
+void JsonWriter::open(char bracket) {
+  element();
+  buf_.push_back(bracket);
+  counts_.push_back(0);
+}
+
+void JsonWriter::close(char bracket) {
+  const bool empty = counts_.back() == 0;
+  counts_.pop_back();
+  if (cfg_.pretty && !empty) {
+    buf_.push_back('\n');
+    buf_.append(2 * counts_.size(), ' ');
+  }
+  buf_.push_back(bracket);
+  maybeFlush();
+}
+
+void JsonWriter::key(std::string_view k) {
+  element();
+  escape(buf_, k);
+  buf_ += cfg_.pretty ? ": " : ":";
+  afterKey_ = true;
+}
+
+void JsonWriter::value(std::string_view s) {
+  element();
+  escape(buf_, s);
+  maybeFlush();
+}
+
+void JsonWriter::value(std::int64_t n) {
+  element();
+  char digits[24];
+  buf_.append(digits, std::to_chars(digits, digits + sizeof digits, n).ptr);
+}
+
+void JsonWriter::flush() {
+  if (buf_.empty())
+    return;
+  os_.write(buf_.data(), static_cast<std::streamsize>(buf_.size()));
+  buf_.clear();
+}
@@ -0,0 +1,79 @@
+#include "line_table.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <limits>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+void MunmapDrop::operator()(char *p) const noexcept {
+  if (p)
+    munmap(p, size);
+}
+
+LineTable::LineTable(const std::filesystem::path &p) {
+  const int fd = ::open(p.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "LineTable: cannot open " << p << ": " << std::strerror(errno)
+              << '\n';
+    return;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0) {
+    std::cerr << "LineTable: cannot stat " << p << '\n';
+    ::close(fd);
+    return;
+  }
+  const auto bytes = static_cast<std::size_t>(st.st_size);
+  if (bytes > 0) {
+    void *m = mmap(nullptr, bytes, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m == MAP_FAILED) {
+      std::cerr << "LineTable: cannot map " << p << ": "
+                << std::strerror(errno) << '\n';
+      ::close(fd);
+      return;
+    }
+    madvise(m, bytes, MADV_SEQUENTIAL);
+    map_ = Handle<char, MunmapDrop>(static_cast<char *>(m),
+                                    MunmapDrop{bytes});
+  }
+  ::close(fd);
+  index(bytes);
+}
+
+void LineTable::index(std::size_t bytes) {
+  if (bytes >= std::numeric_limits<std::uint32_t>::max()) {
+    std::cerr << "LineTable: " << bytes << " bytes is too large\n";
+    return;
+  }
+  const char *p = base();
+  const char *end = p + bytes;
+
+  std::size_t n = 0;
+  for (const char *q = p; (q = static_cast<const char *>(
+                               std::memchr(q, '\n', end - q))) != nullptr;
+       ++q)
+    ++n;
+  const bool tail = bytes > 0 && end[-1] != '\n';
+  offsets_.reserve(n + tail + 1);
+
+  bytes_ = bytes;
+  offsets_.push_back(0);
+  for (const char *q = p; q < end;) {
+    const char *nl = static_cast<const char *>(std::memchr(q, '\n', end - q));
+    const char *stop = nl ? nl : end;
+    offsets_.push_back(static_cast<std::uint32_t>(stop - p + 1));
+    q = stop + 1;
+  }
+  valid_ = true;
+}
+
+std::vector<std::string_view> LineTable::views() const {
+  std::vector<std::string_view> v;
+  v.reserve(size());
+  for (std::size_t i = 0; i < size(); ++i)
+    v.push_back(line(i));
+  return v;
+}
@@ -1,80 +1,204 @@
+#include <algorithm>
+#include <array>
+#include <chrono>
 #include <filesystem>
 #include <iostream>
+#include <memory>
+#include <optional>
+#include <set>
+#include <string_view>
 #include <vector>
 
+#include "chapters.hpp"
+#include "cli.hpp"
+#include "content_codec.hpp"
+#include "content_store.hpp"
+#include "line_table.hpp"
+#include "db/concurrent_ingestor.hpp"
 #include "db/ingestor.hpp"
 #include "db/mongo_conf.hpp"
 #include "db/mongo_repo.hpp"
+#include "bundle.hpp"
+#include "pdf/memory_budget.hpp"
 #include "pdf/metadata.hpp"
+#include "pdf/page_text.hpp"
 #include "pdf/session.hpp"
+#include "pipeline/arrow_export.hpp"
+#include "pipeline/batch.hpp"
+#include "pipeline/book.hpp"
+#include "pipeline/book_bundle.hpp"
 #include "pipeline/catalog.hpp"
 #include "pipeline/extract_chapters.hpp"
+#include "pipeline/manifest.hpp"
 #include "pipeline/section_writer.hpp"
 #include "pipeline/slice_toc.hpp"
 #include "types.hpp"
 #include "utils.hpp"
 // ───────────────────────────  CONSTANTS  ──────────────────────────
-static const std::filesystem::path kChaptersDir{"chapters"};
-static const std::filesystem::path kTocDir{"toc_sections"};
-static const std::filesystem::path kOutDir{"chapter_segments"};
+static const std::filesystem::path kBooksDir{"books"};
+// the shared output layout from before books/; nothing reads it any more
+static constexpr std::array<std::string_view, 5> kLegacyDirs{
+    "chapters", "toc_sections", "chapter_segments", "chapter_blobs",
+    ".bookslice"};
 static constexpr int kMinLinesBetweenChapters = 5;
 
+// One book's outputs and manifest, under a directory of its own so that a
+// run over one PDF never lists another's files.
+struct BookDirs {
+  std::filesystem::path root;
+  std::filesystem::path chapters;
+  std::filesystem::path toc;
+  std::filesystem::path segments;
+  std::filesystem::path blobs;
+
+  explicit BookDirs(const std::filesystem::path &pdfPath)
+      : root(BuildManifest::bookDir(kBooksDir, pdfPath)),
+        chapters(root / "chapters"), toc(root / "toc_sections"),
+        segments(root / "chapter_segments"), blobs(root / "chapter_blobs") {}
+};
+
+// One budget for the whole process; null without --mem-budget.
+static std::unique_ptr<MemoryBudget> make_budget(const CliOptions &opts) {
+  if (opts.memBudgetMb == 0)
+    return nullptr;
+  return std::make_unique<MemoryBudget>(std::size_t{opts.memBudgetMb} << 20);
+}
+
+static PdfFile::Open open_mode(const CliOptions &opts) {
+  return opts.mmap ? PdfFile::Open::Mapped : PdfFile::Open::Path;
+}
+
+static std::size_t store_size(const MemoryBudget *budget) {
+  if (!budget)
+    return FZ_STORE_UNLIMITED;
+  return budget->storeBytes();
+}
+
 static bool extract_chapter_texts(const PdfSession &session, const PdfFile &pdf,
-                                  int &totalPages,
+                                  const CliOptions &opts, MemoryBudget *budget,
+                                  const BookDirs &dirs, int &totalPages,
                                   std::vector<ChapterInfo> &chapters) {
   totalPages = pdf.pageCount();
-  if (!extractChapters(session, pdf, totalPages, chapters)) {
+  ExtractConfig cfg;
+  cfg.threads = opts.threads;
+  cfg.cacheDir = opts.cacheDir;
+  cfg.budget = budget;
+  cfg.chaptersDir = dirs.chapters;
+  if (!extractChapters(session, pdf, totalPages, chapters, cfg)) {
     std::cerr << "No TOC; skipping chapter extraction.\n";
     return false;
   }
   return true;
 }
 
-static bool slice_toc_windows() {
-  const auto files = Catalog(kChaptersDir).collect();
+// Slices depend on the TOC chapter's text and on the chapter file names.
+static bool slice_toc_windows(const BookDirs &dirs, BuildManifest &manifest) {
+  const auto files = Catalog(dirs.chapters).collect();
 
-  const std::filesystem::path tocPath = Title::findToc(kChaptersDir);
+  const std::filesystem::path tocPath = Title::findToc(dirs.chapters);
   if (tocPath.empty()) {
-    std::cerr << "TOC text not found in " << kChaptersDir << "\n";
+    std::cerr << "TOC text not found in " << dirs.chapters << "\n";
     return false;
   }
 
+  std::string names;
+  for (const auto &f : files)
+    names += f.file + '\n';
+  const auto input = BuildManifest::key(
+      {Hash::hex(BuildManifest::fileKey(tocPath)), names,
+       ChapterIndex::kVersion, SliceToc::kVersion,
+       std::to_string(kMinLinesBetweenChapters)});
+  if (manifest.stageFresh(BuildManifest::kSlice, input)) {
+    std::cout << "TOC windows up to date; skipping slicing\n";
+    return true;
+  }
+
   std::cout << "Extracting TOC windows from " << tocPath << '\n';
-  sliceToc(tocPath, files, kMinLinesBetweenChapters, kTocDir);
+  sliceToc(tocPath, files, kMinLinesBetweenChapters, dirs.toc);
+
+  manifest.clear(BuildManifest::kSlice);
+  for (const auto &p : FileIO::listChapters(dirs.toc, ".txt"))
+    manifest.record(BuildManifest::kSlice, p.string(), input, p);
   return true;
 }
 
-static void ensure_out_dir() {
+static void ensure_out_dir(const BookDirs &dirs) {
   std::error_code ec;
-  std::filesystem::create_directories(kOutDir, ec);
+  std::filesystem::create_directories(dirs.segments, ec);
 }
 
 static std::unordered_map<std::string, std::vector<std::filesystem::path>>
-build_toc_lookup() {
-  return TocLookup(kTocDir).build();
+build_toc_lookup(const BookDirs &dirs) {
+  return TocLookup(dirs.toc).build();
 }
 
+// A chapter is re-segmented when its text, its TOC slice, the matching
+// heuristics or the JSON layout changed. With blobs, rows reference the
+// chapter texts kept there, whose ids go to texts; with a codec, the others
+// are packed.
 static std::size_t segment_all_chapters(
+    const BookDirs &dirs,
     const std::unordered_map<std::string, std::vector<std::filesystem::path>>
-        &tocLookup) {
-  SectionWriter writer({kMinLinesBetweenChapters, kOutDir});
+        &tocLookup,
+    const Matcher::Config &matching, bool pretty, ContentStore *blobs,
+    std::shared_ptr<const ContentCodec> codec, BuildManifest &manifest,
+    std::set<std::string> &texts) {
+  const std::string packing = codec ? "zstd:" + codec->id() : "";
+  SectionWriter writer({.minLinesBetweenChapters = kMinLinesBetweenChapters,
+                        .outDir = dirs.segments,
+                        .pretty = pretty,
+                        .byReference = blobs != nullptr,
+                        .blobs = blobs,
+                        .codec = std::move(codec)},
+                       Matcher(matching));
 
-  std::size_t written = 0;
-  for (const auto &chapPath : FileIO::listChapters(kChaptersDir, ".txt")) {
-    if (writer.runOne(chapPath, tocLookup))
+  std::size_t written = 0, skipped = 0;
+  for (const auto &chapPath : FileIO::listChapters(dirs.chapters, ".txt")) {
+    const std::string out = writer.outputFor(chapPath).string();
+    auto toc = tocLookup.find(Title::extractChapterTitle(chapPath.string()));
+    const std::uint64_t chapKey = BuildManifest::fileKey(chapPath);
+    std::error_code ec;
+    if (const auto size = std::filesystem::file_size(chapPath, ec);
+        blobs && !ec)
+      texts.insert(ContentStore::id(chapKey, size));
+    std::uint64_t input = 0;
+    if (toc != tocLookup.end()) {
+      input = BuildManifest::key(
+          {Hash::hex(chapKey),
+           Hash::hex(BuildManifest::fileKey(toc->second.front())),
+           Matcher::kVersion, Segmenter::kVersion, SectionWriter::kVersion,
+           std::to_string(kMinLinesBetweenChapters),
+           std::to_string(matching.maxErrors),
+           std::to_string(matching.charsPerError), pretty ? "pretty" : "",
+           blobs ? "refs" : "", packing});
+      if (manifest.fresh(BuildManifest::kSegment, out, input)) {
+        ++written;
+        ++skipped;
+        continue;
+      }
+    }
+    if (writer.runOne(chapPath, tocLookup)) {
       ++written;
+      manifest.record(BuildManifest::kSegment, out, input, out);
+    }
   }
+  if (skipped)
+    std::cout << skipped << " chapters up to date; segmentation skipped\n";
   return written;
 }
 
-static int run(const std::filesystem::path &pdfPath) {
-  PdfSession session;
+// Stages whose inputs match the manifest are skipped.
+static int run(const CliOptions &opts, const BookDirs &dirs,
+               BuildManifest &manifest) {
+  const std::filesystem::path &pdfPath = opts.pdfPath;
+  const auto budget = make_budget(opts);
+  PdfSession session(store_size(budget.get()));
   if (!session.isValid()) {
     std::cerr << "Invalid MuPDF session.\n";
     return 1;
   }
 
-  PdfFile pdf(session.ctx(), pdfPath.string());
+  PdfFile pdf(session.ctx(), pdfPath.string(), open_mode(opts));
   if (!pdf.isValid()) {
     std::cerr << "Invalid PDF file: " << pdfPath << "\n";
     return 1;
@@ -86,29 +210,373 @@ static int run(const std::filesystem::path &pdfPath) {
                                 : "inferred")
             << "): " << bt.value << "\n";
 
-  int totalPages = 0;
-  std::vector<ChapterInfo> chapters;
-  if (!extract_chapter_texts(session, pdf, totalPages, chapters)) {
-    return 2;
+  const auto extractKey =
+      BuildManifest::key({Hash::hex(BuildManifest::fileKey(pdfPath)),
+                          kPageTextOptions, kChapterVersion});
+  if (manifest.stageFresh(BuildManifest::kExtract, extractKey)) {
+    std::cout << "Chapter texts up to date; skipping extraction\n";
+  } else {
+    int totalPages = 0;
+    std::vector<ChapterInfo> chapters;
+    if (!extract_chapter_texts(session, pdf, opts, budget.get(), dirs,
+                               totalPages, chapters)) {
+      return 2;
+    }
+    manifest.clear(BuildManifest::kExtract);
+    for (std::size_t i = 0; i < chapters.size(); ++i) {
+      const auto path = dirs.chapters / chapterFileName(i, chapters[i]);
+      manifest.record(BuildManifest::kExtract, path.string(), extractKey,
+                      path);
+    }
   }
 
-  if (!slice_toc_windows()) {
+  if (!slice_toc_windows(dirs, manifest)) {
     return 3;
   }
 
-  ensure_out_dir();
+  ensure_out_dir(dirs);
 
-  const auto tocLookup = build_toc_lookup();
+  const auto tocLookup = build_toc_lookup(dirs);
   if (tocLookup.empty()) {
-    std::cerr << "No TOC slices found in " << kTocDir
+    std::cerr << "No TOC slices found in " << dirs.toc
               << " (did slicing produce any files?).\n";
     return 4;
   }
 
-  const std::size_t written = segment_all_chapters(tocLookup);
+  // the dictionary goes next to the chapter blobs, where ingestion finds it
+  ContentStore blobs(dirs.blobs);
+  std::shared_ptr<const ContentCodec> codec;
+  if (opts.compress) {
+    std::vector<ChapterText> texts;
+    for (const auto &chapPath : FileIO::listChapters(dirs.chapters, ".txt")) {
+      const LineTable chapter(chapPath);
+      if (!chapter.isValid())
+        continue;
+      texts.push_back({chapPath.filename().string(), {}});
+      texts.back().body.append(std::string(chapter.bytes()));
+    }
+    codec = bookCodec(texts, dirs.root, opts.retrainDict);
+    if (codec && !blobs.put(codec->dictionary()))
+      return 1;
+  }
+  std::set<std::string> keep;
+  const std::size_t written = segment_all_chapters(
+      dirs, tocLookup, Matcher::Config{.maxErrors = opts.fuzzy},
+      opts.prettyJson, opts.sectionRefs ? &blobs : nullptr, codec, manifest,
+      keep);
+  // texts of chapters that changed or went, and dictionaries replaced
+  if (codec)
+    keep.insert(codec->id());
+  if (const std::size_t pruned = blobs.prune(keep))
+    std::cout << "Removed " << pruned << " unreferenced blobs from "
+              << dirs.blobs << '\n';
 
   std::cout << "\nDone — " << written
-            << " chapter files processed; JSON saved in '" << kOutDir << "/'\n";
+            << " chapter files processed; JSON saved in '"
+            << dirs.segments.string() << "/'\n";
+  return 0;
+}
+
+static BookConfig book_config(const CliOptions &opts, MemoryBudget *budget) {
+  BookConfig cfg;
+  cfg.extract.threads = opts.threads;
+  cfg.extract.cacheDir = opts.cacheDir;
+  cfg.extract.budget = budget;
+  cfg.minLinesBetweenChapters = kMinLinesBetweenChapters;
+  cfg.headings = opts.headings;
+  cfg.matching.maxErrors = opts.fuzzy;
+  cfg.dump = opts.dump;
+  cfg.prettyJson = opts.prettyJson;
+  cfg.sectionRefs = opts.sectionRefs;
+  cfg.compress = opts.compress;
+  cfg.retrainCodec = opts.retrainDict;
+  return cfg;
+}
+
+// Same stages as run(), but chapter text, TOC slices and section rows stay in
+// memory; the intermediate directories are written only with --dump.
+static int run_in_memory(const CliOptions &opts, const BookDirs &dirs,
+                         std::vector<ChapterSegments> &segments) {
+  const std::filesystem::path &pdfPath = opts.pdfPath;
+  const auto budget = make_budget(opts);
+  PdfSession session(store_size(budget.get()));
+  if (!session.isValid()) {
+    std::cerr << "Invalid MuPDF session.\n";
+    return 1;
+  }
+
+  PdfFile pdf(session.ctx(), pdfPath.string(), open_mode(opts));
+  if (!pdf.isValid()) {
+    std::cerr << "Invalid PDF file: " << pdfPath << "\n";
+    return 1;
+  }
+
+  auto cfg = book_config(opts, budget.get());
+  cfg.chaptersDir = dirs.chapters;
+  cfg.tocDir = dirs.toc;
+  cfg.outDir = dirs.segments;
+  cfg.blobsDir = dirs.blobs;
+  cfg.codecDir = dirs.root;
+  BookResult book;
+  const int rc = runBook(session, pdf, cfg, book);
+  if (rc != 0)
+    return rc;
+  segments = std::move(book.segments);
+
+  std::cout << "\nDone — " << segments.size() << " chapters segmented in memory"
+            << (opts.dump ? " (debug dump written)" : "") << "\n";
+  return 0;
+}
+
+// Same stages as run(), but each one reads its inputs from and writes its
+// outputs to one bundle file instead of the chapters/, toc_sections/ and
+// chapter_segments/ directories. Manifest items are blob names and every key
+// carries the bundle path, so the two layouts never vouch for each other.
+static int run_bundle(const CliOptions &opts, const BookDirs &dirs,
+                      BuildManifest &manifest,
+                      std::vector<ChapterSegments> &segments) {
+  const std::filesystem::path &pdfPath = opts.pdfPath;
+  Bundle bundle(opts.bundlePath);
+  if (!bundle.isValid())
+    return 1;
+  BookBundle store(bundle);
+  ContentStore blobs(bundle);
+  const std::string where = "bundle:" + bundle.path().string();
+  const auto item = [&](std::string_view stage, std::string_view file) {
+    return (bundle.path() / BookBundle::name(stage, file)).string();
+  };
+
+  const auto budget = make_budget(opts);
+  PdfSession session(store_size(budget.get()));
+  if (!session.isValid()) {
+    std::cerr << "Invalid MuPDF session.\n";
+    return 1;
+  }
+  PdfFile pdf(session.ctx(), pdfPath.string(), open_mode(opts));
+  if (!pdf.isValid()) {
+    std::cerr << "Invalid PDF file: " << pdfPath << "\n";
+    return 1;
+  }
+
+  // chapters read back from the bundle have no layout for --headings
+  const auto extractKey =
+      BuildManifest::key({Hash::hex(BuildManifest::fileKey(pdfPath)),
+                          kPageTextOptions, kChapterVersion, where});
+  std::vector<ChapterText> texts;
+  if (!opts.headings &&
+      manifest.stageFresh(BuildManifest::kExtract, extractKey))
+    texts = store.chapters();
+  if (!texts.empty()) {
+    std::cout << "Chapter texts up to date; skipping extraction\n";
+  } else {
+    ExtractConfig cfg;
+    cfg.threads = opts.threads;
+    cfg.cacheDir = opts.cacheDir;
+    cfg.budget = budget.get();
+    cfg.layout = opts.headings;
+    int totalPages = 0;
+    std::vector<ChapterInfo> chapters;
+    texts = loadChapters(session, pdf, totalPages, chapters, cfg);
+    if (texts.empty()) {
+      std::cerr << "No TOC; skipping chapter extraction.\n";
+      return 2;
+    }
+    store.putChapters(texts);
+    manifest.clear(BuildManifest::kExtract);
+    for (const auto &t : texts)
+      manifest.record(BuildManifest::kExtract,
+                      item(BookBundle::kChapters, t.file), extractKey);
+  }
+
+  const ChapterText *toc = Title::findToc(texts);
+  if (!toc) {
+    std::cerr << "TOC text not found among extracted chapters\n";
+    return 3;
+  }
+  const auto files = Catalog::collect(texts);
+  std::string names;
+  for (const auto &f : files)
+    names += f.file + '\n';
+  const auto sliceKey = BuildManifest::key(
+      {Hash::hex(Hash::fnv1a(toc->body.str())), names, ChapterIndex::kVersion,
+       SliceToc::kVersion, std::to_string(kMinLinesBetweenChapters), where});
+  std::vector<TocSlice> slices;
+  if (manifest.stageFresh(BuildManifest::kSlice, sliceKey))
+    slices = store.tocSlices();
+  if (!slices.empty()) {
+    std::cout << "TOC windows up to date; skipping slicing\n";
+  } else {
+    std::cout << "Extracting TOC windows from " << toc->file << '\n';
+    slices = SliceToc(SliceToc::Config{kMinLinesBetweenChapters, {}})
+                 .run(*toc, files);
+    store.putTocSlices(slices);
+    manifest.clear(BuildManifest::kSlice);
+    for (const auto &s : slices)
+      manifest.record(BuildManifest::kSlice,
+                      item(BookBundle::kTocSections, s.file), sliceKey);
+  }
+
+  const auto tocLookup = TocLookup::build(slices);
+  if (tocLookup.empty()) {
+    std::cerr << "No TOC slices produced from " << toc->file << ".\n";
+    return 4;
+  }
+
+  const auto codec = opts.compress
+                         ? bookCodec(texts, dirs.root, opts.retrainDict)
+                         : nullptr;
+  if (codec && !blobs.put(codec->dictionary()))
+    return 1;
+  const std::string packing = codec ? "zstd:" + codec->id() : "";
+  const Matcher::Config matching{.maxErrors = opts.fuzzy};
+  SectionWriter writer({kMinLinesBetweenChapters, {}, opts.headings,
+                        opts.prettyJson, opts.sectionRefs, nullptr, codec},
+                       Matcher(matching));
+  std::size_t skipped = 0;
+  segments.clear();
+  for (const auto &chapter : texts) {
+    const auto slice =
+        tocLookup.find(Title::extractChapterTitle(chapter.file));
+    if (slice == tocLookup.end())
+      continue;
+    const std::string file =
+        std::filesystem::path(chapter.file).stem().string() + ".json";
+    std::string sliceText;
+    for (const auto &ln : slice->second->lines)
+      sliceText.append(ln).push_back('\n');
+    const auto input = BuildManifest::key(
+        {Hash::hex(Hash::fnv1a(chapter.body.str())),
+         Hash::hex(Hash::fnv1a(sliceText)), Matcher::kVersion,
+         Segmenter::kVersion, SectionWriter::kVersion,
+         std::to_string(kMinLinesBetweenChapters),
+         std::to_string(matching.maxErrors),
+         std::to_string(matching.charsPerError),
+         opts.prettyJson ? "pretty" : "", opts.headings ? "headings" : "",
+         opts.sectionRefs ? "refs" : "", packing, where});
+    const auto name = item(BookBundle::kSegments, file);
+    if (manifest.fresh(BuildManifest::kSegment, name, input)) {
+      if (auto seg = store.segments(file)) {
+        // the chapter text is already here, and usually the same blob
+        if (opts.sectionRefs)
+          seg->text = chapter.body.str();
+        seg->codec = codec;
+        segments.push_back(std::move(*seg));
+        ++skipped;
+        continue;
+      }
+    }
+    auto seg = writer.runOne(chapter, tocLookup);
+    if (!seg)
+      continue;
+    // identical to the chapter blob, so the bundle shares its bytes
+    if (opts.sectionRefs && !blobs.put(seg->text))
+      return 1;
+    store.putSegments(*seg, writer);
+    manifest.record(BuildManifest::kSegment, name, input);
+    segments.push_back(std::move(*seg));
+  }
+  // chapters that are gone take their segments with them
+  for (const auto &blob : bundle.list(BookBundle::kSegments)) {
+    const auto file = blob.substr(BookBundle::kSegments.size());
+    if (std::none_of(segments.begin(), segments.end(),
+                     [&](const ChapterSegments &s) { return s.file == file; }))
+      bundle.remove(blob);
+  }
+  std::set<std::string> keep;
+  for (const auto &seg : segments)
+    for (const auto &row : seg.rows) {
+      if (!row.ref.blob.empty())
+        keep.insert(row.ref.blob);
+      if (!row.packed.dict.empty())
+        keep.insert(row.packed.dict);
+    }
+  blobs.prune(keep);
+  if (skipped)
+    std::cout << skipped << " chapters up to date; segmentation skipped\n";
+  if (!bundle.commit())
+    return 1;
+
+  std::cout << "\nDone — " << segments.size() << " chapters segmented; "
+            << bundle.liveBytes() << " bytes in " << bundle.path() << "\n";
+  return 0;
+}
+
+// --arrow for one book: a single record batch. The on-disk pipeline reads
+// its rows back from the segment files.
+static bool export_arrow(const std::filesystem::path &path,
+                         const BookTitle &bt,
+                         const std::vector<ChapterSegments> &segments) {
+  ArrowExport arrow(path);
+  return arrow.isValid() && arrow.add(bt, segments) && arrow.finish();
+}
+
+static std::vector<ChapterSegments> load_segments(const BookDirs &dirs,
+                                                  const ContentStore &blobs) {
+  std::vector<ChapterSegments> out;
+  for (const auto &path : FileIO::listChapters(dirs.segments, ".json")) {
+    auto seg = SectionWriter::read(path);
+    if (!seg)
+      continue;
+    for (const auto &row : seg->rows) {
+      if (!row.ref.blob.empty() && seg->text.empty())
+        seg->text = blobs.get(row.ref.blob).value_or("");
+      if (!row.packed.dict.empty() && !seg->codec)
+        if (auto dict = blobs.get(row.packed.dict))
+          seg->codec = std::make_shared<const ContentCodec>(std::move(*dict));
+    }
+    out.push_back(std::move(*seg));
+  }
+  return out;
+}
+
+// Many books on one MuPDF session and one Mongo connection.
+static int run_batch(const CliOptions &opts) {
+  std::vector<std::filesystem::path> pdfs;
+  try {
+    pdfs = opts.manifest.empty() ? BatchRunner::fromDirectory(opts.batchDir)
+                                 : BatchRunner::fromManifest(opts.manifest);
+  } catch (const std::exception &e) {
+    std::cerr << "batch: " << e.what() << '\n';
+    return 1;
+  }
+  if (pdfs.empty()) {
+    std::cerr << "batch: no PDFs to process\n";
+    return 1;
+  }
+
+  const auto budget = make_budget(opts);
+  PdfSession session(store_size(budget.get()));
+  if (!session.isValid()) {
+    std::cerr << "Invalid MuPDF session.\n";
+    return 1;
+  }
+  std::optional<ArrowExport> arrow;
+  if (!opts.arrowPath.empty()) {
+    arrow.emplace(opts.arrowPath);
+    if (!arrow->isValid())
+      return 6;
+  }
+  MongoConfig cfg;
+  MongoRepository repo(cfg);
+  Ingestor ingestor(repo);
+
+  BatchRunner runner(session, ingestor,
+                     {book_config(opts, budget.get()), opts.workers,
+                      open_mode(opts), kBooksDir, opts.force,
+                      arrow ? &*arrow : nullptr});
+  const auto t0 = std::chrono::steady_clock::now();
+  const auto stats = runner.run(pdfs);
+  const double wall = std::chrono::duration<double>(
+                          std::chrono::steady_clock::now() - t0)
+                          .count();
+  BatchRunner::report(stats, wall, std::cout);
+  if (arrow && !arrow->finish())
+    return 6;
+
+  for (const auto &s : stats) {
+    if (s.rc != 0)
+      return 5;
+  }
   return 0;
 }
 
@@ -136,24 +604,97 @@ static BookTitle fetch_book_title_for(const std::filesystem::path &pdfPath) {
   return getBookTitle(session.ctx(), pdf.doc(), pdfPath);
 }
 
+static int ingest_sequentially(const MongoConfig &cfg, bool onDisk,
+                               const BookDirs &dirs, const ContentStore &blobs,
+                               const std::vector<ChapterSegments> &segments,
+                               BuildManifest &manifest,
+                               const std::filesystem::path &pdfPath,
+                               const BookTitle &bt) {
+  MongoRepository repo(cfg);
+  // the other modes hand the chapter texts along with the rows
+  Ingestor ingestor(repo, onDisk ? &blobs : nullptr);
+  return onDisk
+             ? ingestChanged(ingestor, manifest, dirs.segments, pdfPath, bt)
+             : ingestChanged(ingestor, manifest, segments, pdfPath, bt);
+}
+
+// Segment files parsed and written on several threads, each writer on a
+// connection of its own from one pool.
+static int ingest_concurrently(const CliOptions &opts, const MongoConfig &cfg,
+                               const BookDirs &dirs, const ContentStore &blobs,
+                               BuildManifest &manifest,
+                               const std::filesystem::path &pdfPath,
+                               const BookTitle &bt) {
+  const auto pool = MongoRepository::makePool(cfg);
+  ConcurrentIngestor::Config icfg;
+  icfg.writers =
+      std::min(opts.ingestWriters, MongoRepository::maxPoolSize(cfg));
+  if (icfg.writers < opts.ingestWriters)
+    std::cerr << "⚠️  --ingest-writers " << opts.ingestWriters
+              << " exceeds the pool's maxPoolSize; using " << icfg.writers
+              << " writers\n";
+  ConcurrentIngestor ingestor(
+      [&]() -> std::unique_ptr<Repository> {
+        return std::make_unique<MongoRepository>(*pool, cfg);
+      },
+      &blobs, icfg);
+  return ingestChanged(ingestor, manifest, dirs.segments, pdfPath, bt);
+}
+
+// run.sh removes the old layout; a bare binary only points it out
+static void warn_legacy_layout() {
+  for (std::string_view d : kLegacyDirs) {
+    std::error_code ec;
+    if (std::filesystem::exists(d, ec))
+      std::cerr << "⚠️  " << d << "/ is from the old shared layout and is "
+                << "ignored; outputs go to " << kBooksDir.string()
+                << "/<book>/. Remove it.\n";
+  }
+}
+
 int main(int argc, char **argv) {
-  const char *home = std::getenv("HOME");
-  if (!home) {
-    std::cerr << "HOME not set!" << std::endl;
+  const auto opts = parseCli(argc, argv);
+  if (!opts) {
+    printUsage(argv[0]);
     return 1;
   }
-  const std::filesystem::path pdfPath =
-      (argc > 1) ? std::filesystem::path{argv[1]}
-                 : std::filesystem::path(home) / "Downloads" /
-                       "Head-First-Design-Patterns.pdf";
-  const int pipeline_rc = run(pdfPath);
+  warn_legacy_layout();
+  if (opts->batch())
+    return run_batch(*opts);
+
+  const std::filesystem::path &pdfPath = opts->pdfPath;
+  const BookDirs dirs(pdfPath);
+  BuildManifest manifest(kBooksDir, pdfPath);
+  if (opts->force)
+    manifest.clearAll();
+
+  // rows end up in segments unless the directories hold them
+  const bool onDisk = !opts->inMemory && opts->bundlePath.empty();
+  std::vector<ChapterSegments> segments;
+  const int pipeline_rc =
+      !opts->bundlePath.empty() ? run_bundle(*opts, dirs, manifest, segments)
+      : opts->inMemory          ? run_in_memory(*opts, dirs, segments)
+                                : run(*opts, dirs, manifest);
   if (pipeline_rc != 0)
     return pipeline_rc;
+  manifest.save();
+
   const BookTitle bt = fetch_book_title_for(pdfPath);
-  MongoConfig cfg;
-  MongoRepository repo(cfg);
-  Ingestor ingestor(repo);
+  const ContentStore blobs(dirs.blobs);
+  if (!opts->arrowPath.empty()) {
+    const auto loaded =
+        onDisk ? load_segments(dirs, blobs) : std::vector<ChapterSegments>{};
+    if (!export_arrow(opts->arrowPath, bt, onDisk ? loaded : segments))
+      return 6;
+  }
 
-  const int mongo_rc = ingestor.ingest_directory(kOutDir, pdfPath, bt);
+  MongoConfig cfg;
+  const int mongo_rc = onDisk && opts->ingestWriters > 0
+                           ? ingest_concurrently(*opts, cfg, dirs, blobs,
+                                                 manifest, pdfPath, bt)
+                           : ingest_sequentially(cfg, onDisk, dirs, blobs,
+                                                 segments, manifest, pdfPath,
+                                                 bt);
+  manifest.save();
   return mongo_rc;
 }
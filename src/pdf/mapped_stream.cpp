@@ -0,0 +1,76 @@
+#include "pdf/mapped_stream.hpp"
+
+#include <cstring>
+#include <fcntl.h>
+#include <iostream>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+
+struct Mapping {
+  unsigned char *base = nullptr;
+  std::size_t size = 0;
+};
+
+// the whole mapping is handed out at open, so there is never more to read
+int nextMapped(fz_context *, fz_stream *, std::size_t) { return EOF; }
+
+void seekMapped(fz_context *, fz_stream *stm, int64_t offset, int whence) {
+  auto *m = static_cast<Mapping *>(stm->state);
+  const int64_t size = static_cast<int64_t>(m->size);
+  if (whence == SEEK_CUR)
+    offset += stm->rp - m->base;
+  else if (whence == SEEK_END)
+    offset += size;
+  if (offset < 0)
+    offset = 0;
+  if (offset > size)
+    offset = size;
+  stm->rp = m->base + offset;
+}
+
+void dropMapped(fz_context *, void *state) {
+  auto *m = static_cast<Mapping *>(state);
+  if (m->base)
+    munmap(m->base, m->size);
+  delete m;
+}
+
+} // namespace
+
+fz_stream *openMappedStream(fz_context *ctx, const std::string &path) {
+  const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    std::cerr << "mmap: cannot open " << path << ": " << std::strerror(errno)
+              << '\n';
+    return nullptr;
+  }
+  struct stat st {};
+  if (fstat(fd, &st) != 0 || st.st_size <= 0) {
+    std::cerr << "mmap: cannot stat " << path << '\n';
+    ::close(fd);
+    return nullptr;
+  }
+  const auto size = static_cast<std::size_t>(st.st_size);
+  void *base = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+  ::close(fd); // the mapping keeps the file referenced
+  if (base == MAP_FAILED) {
+    std::cerr << "mmap: cannot map " << path << ": " << std::strerror(errno)
+              << '\n';
+    return nullptr;
+  }
+  // Whole-file readahead: the pipeline touches every page anyway, and one
+  // large request beats MuPDF's jumps between trailer, xref and objects.
+  madvise(base, size, MADV_WILLNEED);
+
+  auto *m = new Mapping{static_cast<unsigned char *>(base), size};
+  // fz_new_stream drops the state itself if it throws
+  fz_stream *stm = fz_new_stream(ctx, m, nextMapped, dropMapped);
+  stm->seek = seekMapped;
+  stm->rp = m->base;
+  stm->wp = m->base + size;
+  stm->pos = static_cast<int64_t>(size);
+  return stm;
+}
@@ -0,0 +1,69 @@
+#include "pdf/memory_budget.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <sys/resource.h>
+#include <unistd.h>
+
+#if defined(__APPLE__)
+#include <mach/mach.h>
+#endif
+
+std::size_t MemoryBudget::currentRss() noexcept {
+#if defined(__APPLE__)
+  mach_task_basic_info info{};
+  mach_msg_type_number_t count = MACH_TASK_BASIC_INFO_COUNT;
+  if (task_info(mach_task_self(), MACH_TASK_BASIC_INFO,
+                reinterpret_cast<task_info_t>(&info), &count) == KERN_SUCCESS)
+    return static_cast<std::size_t>(info.resident_size);
+#else
+  std::ifstream statm("/proc/self/statm");
+  std::size_t size = 0, resident = 0;
+  if (statm >> size >> resident)
+    return resident * static_cast<std::size_t>(sysconf(_SC_PAGESIZE));
+#endif
+  // fallback: lifetime peak (kilobytes on Linux)
+  rusage ru{};
+  getrusage(RUSAGE_SELF, &ru);
+  return static_cast<std::size_t>(ru.ru_maxrss) * 1024;
+}
+
+std::size_t MemoryBudget::sample() noexcept {
+  const std::size_t rss = currentRss();
+  std::size_t seen = highWater_.load();
+  while (rss > seen && !highWater_.compare_exchange_weak(seen, rss)) {
+  }
+  return rss;
+}
+
+bool MemoryBudget::over(fz_context *ctx) {
+  const std::size_t rss = sample();
+  if (rss <= lowWater())
+    trimmedAt_ = 0;
+  if (rss <= peak_)
+    return false;
+  // the store is the one cache we can give back on demand; a step of 1/16
+  // of the peak keeps a slow climb from emptying it on every page
+  if (trimmedAt_ == 0 || rss > trimmedAt_ + peak_ / 16) {
+    fz_empty_store(ctx);
+    trimmedAt_ = std::max<std::size_t>(sample(), 1);
+    return trimmedAt_ > peak_;
+  }
+  return true;
+}
+
+void MemoryBudget::admit(fz_context *ctx) {
+  std::unique_lock lock(m_);
+  while (over(ctx) && inFlight_ > 0)
+    cv_.wait_for(lock, std::chrono::milliseconds(20));
+  ++inFlight_;
+}
+
+void MemoryBudget::done() noexcept {
+  {
+    std::lock_guard lock(m_);
+    --inFlight_;
+  }
+  cv_.notify_one();
+}
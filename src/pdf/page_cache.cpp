@@ -0,0 +1,185 @@
+#include "pdf/page_cache.hpp"
+
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+#include "utils.hpp"
+
+namespace {
+
+constexpr char kMagic[4] = {'B', 'S', 'P', 'C'};
+// 2: failures are only those that recur (earlier caches kept any)
+constexpr std::uint32_t kVersion = 2;
+
+struct Header {
+  char magic[4];
+  std::uint32_t version;
+  std::uint64_t fingerprint;
+  std::uint32_t pageCount;
+  std::uint32_t reserved;
+};
+static_assert(sizeof(Header) == 24);
+
+} // namespace
+
+PageCache::PageCache(std::filesystem::path dir,
+                     const std::filesystem::path &pdfPath, int pageCount,
+                     std::string_view options) {
+  if (pageCount <= 0)
+    return;
+  std::uint64_t pdfHash = 0;
+  try {
+    pdfHash = Hash::file(pdfPath);
+  } catch (const std::exception &e) {
+    std::cerr << "PageCache: " << e.what() << '\n';
+    return;
+  }
+  const std::uint64_t optHash = Hash::fnv1a(options);
+  fingerprint_ = Hash::fnv1a(options, pdfHash);
+
+  std::error_code ec;
+  std::filesystem::create_directories(dir, ec);
+  if (ec) {
+    std::cerr << "PageCache: cannot create " << dir << ": " << ec.message()
+              << '\n';
+    return;
+  }
+  const std::string stem = Hash::hex(pdfHash) + "-" + Hash::hex(optHash);
+  idxPath_ = dir / (stem + ".idx");
+  datPath_ = dir / (stem + ".dat");
+
+  index_.assign(static_cast<std::size_t>(pageCount), Slot{});
+  if (!load()) {
+    // stale or torn cache: start over
+    index_.assign(static_cast<std::size_t>(pageCount), Slot{});
+    data_.clear();
+    persisted_ = 0;
+    std::filesystem::remove(datPath_, ec);
+  }
+}
+
+PageCache::~PageCache() noexcept {
+  try {
+    flush();
+  } catch (const std::exception &e) {
+    std::cerr << "PageCache: flush failed: " << e.what() << '\n';
+  }
+}
+
+bool PageCache::load() {
+  std::ifstream idx(idxPath_, std::ios::binary);
+  if (!idx) {
+    // cold cache; an orphaned data file would skew the offsets
+    std::error_code ec;
+    std::filesystem::remove(datPath_, ec);
+    return true;
+  }
+
+  Header h{};
+  if (!idx.read(reinterpret_cast<char *>(&h), sizeof h) ||
+      std::memcmp(h.magic, kMagic, sizeof kMagic) != 0 ||
+      h.version != kVersion || h.fingerprint != fingerprint_ ||
+      h.pageCount != index_.size())
+    return false;
+  if (!idx.read(reinterpret_cast<char *>(index_.data()),
+                static_cast<std::streamsize>(index_.size() * sizeof(Slot))))
+    return false;
+
+  std::ifstream dat(datPath_, std::ios::binary);
+  if (dat) {
+    dat.seekg(0, std::ios::end);
+    data_.resize(static_cast<std::size_t>(dat.tellg()));
+    dat.seekg(0);
+    dat.read(data_.data(), static_cast<std::streamsize>(data_.size()));
+    if (!dat)
+      return false;
+  }
+  persisted_ = data_.size();
+
+  for (const Slot &s : index_) {
+    if (s.state > static_cast<std::uint32_t>(State::Failed) ||
+        s.offset + s.length > data_.size())
+      return false;
+  }
+  return true;
+}
+
+PageCache::State PageCache::state(int page) const noexcept {
+  if (page < 0 || static_cast<std::size_t>(page) >= index_.size())
+    return State::Missing;
+  const auto st = static_cast<State>(index_[page].state);
+  ++(st == State::Missing ? misses_ : hits_);
+  return st;
+}
+
+std::string_view PageCache::text(int page) const noexcept {
+  if (page < 0 || static_cast<std::size_t>(page) >= index_.size())
+    return {};
+  const Slot &s = index_[page];
+  if (s.state != static_cast<std::uint32_t>(State::Ok))
+    return {};
+  return std::string_view(data_).substr(s.offset, s.length);
+}
+
+void PageCache::put(int page, std::string_view text) {
+  if (page < 0 || static_cast<std::size_t>(page) >= index_.size())
+    return;
+  index_[page] = Slot{data_.size(), static_cast<std::uint32_t>(text.size()),
+                      static_cast<std::uint32_t>(State::Ok)};
+  data_.append(text);
+  dirty_ = true;
+}
+
+void PageCache::putFailed(int page) {
+  if (page < 0 || static_cast<std::size_t>(page) >= index_.size())
+    return;
+  index_[page] = Slot{0, 0, static_cast<std::uint32_t>(State::Failed)};
+  dirty_ = true;
+}
+
+bool PageCache::flush() {
+  if (!dirty_ || !isValid())
+    return true;
+
+  {
+    std::ofstream dat(datPath_, std::ios::binary | std::ios::app);
+    if (!dat) {
+      std::cerr << "PageCache: cannot write " << datPath_ << '\n';
+      return false;
+    }
+    dat.write(data_.data() + persisted_,
+              static_cast<std::streamsize>(data_.size() - persisted_));
+    if (!dat)
+      return false;
+  }
+  persisted_ = data_.size();
+
+  // index goes last and via rename, so a crash never points past the data
+  const auto tmp = std::filesystem::path(idxPath_).concat(".tmp");
+  {
+    std::ofstream idx(tmp, std::ios::binary | std::ios::trunc);
+    if (!idx) {
+      std::cerr << "PageCache: cannot write " << tmp << '\n';
+      return false;
+    }
+    Header h{};
+    std::memcpy(h.magic, kMagic, sizeof kMagic);
+    h.version = kVersion;
+    h.fingerprint = fingerprint_;
+    h.pageCount = static_cast<std::uint32_t>(index_.size());
+    idx.write(reinterpret_cast<const char *>(&h), sizeof h);
+    idx.write(reinterpret_cast<const char *>(index_.data()),
+              static_cast<std::streamsize>(index_.size() * sizeof(Slot)));
+    if (!idx)
+      return false;
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, idxPath_, ec);
+  if (ec) {
+    std::cerr << "PageCache: " << ec.message() << '\n';
+    return false;
+  }
+  dirty_ = false;
+  return true;
+}
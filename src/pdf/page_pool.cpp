@@ -0,0 +1,110 @@
+#include "pdf/page_pool.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <iostream>
+#include <thread>
+
+#include "pdf/memory_budget.hpp"
+#include "pdf/page_cache.hpp"
+#include "pdf/page_text.hpp"
+#include "pdf/session.hpp"
+
+PagePool::PagePool(const PdfSession &session, std::string path,
+                   unsigned threads, PageReadOptions opts) noexcept
+    : session_(&session), opts_(opts), path_(std::move(path)),
+      threads_(threads) {
+  if (threads_ == 0)
+    threads_ = std::max(1u, std::thread::hardware_concurrency());
+}
+
+std::vector<std::optional<PagePool::Page>> PagePool::extract(int first,
+                                                             int last) const {
+  if (last < first)
+    return {};
+  const int count = last - first + 1;
+  std::vector<std::optional<Page>> pages(count);
+  PageCache *cache = opts_.cache;
+
+  // offsets (into pages) that still need MuPDF
+  std::vector<int> pending;
+  pending.reserve(count);
+  for (int i = 0; i < count; ++i) {
+    if (!cache) {
+      pending.push_back(i);
+      continue;
+    }
+    switch (cache->state(first + i)) {
+    case PageCache::State::Ok:
+      pages[i].emplace(Page{std::string(cache->text(first + i)), {}});
+      break;
+    case PageCache::State::Failed:
+      break;
+    case PageCache::State::Missing:
+      pending.push_back(i);
+      break;
+    }
+  }
+  if (pending.empty())
+    return pages;
+
+  const int todo = static_cast<int>(pending.size());
+  std::atomic<int> next{0};
+  // FZ_ERROR_* of each page that failed; each is written by one worker
+  std::vector<int> errors(count, FZ_ERROR_NONE);
+
+  auto work = [&] {
+    auto ctx = session_->clone();
+    if (!ctx)
+      return;
+    PdfFile pdf(ctx.get(), path_,
+                opts_.mapped ? PdfFile::Open::Mapped : PdfFile::Open::Path);
+    if (!pdf.isValid())
+      return;
+
+    for (int k = next.fetch_add(1); k < todo; k = next.fetch_add(1)) {
+      const int i = pending[k];
+      BudgetTicket ticket(opts_.budget, ctx.get(), opts_.peak);
+      int &error = errors[i];
+      auto page = makePage(ctx.get(), pdf.doc(), first + i, &error);
+      if (!page)
+        continue;
+      if (opts_.layout) {
+        auto stext = makeStext(ctx.get(), page.get(), &error);
+        page.reset();
+        auto buf = makeBuffer(ctx.get(), stext.get(), &error);
+        if (buf)
+          pages[i].emplace(Page{std::string(bufferView(buf)),
+                                pageLayout(ctx.get(), stext.get())});
+        continue;
+      }
+      auto buf = makeBuffer(ctx.get(), page.get(), &error);
+      page.reset();
+      if (!buf)
+        continue;
+      pages[i].emplace(Page{std::string(bufferView(buf)), {}});
+    }
+  };
+
+  const unsigned n = std::min<unsigned>(threads_, todo);
+  {
+    std::vector<std::jthread> workers;
+    workers.reserve(n);
+    for (unsigned t = 0; t < n; ++t)
+      workers.emplace_back(work);
+  }
+
+  if (next.load() < todo) {
+    std::cerr << "PagePool: no worker could open " << path_ << '\n';
+    return pages;
+  }
+  if (cache) {
+    for (int i : pending) {
+      if (pages[i])
+        cache->put(first + i, pages[i]->text);
+      else if (permanentError(errors[i]))
+        cache->putFailed(first + i);
+    }
+  }
+  return pages;
+}
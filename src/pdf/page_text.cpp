@@ -2,31 +2,97 @@
 #include <iostream>
 #include <mupdf/fitz.h>
 
+namespace {
+
+void report(fz_context *ctx, const char *what, int *error) noexcept {
+  std::cerr << what << " failed: " << fz_caught_message(ctx) << '\n';
+  if (error)
+    *error = fz_caught(ctx);
+}
+
+} // namespace
+
 Handle<fz_page, PageDrop> makePage(fz_context *ctx, fz_document *doc,
-                                   int index) noexcept {
+                                   int index, int *error) noexcept {
   fz_page *raw = nullptr;
   if (ctx && doc) {
     fz_try(ctx) { raw = fz_load_page(ctx, doc, index); }
-    fz_catch(ctx) {
-      std::cerr << "fz_load_page failed: " << fz_caught_message(ctx) << '\n';
-    }
+    fz_catch(ctx) { report(ctx, "fz_load_page", error); }
   }
   return Handle<fz_page, PageDrop>(raw, PageDrop{ctx});
 }
 
-Handle<fz_buffer, BufferDrop> makeBuffer(fz_context *ctx,
-                                         fz_page *page) noexcept {
+Handle<fz_buffer, BufferDrop> makeBuffer(fz_context *ctx, fz_page *page,
+                                         int *error) noexcept {
   fz_buffer *raw = nullptr;
   if (ctx && page) {
     fz_try(ctx) { raw = fz_new_buffer_from_page(ctx, page, nullptr); }
-    fz_catch(ctx) {
-      std::cerr << "fz_new_buffer_from_page failed: " << fz_caught_message(ctx)
-                << '\n';
-    }
+    fz_catch(ctx) { report(ctx, "fz_new_buffer_from_page", error); }
+  }
+  return Handle<fz_buffer, BufferDrop>(raw, BufferDrop{ctx});
+}
+
+Handle<fz_stext_page, StextDrop> makeStext(fz_context *ctx, fz_page *page,
+                                           int *error) noexcept {
+  fz_stext_page *raw = nullptr;
+  if (ctx && page) {
+    fz_try(ctx) { raw = fz_new_stext_page_from_page(ctx, page, nullptr); }
+    fz_catch(ctx) { report(ctx, "fz_new_stext_page_from_page", error); }
+  }
+  return Handle<fz_stext_page, StextDrop>(raw, StextDrop{ctx});
+}
+
+Handle<fz_buffer, BufferDrop> makeBuffer(fz_context *ctx,
+                                         fz_stext_page *stext,
+                                         int *error) noexcept {
+  fz_buffer *raw = nullptr;
+  if (ctx && stext) {
+    fz_try(ctx) { raw = fz_new_buffer_from_stext_page(ctx, stext); }
+    fz_catch(ctx) { report(ctx, "fz_new_buffer_from_stext_page", error); }
   }
   return Handle<fz_buffer, BufferDrop>(raw, BufferDrop{ctx});
 }
 
+// FZ_ERROR_GENERIC is left out: MuPDF throws it for anything.
+bool permanentError(int error) noexcept {
+#if FZ_VERSION_MAJOR > 1 || (FZ_VERSION_MAJOR == 1 && FZ_VERSION_MINOR >= 24)
+  return error == FZ_ERROR_SYNTAX || error == FZ_ERROR_FORMAT ||
+         error == FZ_ERROR_UNSUPPORTED;
+#else
+  return error == FZ_ERROR_SYNTAX;
+#endif
+}
+
+PageLayout pageLayout(fz_context *ctx, const fz_stext_page *stext) {
+  PageLayout layout;
+  if (!ctx || !stext)
+    return layout;
+
+  for (auto *block = stext->first_block; block; block = block->next) {
+    if (block->type != FZ_STEXT_BLOCK_TEXT)
+      continue;
+    for (auto *line = block->u.t.first_line; line; line = line->next) {
+      LineStyle st;
+      int bold = 0;
+      float sizeSum = 0.f;
+      for (auto *ch = line->first_char; ch; ch = ch->next) {
+        char utf[FZ_UTFMAX];
+        st.text.append(utf, static_cast<std::size_t>(fz_runetochar(utf, ch->c)));
+        sizeSum += ch->size;
+        if (ch->font && fz_font_is_bold(ctx, ch->font))
+          ++bold;
+        ++st.glyphs;
+      }
+      if (st.glyphs == 0)
+        continue;
+      st.size = sizeSum / static_cast<float>(st.glyphs);
+      st.bold = bold * 2 > st.glyphs;
+      layout.lines.push_back(std::move(st));
+    }
+  }
+  return layout;
+}
+
 std::string pageText(fz_context *ctx, fz_document *doc, int index) {
   auto page = makePage(ctx, doc, index);
   if (!page)
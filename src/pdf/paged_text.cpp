@@ -0,0 +1,70 @@
+#include "pdf/paged_text.hpp"
+
+#include <ostream>
+
+void PagedText::append(Handle<fz_buffer, BufferDrop> page,
+                       std::optional<PageLayout> layout) {
+  const std::size_t len = bufferSize(page);
+  pages_.emplace_back(std::move(page));
+  layouts_.push_back(std::move(layout));
+  offsets_.push_back(offsets_.back() + len + 1);
+}
+
+void PagedText::append(std::string page, std::optional<PageLayout> layout) {
+  const std::size_t len = page.size();
+  pages_.emplace_back(std::move(page));
+  layouts_.push_back(std::move(layout));
+  offsets_.push_back(offsets_.back() + len + 1);
+}
+
+bool PagedText::hasLayout() const noexcept {
+  if (layouts_.empty())
+    return false;
+  for (const auto &l : layouts_) {
+    if (!l)
+      return false;
+  }
+  return true;
+}
+
+std::string_view PagedText::page(std::size_t i) const noexcept {
+  const Page &p = pages_[i];
+  if (const auto *buf = std::get_if<Handle<fz_buffer, BufferDrop>>(&p))
+    return bufferView(*buf);
+  return std::get<std::string>(p);
+}
+
+std::vector<std::string_view>
+PagedText::lines(std::vector<int> *pageEnds) const {
+  std::vector<std::string_view> out;
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    const std::string_view text = page(i);
+    std::size_t pos = 0;
+    for (std::size_t nl; (nl = text.find('\n', pos)) != std::string_view::npos;
+         pos = nl + 1)
+      out.push_back(text.substr(pos, nl - pos));
+    out.push_back(text.substr(pos)); // ended by the page separator
+    if (pageEnds)
+      pageEnds->push_back(static_cast<int>(out.size()) - 1);
+  }
+  return out;
+}
+
+std::string PagedText::str() const {
+  std::string out;
+  out.reserve(size());
+  for (std::size_t i = 0; i < pages_.size(); ++i) {
+    out.append(page(i));
+    out.push_back('\n');
+  }
+  return out;
+}
+
+std::ostream &operator<<(std::ostream &os, const PagedText &t) {
+  for (std::size_t i = 0; i < t.pages_.size(); ++i) {
+    const std::string_view p = t.page(i);
+    os.write(p.data(), static_cast<std::streamsize>(p.size()));
+    os.put('\n');
+  }
+  return os;
+}
@@ -2,6 +2,7 @@
 #include <mupdf/fitz.h>
 #include <string>
 
+#include "pdf/mapped_stream.hpp"
 #include "pdf/session.hpp"
 
 void FzContextDrop::operator()(fz_context *ctx) const noexcept {
@@ -15,8 +16,10 @@ void FzDocumentDrop::operator()(fz_document *doc) const noexcept {
 }
 
 // ----- PdfSession
-PdfSession::PdfSession() noexcept {
-  fz_context *raw = fz_new_context(nullptr, nullptr, FZ_STORE_UNLIMITED);
+PdfSession::PdfSession(std::size_t maxStore) noexcept {
+  locks_ = fz_locks_context{mutexes_.data(), &PdfSession::lock,
+                            &PdfSession::unlock};
+  fz_context *raw = fz_new_context(nullptr, &locks_, maxStore);
   if (!raw) {
     std::cerr << "Failed to create MuPDF context.\n";
     return;
@@ -33,17 +36,50 @@ PdfSession::PdfSession() noexcept {
 
 PdfSession::~PdfSession() noexcept = default;
 
+Handle<fz_context, FzContextDrop> PdfSession::clone() const noexcept {
+  fz_context *raw = nullptr;
+  if (ctx_) {
+    std::lock_guard lock(cloneMutex_);
+    raw = fz_clone_context(ctx_.get());
+  }
+  if (!raw)
+    std::cerr << "Failed to clone MuPDF context.\n";
+  return Handle<fz_context, FzContextDrop>(raw, FzContextDrop{});
+}
+
+void PdfSession::lock(void *user, int id) noexcept {
+  static_cast<std::mutex *>(user)[id].lock();
+}
+
+void PdfSession::unlock(void *user, int id) noexcept {
+  static_cast<std::mutex *>(user)[id].unlock();
+}
+
 // ----- PdfFile
-PdfFile::PdfFile(fz_context *ctx, std::string_view path) noexcept : ctx_(ctx) {
+PdfFile::PdfFile(fz_context *ctx, std::string_view path, Open mode) noexcept
+    : ctx_(ctx), path_(path), mode_(mode) {
   if (!ctx_)
     return;
 
   doc_.deleter().ctx = ctx_;
 
   fz_document *raw = nullptr;
-  std::string pathStr(path);
+  fz_stream *stm = nullptr;
+  // assigned inside fz_try and read after it (longjmp)
+  fz_var(stm);
+  fz_var(raw);
 
-  fz_try(ctx_) { raw = fz_open_document(ctx_, pathStr.c_str()); }
+  fz_try(ctx_) {
+    if (mode_ == Open::Mapped)
+      stm = openMappedStream(ctx_, path_);
+    if (stm)
+      raw = fz_open_document_with_stream(ctx_, path_.c_str(), stm);
+    else
+      raw = fz_open_document(ctx_, path_.c_str());
+  }
+  fz_always(ctx_) {
+    fz_drop_stream(ctx_, stm); // the document holds its own reference
+  }
   fz_catch(ctx_) {
     std::cerr << "Cannot open document: " << fz_caught_message(ctx_) << '\n';
     return;
@@ -0,0 +1,435 @@
+#include "pipeline/arrow_export.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <string_view>
+
+#include "content_codec.hpp"
+#include "content_store.hpp"
+
+static_assert(std::endian::native == std::endian::little,
+              "Arrow IPC is written in host byte order");
+
+namespace {
+
+// ───── FlatBuffers ─────
+// Just enough of a FlatBuffers builder for Arrow's Schema, Message and
+// Footer tables. Like the reference builder, the buffer grows towards the
+// front: children are written first and every offset points forward.
+// Positions (Ref) are counted from the end of the buffer.
+class FlatBuilder {
+public:
+  using Ref = std::uint32_t;
+
+  template <class T> void push(T v) {
+    const auto *p = reinterpret_cast<const std::uint8_t *>(&v);
+    buf_.insert(buf_.begin(), p, p + sizeof v);
+  }
+
+  // pads so that `extra` more bytes end on an `a`-byte boundary
+  void align(std::size_t a, std::size_t extra = 0) {
+    buf_.insert(buf_.begin(), (a - (buf_.size() + extra) % a) % a,
+                std::uint8_t{0});
+  }
+
+  Ref size() const noexcept { return static_cast<Ref>(buf_.size()); }
+
+  Ref string(std::string_view s) {
+    align(4, s.size() + 1);
+    buf_.insert(buf_.begin(), std::uint8_t{0});
+    buf_.insert(buf_.begin(), s.begin(), s.end());
+    push(static_cast<std::uint32_t>(s.size()));
+    return size();
+  }
+
+  template <class T> Ref structs(const std::vector<T> &v) {
+    align(8, v.size() * sizeof(T));
+    const auto *p = reinterpret_cast<const std::uint8_t *>(v.data());
+    buf_.insert(buf_.begin(), p, p + v.size() * sizeof(T));
+    push(static_cast<std::uint32_t>(v.size()));
+    return size();
+  }
+
+  Ref refs(const std::vector<Ref> &v) {
+    align(4, v.size() * 4);
+    for (auto it = v.rbegin(); it != v.rend(); ++it)
+      offset(*it);
+    push(static_cast<std::uint32_t>(v.size()));
+    return size();
+  }
+
+  void start() {
+    fields_.clear();
+    tableEnd_ = size();
+  }
+  template <class T> void field(std::uint16_t id, T v) {
+    align(sizeof v);
+    push(v);
+    fields_.push_back({id, size()});
+  }
+  void ref(std::uint16_t id, Ref r) {
+    offset(r);
+    fields_.push_back({id, size()});
+  }
+  Ref end() {
+    align(4);
+    push(std::int32_t{0}); // to the vtable, patched below
+    const Ref table = size();
+
+    std::uint16_t slots = 0;
+    for (const auto &f : fields_)
+      slots = std::max<std::uint16_t>(slots, f.id + 1);
+    std::vector<std::uint16_t> vt(2 + slots, 0);
+    vt[0] = static_cast<std::uint16_t>(vt.size() * 2);
+    vt[1] = static_cast<std::uint16_t>(table - tableEnd_);
+    for (const auto &f : fields_)
+      vt[2 + f.id] = static_cast<std::uint16_t>(table - f.at);
+    for (auto it = vt.rbegin(); it != vt.rend(); ++it)
+      push(*it);
+
+    const auto toVtable = static_cast<std::int32_t>(size() - table);
+    std::memcpy(buf_.data() + buf_.size() - table, &toVtable, 4);
+    return table;
+  }
+
+  std::vector<std::uint8_t> finish(Ref root) {
+    align(8, 4);
+    offset(root);
+    return std::move(buf_);
+  }
+
+private:
+  void offset(Ref r) {
+    align(4);
+    push(static_cast<std::uint32_t>(size() + 4 - r));
+  }
+
+  struct Slot {
+    std::uint16_t id;
+    Ref at;
+  };
+  std::vector<std::uint8_t> buf_;
+  std::vector<Slot> fields_;
+  Ref tableEnd_ = 0;
+};
+
+// ───── Arrow metadata ─────
+// Field ids and enum values from Arrow's Schema.fbs, Message.fbs, File.fbs.
+constexpr std::int16_t kMetadataV5 = 4;
+constexpr std::uint8_t kTypeInt = 2, kTypeUtf8 = 5;
+constexpr std::uint8_t kHeaderSchema = 1, kHeaderDictionary = 2,
+                       kHeaderRecordBatch = 3;
+
+struct FieldNode {
+  std::int64_t length;
+  std::int64_t nullCount;
+};
+struct BufferSpec {
+  std::int64_t offset;
+  std::int64_t length;
+};
+
+enum class Column { Dict, Int32, Utf8 };
+struct ColumnSpec {
+  std::string_view name;
+  Column kind;
+  std::int64_t dictId;
+};
+constexpr ColumnSpec kColumns[] = {
+    {"book_title", Column::Dict, 0}, {"chapter", Column::Dict, 1},
+    {"section_index", Column::Int32, -1}, {"title", Column::Dict, 2},
+    {"startline", Column::Int32, -1}, {"endline", Column::Int32, -1},
+    {"content", Column::Utf8, -1},
+};
+
+FlatBuilder::Ref int32Type(FlatBuilder &b) {
+  b.start();
+  b.field(0, std::int32_t{32});   // bitWidth
+  b.field(1, std::uint8_t{true}); // is_signed
+  return b.end();
+}
+
+FlatBuilder::Ref schema(FlatBuilder &b) {
+  std::vector<FlatBuilder::Ref> fields;
+  for (const auto &c : kColumns) {
+    const auto name = b.string(c.name);
+    FlatBuilder::Ref type = 0;
+    if (c.kind == Column::Int32) {
+      type = int32Type(b);
+    } else {
+      b.start(); // Utf8 has no fields
+      type = b.end();
+    }
+    FlatBuilder::Ref dict = 0;
+    if (c.kind == Column::Dict) {
+      const auto index = int32Type(b);
+      b.start();
+      b.field(0, c.dictId);
+      b.ref(1, index); // indexType
+      dict = b.end();
+    }
+    const auto children = b.refs({});
+
+    b.start();
+    b.ref(0, name);
+    b.field(1, std::uint8_t{false}); // nullable
+    b.field(2, c.kind == Column::Int32 ? kTypeInt : kTypeUtf8);
+    b.ref(3, type);
+    if (dict)
+      b.ref(4, dict);
+    b.ref(5, children);
+    fields.push_back(b.end());
+  }
+  const auto list = b.refs(fields);
+  b.start();
+  b.field(0, std::int16_t{0}); // little endian
+  b.ref(1, list);
+  return b.end();
+}
+
+// ───── Record batch bodies ─────
+class Body {
+public:
+  void node(std::size_t length) {
+    nodes_.push_back({static_cast<std::int64_t>(length), 0});
+    buffer(nullptr, 0); // no validity bitmap: nothing is null
+  }
+  void buffer(const void *p, std::size_t n) {
+    buffers_.push_back({static_cast<std::int64_t>(bytes_.size()),
+                        static_cast<std::int64_t>(n)});
+    bytes_.append(static_cast<const char *>(p), n);
+    bytes_.append((8 - bytes_.size() % 8) % 8, '\0');
+  }
+
+  void ints(const std::vector<std::int32_t> &v) {
+    node(v.size());
+    buffer(v.data(), v.size() * 4);
+  }
+  template <class Strings> bool strings(const Strings &v) {
+    std::vector<std::int32_t> offsets{0};
+    offsets.reserve(v.size() + 1);
+    std::string data;
+    for (const auto &s : v) {
+      if (data.size() + s.size() > INT32_MAX)
+        return false;
+      data += s;
+      offsets.push_back(static_cast<std::int32_t>(data.size()));
+    }
+    node(v.size());
+    buffer(offsets.data(), offsets.size() * 4);
+    buffer(data.data(), data.size());
+    return true;
+  }
+
+  // RecordBatch table of `length` rows describing this body
+  FlatBuilder::Ref table(FlatBuilder &b, std::size_t length) const {
+    const auto nodes = b.structs(nodes_);
+    const auto buffers = b.structs(buffers_);
+    b.start();
+    b.field(0, static_cast<std::int64_t>(length));
+    b.ref(1, nodes);
+    b.ref(2, buffers);
+    return b.end();
+  }
+  const std::string &bytes() const noexcept { return bytes_; }
+
+private:
+  std::string bytes_;
+  std::vector<FieldNode> nodes_;
+  std::vector<BufferSpec> buffers_;
+};
+
+std::vector<std::uint8_t> messageMeta(FlatBuilder &b, std::uint8_t type,
+                                      FlatBuilder::Ref header,
+                                      std::size_t bodyLength) {
+  b.start();
+  b.field(0, kMetadataV5);
+  b.field(1, type);
+  b.ref(2, header);
+  b.field(3, static_cast<std::int64_t>(bodyLength));
+  return b.finish(b.end());
+}
+
+constexpr char kMagic[8] = {'A', 'R', 'R', 'O', 'W', '1', 0, 0};
+
+} // namespace
+
+std::int32_t ArrowExport::Dictionary::id(const std::string &v) {
+  auto [it, inserted] =
+      ids.try_emplace(v, static_cast<std::int32_t>(values.size()));
+  if (inserted)
+    values.push_back(v);
+  return it->second;
+}
+
+ArrowExport::ArrowExport(std::filesystem::path path) noexcept
+    : path_(std::move(path)) {
+  tmp_ = path_;
+  tmp_ += ".tmp";
+  std::error_code ec;
+  if (path_.has_parent_path())
+    std::filesystem::create_directories(path_.parent_path(), ec);
+  os_.open(tmp_, std::ios::binary | std::ios::trunc);
+  if (!os_) {
+    std::cerr << "✗ cannot open " << tmp_ << " for write\n";
+    return;
+  }
+  os_.write(kMagic, sizeof kMagic);
+  pos_ = sizeof kMagic;
+
+  FlatBuilder b;
+  const auto s = schema(b);
+  message(messageMeta(b, kHeaderSchema, s, 0), {});
+  valid_ = static_cast<bool>(os_);
+}
+
+ArrowExport::Block ArrowExport::message(const std::vector<std::uint8_t> &meta,
+                                        const std::string &body) {
+  // meta is a finished flatbuffer, already a multiple of 8 bytes
+  const std::uint32_t continuation = 0xFFFFFFFF;
+  const auto metaLength = static_cast<std::int32_t>(meta.size());
+  os_.write(reinterpret_cast<const char *>(&continuation), 4);
+  os_.write(reinterpret_cast<const char *>(&metaLength), 4);
+  os_.write(reinterpret_cast<const char *>(meta.data()),
+            static_cast<std::streamsize>(meta.size()));
+  os_.write(body.data(), static_cast<std::streamsize>(body.size()));
+
+  const Block block{pos_, 8 + metaLength, 0,
+                    static_cast<std::int64_t>(body.size())};
+  pos_ += block.metaDataLength + block.bodyLength;
+  return block;
+}
+
+bool ArrowExport::add(const BookTitle &book,
+                      const std::vector<ChapterSegments> &segments) {
+  std::lock_guard lock(m_);
+  if (!valid_ || finished_)
+    return false;
+
+  std::vector<std::int32_t> bookIds, chapterIds, sectionIndex, titleIds,
+      startlines, endlines;
+  std::vector<std::string_view> contents;
+  std::vector<std::string> unpacked; // owns the packed rows' content
+  std::size_t packedRows = 0;
+  for (const auto &seg : segments)
+    for (const auto &row : seg.rows)
+      packedRows += !row.packed.dict.empty();
+  unpacked.reserve(packedRows); // views into it must stay put
+  for (const auto &seg : segments) {
+    const std::string chapter = std::filesystem::path(seg.file).stem().string();
+    std::int32_t i = 0;
+    for (const auto &row : seg.rows) {
+      bookIds.push_back(dicts_[0].id(book.value));
+      chapterIds.push_back(dicts_[1].id(chapter));
+      sectionIndex.push_back(i++);
+      titleIds.push_back(dicts_[2].id(row.title));
+      startlines.push_back(row.startline);
+      endlines.push_back(row.endline);
+      if (!row.packed.dict.empty()) {
+        auto plain = seg.codec ? seg.codec->unpack(row.packed) : std::nullopt;
+        if (!plain) {
+          std::cerr << "arrow: cannot unpack " << seg.file << "; '"
+                    << book.value << "' skipped\n";
+          return false;
+        }
+        contents.push_back(unpacked.emplace_back(std::move(*plain)));
+        continue;
+      }
+      if (row.ref.blob.empty()) {
+        contents.push_back(row.content);
+        continue;
+      }
+      // the file stands alone: referenced sections are written out in full
+      const auto text = sectionText(seg.text, row.ref);
+      if (!text) {
+        std::cerr << "arrow: text of " << seg.file << " is missing; '"
+                  << book.value << "' skipped\n";
+        return false;
+      }
+      contents.push_back(*text);
+    }
+  }
+  if (contents.empty())
+    return true;
+
+  Body batch;
+  batch.ints(bookIds);
+  batch.ints(chapterIds);
+  batch.ints(sectionIndex);
+  batch.ints(titleIds);
+  batch.ints(startlines);
+  batch.ints(endlines);
+  if (!batch.strings(contents)) {
+    std::cerr << "arrow: content of '" << book.value
+              << "' exceeds 2 GiB; book skipped\n";
+    return false;
+  }
+
+  // values first seen in this book go out as (delta) dictionary batches
+  for (std::int64_t id = 0; id < 3; ++id) {
+    auto &d = dicts_[id];
+    if (d.written == d.values.size())
+      continue;
+    Body body;
+    body.strings(std::vector<std::string_view>(d.values.begin() + d.written,
+                                               d.values.end()));
+    FlatBuilder b;
+    const auto data = body.table(b, d.values.size() - d.written);
+    b.start();
+    b.field(0, id);
+    b.ref(1, data);
+    b.field(2, std::uint8_t{d.written > 0}); // isDelta
+    const auto header = b.end();
+    dictBlocks_.push_back(message(
+        messageMeta(b, kHeaderDictionary, header, body.bytes().size()),
+        body.bytes()));
+    d.written = d.values.size();
+  }
+
+  FlatBuilder b;
+  const auto header = batch.table(b, contents.size());
+  batchBlocks_.push_back(message(
+      messageMeta(b, kHeaderRecordBatch, header, batch.bytes().size()),
+      batch.bytes()));
+  rows_ += contents.size();
+  return static_cast<bool>(os_);
+}
+
+bool ArrowExport::finish() {
+  std::lock_guard lock(m_);
+  if (!valid_ || finished_)
+    return valid_;
+  finished_ = true;
+
+  const std::uint32_t endOfStream[2] = {0xFFFFFFFF, 0};
+  os_.write(reinterpret_cast<const char *>(endOfStream), sizeof endOfStream);
+
+  FlatBuilder b;
+  const auto s = schema(b);
+  const auto dicts = b.structs(dictBlocks_);
+  const auto batches = b.structs(batchBlocks_);
+  b.start();
+  b.field(0, kMetadataV5);
+  b.ref(1, s);
+  b.ref(2, dicts);
+  b.ref(3, batches);
+  const auto footer = b.finish(b.end());
+  const auto footerLength = static_cast<std::int32_t>(footer.size());
+  os_.write(reinterpret_cast<const char *>(footer.data()),
+            static_cast<std::streamsize>(footer.size()));
+  os_.write(reinterpret_cast<const char *>(&footerLength), 4);
+  os_.write(kMagic, 6);
+  os_.close();
+
+  std::error_code ec;
+  if (os_.fail() || (std::filesystem::rename(tmp_, path_, ec), ec)) {
+    std::cerr << "✗ failed to write " << path_ << '\n';
+    valid_ = false;
+    return false;
+  }
+  std::cout << "✓ " << rows_ << " sections → " << path_ << '\n';
+  return true;
+}
@@ -0,0 +1,181 @@
+#include "pipeline/batch.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <numeric>
+
+#include "pipeline/manifest.hpp"
+#include "utils.hpp"
+#include "work_pool.hpp"
+
+namespace {
+
+double secondsSince(std::chrono::steady_clock::time_point t0) {
+  return std::chrono::duration<double>(std::chrono::steady_clock::now() - t0)
+      .count();
+}
+
+} // namespace
+
+// With a manifest directory, chapters whose rows did not change since the
+// book's last ingestion are skipped. seconds excludes the wait for the
+// repository.
+int BatchRunner::ingest(const std::filesystem::path &pdfPath,
+                        const BookResult &book, double &seconds) {
+  if (cfg_.manifestDir.empty()) {
+    std::lock_guard lock(ingestMutex_);
+    const auto t0 = std::chrono::steady_clock::now();
+    const int rc =
+        ingestor_->ingest_segments(book.segments, pdfPath, book.title);
+    seconds = secondsSince(t0);
+    return rc;
+  }
+
+  BuildManifest manifest(cfg_.manifestDir, pdfPath);
+  if (cfg_.force)
+    manifest.clearAll();
+  int rc = 0;
+  {
+    std::lock_guard lock(ingestMutex_);
+    const auto t0 = std::chrono::steady_clock::now();
+    rc = ingestChanged(*ingestor_, manifest, book.segments, pdfPath,
+                       book.title);
+    seconds = secondsSince(t0);
+  }
+  manifest.save();
+  return rc;
+}
+
+BatchRunner::BookStats
+BatchRunner::runOne(const std::filesystem::path &pdfPath) {
+  const auto t0 = std::chrono::steady_clock::now();
+  BookStats st;
+  st.pdf = pdfPath;
+
+  try {
+    auto ctx = session_->clone();
+    PdfFile pdf(ctx.get(), pdfPath.string(), cfg_.open);
+    if (!ctx || !pdf.isValid()) {
+      std::cerr << "Invalid PDF file: " << pdfPath << "\n";
+      st.rc = 1;
+    } else {
+      BookConfig bookCfg = cfg_.book;
+      if (!cfg_.manifestDir.empty())
+        bookCfg.codecDir = BuildManifest::bookDir(cfg_.manifestDir, pdfPath);
+      BookResult book;
+      st.rc = runBook(*session_, pdf, bookCfg, book);
+      st.title = book.title.value;
+      st.pages = book.totalPages;
+      st.chapters = book.chapters;
+      st.rssHighWater = book.rssHighWater;
+      for (const auto &seg : book.segments)
+        st.sections += seg.rows.size();
+      // same code as a failed --arrow export of a single book
+      if (st.rc == 0 && cfg_.arrow &&
+          !cfg_.arrow->add(book.title, book.segments))
+        st.rc = 6;
+      st.seconds = secondsSince(t0);
+      if (st.rc == 0)
+        st.rc = ingest(pdfPath, book, st.ingestSeconds);
+      return st;
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "batch: " << pdfPath << ": " << e.what() << '\n';
+    st.rc = 1;
+  }
+  st.seconds = secondsSince(t0);
+  return st;
+}
+
+std::vector<BatchRunner::BookStats>
+BatchRunner::run(const std::vector<std::filesystem::path> &pdfs) {
+  std::vector<BookStats> stats(pdfs.size());
+
+  // largest first: file size is a cheap stand-in for page count
+  std::vector<std::size_t> order(pdfs.size());
+  std::iota(order.begin(), order.end(), std::size_t{0});
+  std::vector<std::uintmax_t> sizes(pdfs.size(), 0);
+  for (std::size_t i = 0; i < pdfs.size(); ++i) {
+    std::error_code ec;
+    sizes[i] = std::filesystem::file_size(pdfs[i], ec);
+  }
+  std::stable_sort(order.begin(), order.end(),
+                   [&](std::size_t a, std::size_t b) {
+                     return sizes[a] > sizes[b];
+                   });
+
+  // a slot stays failed unless its book's task completes
+  for (std::size_t i = 0; i < pdfs.size(); ++i) {
+    stats[i].pdf = pdfs[i];
+    stats[i].rc = 1;
+  }
+  WorkStealingPool pool(cfg_.workers);
+  for (std::size_t i : order)
+    pool.submit([this, &pdfs, &stats, i] { stats[i] = runOne(pdfs[i]); });
+
+  std::cout << "Batch: " << pdfs.size() << " books on " << pool.workers()
+            << " workers\n";
+  pool.run();
+  std::cout << "Batch: " << pool.steals() << " books stolen across workers\n";
+  return stats;
+}
+
+std::vector<std::filesystem::path>
+BatchRunner::fromDirectory(const std::filesystem::path &dir) {
+  std::vector<std::filesystem::path> v;
+  for (const auto &path : FileIO::listChapters(dir, ".pdf"))
+    v.push_back(path);
+  return v;
+}
+
+std::vector<std::filesystem::path>
+BatchRunner::fromManifest(const std::filesystem::path &manifest) {
+  std::vector<std::filesystem::path> v;
+  const auto base = manifest.parent_path();
+  for (const auto &raw : FileIO::readLines(manifest)) {
+    const std::string ln = Text::trim(raw);
+    if (ln.empty() || ln.front() == '#')
+      continue;
+    std::filesystem::path p{ln};
+    v.push_back(p.is_relative() ? base / p : p);
+  }
+  return v;
+}
+
+void BatchRunner::report(const std::vector<BookStats> &stats,
+                         double wallSeconds, std::ostream &os) {
+  std::size_t ok = 0, pages = 0, sections = 0;
+  double busy = 0.0;
+
+  os << "\nBatch report\n";
+  for (const auto &s : stats) {
+    const double pps = s.seconds > 0 ? s.pages / s.seconds : 0.0;
+    os << (s.rc == 0 ? "  ✓ " : "  ✗ ") << s.pdf.filename().string() << ": "
+       << s.pages << " pages, " << s.chapters << " chapters, " << s.sections
+       << " sections in " << std::fixed << std::setprecision(2) << s.seconds
+       << "s (" << std::setprecision(1) << pps << " pages/s)";
+    if (s.ingestSeconds > 0)
+      os << ", ingested in " << std::setprecision(2) << s.ingestSeconds
+         << "s";
+    if (s.rssHighWater)
+      os << ", peak RSS " << (s.rssHighWater >> 20) << " MB";
+    if (s.rc != 0)
+      os << " rc=" << s.rc;
+    os << '\n';
+    ok += (s.rc == 0);
+    pages += static_cast<std::size_t>(s.pages);
+    sections += s.sections;
+    busy += s.seconds + s.ingestSeconds;
+  }
+
+  const double wall = wallSeconds > 0 ? wallSeconds : 1e-9;
+  os << "Total: " << ok << " / " << stats.size() << " books, " << pages
+     << " pages, " << sections << " sections in " << std::setprecision(2)
+     << wallSeconds << "s — " << std::setprecision(1) << pages / wall
+     << " pages/s, " << stats.size() * 60.0 / wall << " books/min"
+     << " (parallel speedup " << std::setprecision(2) << busy / wall
+     << "x)\n";
+}
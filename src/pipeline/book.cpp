@@ -0,0 +1,133 @@
+#include "pipeline/book.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <set>
+#include <sstream>
+
+#include "chapters.hpp"
+#include "content_store.hpp"
+#include "pdf/memory_budget.hpp"
+#include "pipeline/catalog.hpp"
+#include "pipeline/section_writer.hpp"
+#include "pipeline/slice_toc.hpp"
+#include "utils.hpp"
+
+std::shared_ptr<const ContentCodec>
+trainCodec(const std::vector<ChapterText> &texts) {
+  std::vector<std::string_view> pages;
+  for (const auto &t : texts)
+    for (std::size_t i = 0; i < t.body.pageCount(); ++i)
+      pages.push_back(t.body.page(i));
+  auto dict = ContentCodec::train(pages);
+  if (dict.empty()) {
+    std::cerr << "⚠️  too little text for a dictionary; content not packed\n";
+    return nullptr;
+  }
+  auto codec = std::make_shared<const ContentCodec>(std::move(dict));
+  if (!codec->isValid())
+    return nullptr;
+  std::cout << "◆ content dictionary " << codec->id() << '\n';
+  return codec;
+}
+
+std::shared_ptr<const ContentCodec>
+bookCodec(const std::vector<ChapterText> &texts,
+          const std::filesystem::path &dir, bool retrain) {
+  if (dir.empty())
+    return trainCodec(texts);
+  const auto file =
+      dir / ("content_dict.v" + std::to_string(ContentCodec::kTrainVersion));
+  if (!retrain) {
+    std::ifstream in(file, std::ios::binary);
+    if (in) {
+      std::ostringstream bytes;
+      bytes << in.rdbuf();
+      auto codec = std::make_shared<const ContentCodec>(bytes.str());
+      if (codec->isValid()) {
+        std::cout << "◆ content dictionary " << codec->id() << " (kept)\n";
+        return codec;
+      }
+    }
+  }
+  auto codec = trainCodec(texts);
+  if (codec && !FileIO::writeText(file, codec->dictionary()))
+    std::cerr << "⚠️  dictionary not kept; the next run trains another\n";
+  return codec;
+}
+
+int runBook(const PdfSession &session, const PdfFile &pdf,
+            const BookConfig &cfg, BookResult &out) {
+  const std::filesystem::path pdfPath{pdf.path()};
+  out.title = getBookTitle(pdf.ctx(), pdf.doc(), pdfPath);
+  std::cout << "Book Title ("
+            << (out.title.fromMetadata
+                    ? std::string("metadata: ") + out.title.source
+                    : "inferred")
+            << "): " << out.title.value << "\n";
+
+  std::vector<ChapterInfo> chapters;
+  ExtractConfig extractCfg = cfg.extract;
+  extractCfg.layout = extractCfg.layout || cfg.headings;
+  RssPeak peak;
+  extractCfg.peak = &peak;
+  const auto texts =
+      loadChapters(session, pdf, out.totalPages, chapters, extractCfg);
+  out.chapters = texts.size();
+  out.rssHighWater = peak.bytes();
+  if (texts.empty()) {
+    std::cerr << "No TOC; skipping chapter extraction.\n";
+    return 2;
+  }
+  if (cfg.dump)
+    ChapterWriter(cfg.chaptersDir.string()).write(texts);
+
+  const ChapterText *toc = Title::findToc(texts);
+  if (!toc) {
+    std::cerr << "TOC text not found among extracted chapters\n";
+    return 3;
+  }
+
+  std::cout << "Extracting TOC windows from " << toc->file << '\n';
+  const SliceToc slicer(
+      SliceToc::Config{cfg.minLinesBetweenChapters, cfg.tocDir});
+  const auto slices = slicer.run(*toc, Catalog::collect(texts));
+  if (cfg.dump)
+    slicer.write(slices);
+
+  const auto tocLookup = TocLookup::build(slices);
+  if (tocLookup.empty()) {
+    std::cerr << "No TOC slices produced from " << toc->file << ".\n";
+    return 4;
+  }
+
+  ContentStore blobs(cfg.blobsDir);
+  const auto codec = cfg.compress
+                         ? bookCodec(texts, cfg.codecDir, cfg.retrainCodec)
+                         : nullptr;
+  if (codec && cfg.dump)
+    blobs.put(codec->dictionary());
+  SectionWriter writer({cfg.minLinesBetweenChapters, cfg.outDir, cfg.headings,
+                        cfg.prettyJson, cfg.sectionRefs,
+                        cfg.dump ? &blobs : nullptr, codec},
+                       Matcher(cfg.matching));
+  out.segments.clear();
+  std::set<std::string> keep;
+  if (codec)
+    keep.insert(codec->id());
+  for (const auto &chapter : texts) {
+    auto seg = writer.runOne(chapter, tocLookup);
+    if (!seg)
+      continue;
+    if (cfg.dump) {
+      writer.write(*seg, cfg.chaptersDir / chapter.file);
+      if (!seg->text.empty())
+        keep.insert(ContentStore::id(seg->text));
+    }
+    out.segments.push_back(std::move(*seg));
+  }
+  // texts of chapters that changed or went, and dictionaries replaced
+  if (cfg.dump)
+    blobs.prune(keep);
+  return 0;
+}
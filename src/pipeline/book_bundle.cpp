@@ -0,0 +1,78 @@
+#include "pipeline/book_bundle.hpp"
+
+#include <iostream>
+
+std::vector<ChapterText> BookBundle::chapters() const {
+  std::vector<ChapterText> out;
+  for (const auto &name : bundle_->list(kChapters)) {
+    auto text = bundle_->read(name);
+    if (!text)
+      continue;
+    ChapterText chapter{name.substr(kChapters.size()), {}};
+    // PagedText terminates every page with its own '\n'
+    if (!text->empty()) {
+      if (text->back() == '\n')
+        text->pop_back();
+      chapter.body.append(std::move(*text));
+    }
+    out.push_back(std::move(chapter));
+  }
+  return out;
+}
+
+std::vector<TocSlice> BookBundle::tocSlices() const {
+  std::vector<TocSlice> out;
+  for (const auto &name : bundle_->list(kTocSections)) {
+    const auto text = bundle_->read(name);
+    if (!text)
+      continue;
+    TocSlice slice{name.substr(kTocSections.size()), 0, 0, {}};
+    std::string_view rest = *text;
+    while (!rest.empty()) {
+      const auto nl = rest.find('\n');
+      slice.lines.emplace_back(rest.substr(0, nl));
+      rest.remove_prefix(nl == std::string_view::npos ? rest.size() : nl + 1);
+    }
+    slice.end = static_cast<int>(slice.lines.size());
+    out.push_back(std::move(slice));
+  }
+  return out;
+}
+
+std::optional<ChapterSegments>
+BookBundle::segments(const std::string &file) const {
+  const auto text = bundle_->read(name(kSegments, file));
+  if (!text)
+    return std::nullopt;
+  return SectionWriter::parse(file, *text);
+}
+
+bool BookBundle::putChapters(const std::vector<ChapterText> &texts) {
+  bundle_->clear(kChapters);
+  bool ok = true;
+  for (const auto &t : texts)
+    ok = bundle_->put(name(kChapters, t.file), t.body.str()) && ok;
+  std::cout << "✓ " << texts.size() << " chapters → " << bundle_->path()
+            << '\n';
+  return ok;
+}
+
+bool BookBundle::putTocSlices(const std::vector<TocSlice> &slices) {
+  bundle_->clear(kTocSections);
+  bool ok = true;
+  std::string text;
+  for (const auto &s : slices) {
+    text.clear();
+    for (const auto &ln : s.lines)
+      text.append(ln).push_back('\n');
+    ok = bundle_->put(name(kTocSections, s.file), text) && ok;
+  }
+  std::cout << "◆ " << slices.size() << " TOC slices → " << bundle_->path()
+            << '\n';
+  return ok;
+}
+
+bool BookBundle::putSegments(const ChapterSegments &segments,
+                             const SectionWriter &writer) {
+  return bundle_->put(name(kSegments, segments.file), writer.json(segments));
+}
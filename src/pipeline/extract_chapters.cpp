@@ -1,16 +1,22 @@
 #include <iostream>
+#include <optional>
 
 #include "chapters.hpp"
+#include "pdf/memory_budget.hpp"
 #include "pdf/outline.hpp"
+#include "pdf/page_cache.hpp"
+#include "pdf/page_pool.hpp"
+#include "pdf/page_text.hpp"
 #include "pipeline/extract_chapters.hpp"
 #include "utils.hpp"
 
-bool extractChapters(const PdfSession &session, const PdfFile &pdf,
-                     int &totalPages, std::vector<ChapterInfo> &chapters,
-                     bool topLevelOnly) {
+namespace {
+
+bool planChapters(const PdfFile &pdf, int &totalPages, std::vector<ChapterInfo> &chapters,
+                  const ExtractConfig &cfg) {
   totalPages = pdf.pageCount();
 
-  auto outline = readOutline(session.ctx(), pdf.doc(), topLevelOnly);
+  auto outline = readOutline(pdf.ctx(), pdf.doc(), cfg.topLevelOnly);
   if (outline.empty()) {
     std::cout << "No Table of Contents found in this pdf\n";
     chapters.clear();
@@ -19,9 +25,74 @@ bool extractChapters(const PdfSession &session, const PdfFile &pdf,
 
   OutlineView::print(outline, totalPages);
   chapters = computeChapters(outline, totalPages);
-  ChapterReader reader(session.ctx(), pdf.doc());
-  ChapterWriter writer("chapters");
-  const std::size_t written = writer.writeAll(reader, chapters);
+  return true;
+}
+
+// Runs fn with a ChapterReader or a PagePool, backed by the page cache
+// when one is configured. The reader runs on pdf's context, which need not be
+// the session's own (batch workers pass a cloned one).
+template <class Fn>
+auto withPageSource(const PdfSession &session, const PdfFile &pdf,
+                    int totalPages, const ExtractConfig &cfg, Fn &&fn) {
+  std::optional<PageCache> cache;
+  if (!cfg.cacheDir.empty()) {
+    cache.emplace(cfg.cacheDir, pdf.path(), totalPages, kPageTextOptions);
+    if (!cache->isValid())
+      cache.reset();
+  }
+  const PageReadOptions opts{cache ? &*cache : nullptr, cfg.layout,
+                             cfg.budget, cfg.peak,
+                             pdf.mode() == PdfFile::Open::Mapped};
+
+  auto result = [&] {
+    if (cfg.threads == 1) {
+      ChapterReader reader(pdf.ctx(), pdf.doc(), opts);
+      return fn(reader);
+    }
+    PagePool pool(session, pdf.path(), cfg.threads, opts);
+    std::cout << "Extracting pages on " << pool.threads() << " threads\n";
+    return fn(pool);
+  }();
 
+  if (cache) {
+    cache->flush();
+    std::cout << "Page cache: " << cache->hits() << " hits, "
+              << cache->misses() << " misses\n";
+  }
+  if (cfg.budget) {
+    const std::size_t peak =
+        cfg.peak ? cfg.peak->bytes() : cfg.budget->highWater();
+    std::cout << "Peak RSS: " << (peak >> 20) << " MB of "
+              << (cfg.budget->peak() >> 20) << " MB budget\n";
+  }
+  return result;
+}
+
+} // namespace
+
+bool extractChapters(const PdfSession &session, const PdfFile &pdf,
+                     int &totalPages, std::vector<ChapterInfo> &chapters,
+                     const ExtractConfig &cfg) {
+  if (!planChapters(pdf, totalPages, chapters, cfg))
+    return false;
+
+  ChapterWriter writer(cfg.chaptersDir.string());
+  const std::size_t written =
+      withPageSource(session, pdf, totalPages, cfg, [&](const auto &source) {
+        return writer.writeAll(source, chapters);
+      });
   return written > 0;
 }
+
+std::vector<ChapterText> loadChapters(const PdfSession &session,
+                                      const PdfFile &pdf, int &totalPages,
+                                      std::vector<ChapterInfo> &chapters,
+                                      const ExtractConfig &cfg) {
+  if (!planChapters(pdf, totalPages, chapters, cfg))
+    return {};
+
+  return withPageSource(session, pdf, totalPages, cfg,
+                        [&](const auto &source) {
+                          return readChapters(source, chapters);
+                        });
+}
@@ -0,0 +1,296 @@
+#include "pipeline/manifest.hpp"
+
+#include <fstream>
+#include <iostream>
+#include <nlohmann/json.hpp>
+
+#include "utils.hpp"
+
+namespace {
+
+constexpr int kManifestVersion = 1;
+
+std::uint64_t parseHex(const std::string &s) {
+  try {
+    return std::stoull(s, nullptr, 16);
+  } catch (const std::exception &) {
+    return 0;
+  }
+}
+
+// what a chapter's ingestion depends on besides its rows
+std::uint64_t ingestKey(std::uint64_t rows, const std::filesystem::path &pdfPath,
+                        const BookTitle &book) {
+  return BuildManifest::key({Hash::hex(rows), pdfPath.string(), book.value,
+                             book.fromMetadata ? book.source : "filename"});
+}
+
+std::uint64_t rowsKey(const std::vector<SectionRow> &rows) {
+  std::uint64_t h = Hash::kSeed;
+  for (const auto &r : rows) {
+    h = BuildManifest::key({Hash::hex(h), r.title, std::to_string(r.startline),
+                            std::to_string(r.endline), r.content});
+    // the blob id covers the referenced text
+    if (!r.ref.blob.empty())
+      h = BuildManifest::key({Hash::hex(h), r.ref.blob,
+                              std::to_string(r.ref.offset),
+                              std::to_string(r.ref.length)});
+    if (!r.packed.dict.empty())
+      h = BuildManifest::key({Hash::hex(h), r.packed.dict,
+                              Hash::hex(Hash::fnv1a(r.packed.bytes))});
+  }
+  return h;
+}
+
+std::vector<std::string>
+stems(const std::vector<std::filesystem::path> &files) {
+  std::vector<std::string> out;
+  out.reserve(files.size());
+  for (const auto &f : files)
+    out.push_back(f.stem().string());
+  return out;
+}
+
+} // namespace
+
+std::filesystem::path
+BuildManifest::bookDir(const std::filesystem::path &root,
+                       const std::filesystem::path &pdfPath) {
+  std::error_code ec;
+  auto abs = std::filesystem::absolute(pdfPath, ec);
+  if (ec)
+    abs = pdfPath;
+  return root / (pdfPath.stem().string() + '-' +
+                 Hash::hex(Hash::fnv1a(abs.lexically_normal().string())));
+}
+
+BuildManifest::BuildManifest(const std::filesystem::path &root,
+                             const std::filesystem::path &pdfPath)
+    : file_(bookDir(root, pdfPath) / "manifest.json") {
+
+  std::ifstream is(file_);
+  if (!is)
+    return;
+  try {
+    nlohmann::json j;
+    is >> j;
+    if (j.value("version", 0) != kManifestVersion)
+      return;
+    for (const auto &[stage, items] : j.at("stages").items()) {
+      auto &entries = stages_[stage];
+      for (const auto &[item, e] : items.items())
+        entries[item] = Entry{parseHex(e.value("input", "")),
+                              parseHex(e.value("output", ""))};
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "manifest: ignoring " << file_ << ": " << e.what() << '\n';
+    stages_.clear();
+  }
+}
+
+std::uint64_t BuildManifest::key(std::initializer_list<std::string_view> parts) {
+  std::uint64_t h = Hash::kSeed;
+  for (auto p : parts) {
+    h = Hash::fnv1a(std::to_string(p.size()) + ':', h);
+    h = Hash::fnv1a(p, h);
+  }
+  return h;
+}
+
+std::uint64_t BuildManifest::fileKey(const std::filesystem::path &p) noexcept {
+  try {
+    return Hash::file(p);
+  } catch (const std::exception &) {
+    return 0;
+  }
+}
+
+bool BuildManifest::valid(const std::string &item, const Entry &e) const {
+  return e.output == 0 || fileKey(item) == e.output;
+}
+
+bool BuildManifest::fresh(std::string_view stage, const std::string &item,
+                          std::uint64_t input) const {
+  auto s = stages_.find(stage);
+  if (s == stages_.end())
+    return false;
+  auto it = s->second.find(item);
+  return it != s->second.end() && it->second.input == input &&
+         valid(item, it->second);
+}
+
+bool BuildManifest::stageFresh(std::string_view stage,
+                               std::uint64_t input) const {
+  auto s = stages_.find(stage);
+  if (s == stages_.end() || s->second.empty())
+    return false;
+  for (const auto &[item, e] : s->second) {
+    if (e.input != input || !valid(item, e))
+      return false;
+  }
+  return true;
+}
+
+void BuildManifest::record(std::string_view stage, const std::string &item,
+                           std::uint64_t input,
+                           const std::filesystem::path &output) {
+  Entry e{input, 0};
+  if (!output.empty()) {
+    e.output = fileKey(output);
+    if (e.output == 0)
+      return; // nothing usable was written
+  }
+  auto s = stages_.find(stage);
+  if (s == stages_.end())
+    s = stages_.emplace(std::string(stage), decltype(s->second){}).first;
+  s->second[item] = e;
+}
+
+void BuildManifest::clear(std::string_view stage) {
+  auto s = stages_.find(stage);
+  if (s != stages_.end())
+    stages_.erase(s);
+}
+
+bool BuildManifest::save() const {
+  nlohmann::json stages = nlohmann::json::object();
+  for (const auto &[stage, items] : stages_) {
+    nlohmann::json js = nlohmann::json::object();
+    for (const auto &[item, e] : items) {
+      nlohmann::json je = {{"input", Hash::hex(e.input)}};
+      if (e.output)
+        je["output"] = Hash::hex(e.output);
+      js[item] = std::move(je);
+    }
+    stages[stage] = std::move(js);
+  }
+  const nlohmann::json j = {{"version", kManifestVersion},
+                            {"stages", std::move(stages)}};
+
+  std::error_code ec;
+  std::filesystem::create_directories(file_.parent_path(), ec);
+  auto tmp = file_;
+  tmp += ".tmp";
+  if (!FileIO::writeText(tmp, j.dump(2)))
+    return false;
+  std::filesystem::rename(tmp, file_, ec);
+  if (ec) {
+    std::cerr << "manifest: cannot write " << file_ << ": " << ec.message()
+              << '\n';
+    return false;
+  }
+  return true;
+}
+
+// ───── incremental ingestion ─────────────────────────────────────────────────
+int ingestChanged(Ingestor &ingestor, BuildManifest &manifest,
+                  const std::filesystem::path &outDir,
+                  const std::filesystem::path &pdfPath, const BookTitle &book) {
+  const auto files = FileIO::listChapters(outDir, ".json");
+  if (files.empty()) {
+    std::cerr << "ingest: no JSON files found in " << outDir << "\n";
+    return 2;
+  }
+
+  std::size_t skipped = 0, changed = 0, sections = 0, failed = 0;
+  for (const auto &path : files) {
+    const std::string item = path.filename().string();
+    const auto input =
+        ingestKey(BuildManifest::fileKey(path), pdfPath, book);
+    if (manifest.fresh(BuildManifest::kIngest, item, input)) {
+      ++skipped;
+      continue;
+    }
+    const auto counts = ingestor.ingest_chapter_file(path, pdfPath, book);
+    changed += counts.changed;
+    sections += counts.total;
+    // a chapter that failed stays stale and is ingested again next run
+    if (counts.ok)
+      manifest.record(BuildManifest::kIngest, item, input);
+    else
+      ++failed;
+  }
+  ingestor.removeMissingChapters(book, stems(files));
+  ingestor.pruneTexts();
+
+  std::cout << "DB summary: upserted/updated " << changed << " / " << sections
+            << " sections across " << files.size() - skipped
+            << " chapter files (" << skipped << " unchanged, skipped"
+            << (failed ? ", " + std::to_string(failed) + " failed" : "")
+            << ").\n";
+  return failed ? Ingestor::kIncomplete : 0;
+}
+
+int ingestChanged(ConcurrentIngestor &ingestor, BuildManifest &manifest,
+                  const std::filesystem::path &outDir,
+                  const std::filesystem::path &pdfPath, const BookTitle &book) {
+  const auto files = FileIO::listChapters(outDir, ".json");
+  if (files.empty()) {
+    std::cerr << "ingest: no JSON files found in " << outDir << "\n";
+    return 2;
+  }
+
+  std::vector<std::filesystem::path> stale;
+  std::map<std::filesystem::path, std::uint64_t> inputs;
+  for (const auto &path : files) {
+    const auto input =
+        ingestKey(BuildManifest::fileKey(path), pdfPath, book);
+    if (!manifest.fresh(BuildManifest::kIngest, path.filename().string(),
+                        input)) {
+      stale.push_back(path);
+      inputs.emplace(path, input);
+    }
+  }
+
+  const auto stats = ingestor.ingest(stale, stems(files), pdfPath, book);
+  for (const auto &path : stats.ingested)
+    manifest.record(BuildManifest::kIngest, path.filename().string(),
+                    inputs.at(path));
+
+  const std::size_t skipped = files.size() - stale.size();
+  std::cout << "DB summary: upserted/updated " << stats.changed << " / "
+            << stats.sections << " sections across " << stale.size()
+            << " chapter files (" << skipped << " unchanged, skipped"
+            << (stats.failed ? ", " + std::to_string(stats.failed) + " failed"
+                             : "")
+            << ").\n";
+  ConcurrentIngestor::report(stats, std::cout);
+  return stats.failed ? Ingestor::kIncomplete : 0;
+}
+
+int ingestChanged(Ingestor &ingestor, BuildManifest &manifest,
+                  const std::vector<ChapterSegments> &segments,
+                  const std::filesystem::path &pdfPath, const BookTitle &book) {
+  if (segments.empty()) {
+    std::cerr << "ingest: no chapter segments to ingest\n";
+    return 2;
+  }
+
+  std::size_t skipped = 0, changed = 0, sections = 0, failed = 0;
+  std::vector<std::string> chapters;
+  for (const auto &seg : segments) {
+    chapters.push_back(std::filesystem::path(seg.file).stem().string());
+    const auto input = ingestKey(rowsKey(seg.rows), pdfPath, book);
+    if (manifest.fresh(BuildManifest::kIngest, seg.file, input)) {
+      ++skipped;
+      continue;
+    }
+    const auto counts = ingestor.ingest_rows(seg.file, seg.rows, pdfPath,
+                                             book, seg.text, seg.codec.get());
+    changed += counts.changed;
+    sections += counts.total;
+    if (counts.ok)
+      manifest.record(BuildManifest::kIngest, seg.file, input);
+    else
+      ++failed;
+  }
+  ingestor.removeMissingChapters(book, chapters);
+  ingestor.pruneTexts();
+
+  std::cout << "DB summary: upserted/updated " << changed << " / " << sections
+            << " sections across " << segments.size() - skipped
+            << " chapters (" << skipped << " unchanged, skipped"
+            << (failed ? ", " + std::to_string(failed) + " failed" : "")
+            << ").\n";
+  return failed ? Ingestor::kIncomplete : 0;
+}
@@ -1,67 +1,165 @@
 #include "pipeline/section_writer.hpp"
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <nlohmann/json.hpp>
+#include <sstream>
+#include <stdexcept>
 
+#include "json_writer.hpp"
+#include "line_table.hpp"
 #include "types.hpp"
 #include "utils.hpp"
 
 namespace {
 
-struct SectionRow {
-  std::string title;
-  int startline{};
-  int endline{};
-  std::string content;
-};
-
-static void to_json(nlohmann::json &j, const SectionRow &s) {
-  j = {{"title", s.title},
-       {"startline", s.startline},
-       {"endline", s.endline},
-       {"content", s.content}};
+// lines [start, end] joined by '\n'. Lines cut from one buffer (a mapped
+// file, a page) already sit that way, so the result is a view of the
+// source; otherwise it is assembled in scratch. breaks holds, in order, the
+// lines whose '\n' is not in their buffer (the last line of a page):
+// adjacency alone cannot tell, and the byte after a view is not ours to read.
+static std::string_view joined(const std::vector<std::string_view> &lines,
+                               const std::vector<int> &breaks, int start,
+                               int end, std::string &scratch) {
+  const auto brk = std::lower_bound(breaks.begin(), breaks.end(), start);
+  bool contiguous = brk == breaks.end() || *brk >= end;
+  for (int i = start; contiguous && i < end; ++i)
+    contiguous = lines[i + 1].data() == lines[i].data() + lines[i].size() + 1;
+  if (contiguous)
+    return {lines[start].data(), static_cast<std::size_t>(
+                                     lines[end].data() + lines[end].size() -
+                                     lines[start].data())};
+
+  scratch.clear();
+  for (int i = start; i <= end; ++i) {
+    scratch += lines[i];
+    if (i != end)
+      scratch.push_back('\n');
+  }
+  return scratch;
 }
 
+// With blob set, rows point into the chapter text: every line followed by
+// '\n', as a mapped chapter file and PagedText::str() both lay it out.
 static std::vector<SectionRow>
 make_rows(const std::vector<Section> &segments,
-          const std::vector<std::string> &lines) {
+          const std::vector<std::string_view> &lines,
+          const std::vector<int> &breaks, const std::string *blob,
+          const ContentCodec *codec) {
   std::vector<SectionRow> rows;
   rows.reserve(segments.size());
   int sub_no = 1;
+  std::string scratch;
+
+  std::vector<std::uint64_t> lineStart;
+  if (blob) {
+    lineStart.reserve(lines.size() + 1);
+    lineStart.push_back(0);
+    for (const auto &ln : lines)
+      lineStart.push_back(lineStart.back() + ln.size() + 1);
+  }
 
   for (auto [start, end, toc_idx] : segments) {
     std::string title = (toc_idx == -1)
                             ? "introduction"
                             : ("subsection" + std::to_string(sub_no++));
 
-    std::string content;
-    content.reserve(256);
-    for (int i = start; i <= end; ++i) {
-      content += lines[i];
-      if (i != end)
-        content.push_back('\n');
-    }
-
-    rows.push_back(SectionRow{.title = std::move(title),
-                              .startline = start,
-                              .endline = end,
-                              .content = Text::trim(content)});
+    const std::string_view text = joined(lines, breaks, start, end, scratch);
+    const std::string_view trimmed = Text::trimView(text);
+    SectionRow row{.title = std::move(title),
+                   .startline = start,
+                   .endline = end,
+                   .content = {},
+                   .ref = {},
+                   .packed = {}};
+    if (blob)
+      row.ref = SectionRef{
+          *blob,
+          lineStart[start] +
+              static_cast<std::uint64_t>(trimmed.data() - text.data()),
+          trimmed.size()};
+    else if (auto packed = codec ? codec->pack(trimmed) : std::nullopt)
+      row.packed = std::move(*packed);
+    else // the only copy of the text: into the row that leaves this stage
+      row.content = std::string(trimmed);
+    rows.push_back(std::move(row));
   }
   return rows;
 }
 
-static nlohmann::json rows_to_json(const std::vector<SectionRow> &rows) {
-  nlohmann::json::array_t arr;
+// keys in the order nlohmann's std::map-backed objects printed them
+static void write_rows(std::ostream &os, const std::vector<SectionRow> &rows,
+                       bool pretty) {
+  JsonWriter w(os, {.pretty = pretty});
+  w.beginArray();
   for (const auto &r : rows) {
-    nlohmann::json jr;
-    to_json(jr, r);
-    arr.push_back(std::move(jr));
+    w.beginObject();
+    if (!r.ref.blob.empty()) {
+      w.key("blob");
+      w.value(r.ref.blob);
+      w.key("endline");
+      w.value(r.endline);
+      w.key("length");
+      w.value(static_cast<std::int64_t>(r.ref.length));
+      w.key("offset");
+      w.value(static_cast<std::int64_t>(r.ref.offset));
+      w.key("startline");
+      w.value(r.startline);
+      w.key("title");
+      w.value(r.title);
+      w.endObject();
+      continue;
+    }
+    if (!r.packed.dict.empty()) {
+      w.key("chars");
+      w.value(static_cast<std::int64_t>(r.packed.chars));
+      w.key("codec");
+      w.value(ContentCodec::kVersion);
+      w.key("dict");
+      w.value(r.packed.dict);
+      w.key("endline");
+      w.value(r.endline);
+      w.key("packed");
+      w.value(Base64::encode(r.packed.bytes));
+      w.key("startline");
+      w.value(r.startline);
+      w.key("title");
+      w.value(r.title);
+      w.endObject();
+      continue;
+    }
+    w.key("content");
+    w.value(r.content);
+    w.key("endline");
+    w.value(r.endline);
+    w.key("startline");
+    w.value(r.startline);
+    w.key("title");
+    w.value(r.title);
+    w.endObject();
   }
-  return nlohmann::json(std::move(arr));
+  w.endArray();
 }
 
 } // namespace
 
+std::vector<SectionRow>
+SectionWriter::segment(const std::string &chapTitle,
+                       const std::vector<std::string> &tocLines,
+                       const std::vector<std::string_view> &allLines,
+                       const std::vector<int> &breaks,
+                       const std::vector<int> *candidates,
+                       const std::string *blob) const {
+  const auto matches =
+      candidates
+          ? matcher_.matchIndices(tocLines, allLines, chapTitle, *candidates)
+          : matcher_.matchIndices(tocLines, allLines, chapTitle);
+  const auto segments = segmenter_.buildSections(
+      matches, static_cast<int>(allLines.size()), cfg_.minLinesBetweenChapters);
+  return make_rows(segments, allLines, breaks, blob, cfg_.codec.get());
+}
+
 bool SectionWriter::runOne(
     const std::filesystem::path &chapPath,
     const std::unordered_map<std::string, std::vector<std::filesystem::path>>
@@ -76,20 +174,130 @@ bool SectionWriter::runOne(
 
   const auto tocPath = it->second.front();
   const auto tocLines = FileIO::readLines(tocPath);
-  const auto allLines = FileIO::readLines(chapPath);
+  const LineTable chapter(chapPath);
+  if (!chapter.isValid())
+    return false;
+  const auto allLines = chapter.views();
 
-  const auto matches = matcher_.matchIndices(tocLines, allLines, chapTitle);
-  const auto segments = segmenter_.buildSections(
-      matches, static_cast<int>(allLines.size()), cfg_.minLinesBetweenChapters);
+  std::string blob;
+  if (cfg_.byReference) {
+    blob = ContentStore::id(chapter.bytes());
+    // linked to the chapter file rather than copied next to it
+    if (cfg_.blobs && !cfg_.blobs->put(chapter.bytes(), chapPath))
+      return false;
+  }
+  write(ChapterSegments{chapPath.stem().string() + ".json",
+                        segment(chapTitle, tocLines, allLines, {}, nullptr,
+                                cfg_.byReference ? &blob : nullptr),
+                        {}, cfg_.codec});
+  return true;
+}
+
+std::optional<ChapterSegments> SectionWriter::runOne(
+    const ChapterText &chapter,
+    const std::unordered_map<std::string, const TocSlice *> &tocLookup) const {
 
-  const auto rows = make_rows(segments, allLines);
-  const auto j = rows_to_json(rows);
+  const std::string chapTitle = Title::extractChapterTitle(chapter.file);
+  auto it = tocLookup.find(chapTitle);
+  if (it == tocLookup.end()) {
+    std::cerr << "⚠️  no TOC found for chapter '" << chapTitle << "'\n";
+    return std::nullopt;
+  }
+
+  std::vector<int> pageEnds;
+  const auto allLines = chapter.body.lines(&pageEnds);
+  std::vector<int> candidates;
+  if (cfg_.headings && chapter.body.hasLayout())
+    candidates = headings_.candidates(allLines, chapter.body.layouts());
 
+  ChapterSegments out{
+      std::filesystem::path(chapter.file).stem().string() + ".json", {}, {},
+      cfg_.codec};
+  std::string blob;
+  if (cfg_.byReference) {
+    out.text = chapter.body.str();
+    blob = ContentStore::id(out.text);
+  }
+  out.rows = segment(chapTitle, it->second->lines, allLines, pageEnds,
+                     candidates.empty() ? nullptr : &candidates,
+                     cfg_.byReference ? &blob : nullptr);
+  return out;
+}
+
+void SectionWriter::write(const ChapterSegments &segments,
+                          const std::filesystem::path &source) const {
+  if (cfg_.blobs && !segments.text.empty() &&
+      !cfg_.blobs->put(segments.text, source))
+    throw std::runtime_error("SectionWriter: failed to store the text of " +
+                             segments.file);
   std::filesystem::create_directories(cfg_.outDir);
-  const auto outPath =
-      std::filesystem::path(cfg_.outDir) / (chapPath.stem().string() + ".json");
-  FileIO::writeJson(outPath, j);
+  const auto outPath = std::filesystem::path(cfg_.outDir) / segments.file;
+  std::ofstream os(outPath, std::ios::binary);
+  if (!os)
+    throw std::runtime_error("SectionWriter: failed to open " +
+                             outPath.string());
+  write_rows(os, segments.rows, cfg_.pretty);
+  if (!os.flush()) { // a full disk: no truncated file may pass for output
+    os.close();
+    std::error_code ec;
+    std::filesystem::remove(outPath, ec);
+    throw std::runtime_error("SectionWriter: failed to write " +
+                             outPath.string());
+  }
 
-  std::cout << "✓ " << j.size() << " segments → " << outPath << '\n';
-  return true;
+  std::cout << "✓ " << segments.rows.size() << " segments → " << outPath
+            << '\n';
+}
+
+std::string SectionWriter::json(const ChapterSegments &segments) const {
+  std::ostringstream os;
+  write_rows(os, segments.rows, cfg_.pretty);
+  return std::move(os).str();
+}
+
+std::optional<ChapterSegments>
+SectionWriter::read(const std::filesystem::path &jsonPath) {
+  std::ifstream is(jsonPath, std::ios::binary);
+  if (!is) {
+    std::cerr << "✗ cannot open " << jsonPath << '\n';
+    return std::nullopt;
+  }
+  std::ostringstream text;
+  text << is.rdbuf();
+  return parse(jsonPath.filename().string(), text.view());
+}
+
+std::optional<ChapterSegments> SectionWriter::parse(std::string file,
+                                                    std::string_view json) {
+  ChapterSegments out{std::move(file), {}, {}, {}};
+  try {
+    const auto j = nlohmann::json::parse(json);
+    if (!j.is_array())
+      return std::nullopt;
+    out.rows.reserve(j.size());
+    for (const auto &item : j) {
+      SectionRow row{
+          .title = item.value("title", ""),
+          .startline = item.value("startline", 0),
+          .endline = item.value("endline", 0),
+          .content = item.value("content", ""),
+          .ref = {item.value("blob", ""), item.value("offset", std::uint64_t{}),
+                  item.value("length", std::uint64_t{})},
+          .packed = {}};
+      if (item.contains("packed")) {
+        auto bytes = Base64::decode(item.value("packed", ""));
+        if (item.value("codec", 0) != ContentCodec::kVersion || !bytes) {
+          std::cerr << "✗ " << out.file << ": unsupported packed content\n";
+          return std::nullopt;
+        }
+        row.packed = {item.value("dict", ""), std::move(*bytes),
+                      item.value("chars", std::uint64_t{})};
+      }
+      out.rows.push_back(std::move(row));
+    }
+  } catch (const std::exception &e) {
+    std::cerr << "✗ " << out.file << ": " << e.what() << '\n';
+    return std::nullopt;
+  }
+  return out;
 }
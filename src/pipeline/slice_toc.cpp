@@ -35,36 +35,40 @@ bool SliceToc::isValid(int start, int end) const noexcept {
   return (end - start) >= cfg_.minLinesBetweenChapters;
 }
 
-int SliceToc::writeSlice(const std::vector<std::string> &tocLines, int start,
-                         int end, const std::filesystem::path &outFile) const {
+std::vector<std::string>
+SliceToc::keepLines(const std::vector<std::string> &tocLines, int start,
+                    int end) const {
+  std::vector<std::string> kept;
+  for (int i = start; i < end; ++i) {
+    const auto &ln = tocLines[i];
+    if (!ln.empty() && !Text::looksLikePageNo(ln))
+      kept.push_back(ln);
+  }
+  return kept;
+}
+
+int SliceToc::writeSlice(const TocSlice &slice,
+                         const std::filesystem::path &outFile) const {
   std::ofstream os(outFile);
   if (!os) {
     std::cerr << "Cannot open " << outFile << " for write\n";
     return 0;
   }
-  int written = 0;
-  for (int i = start; i < end; ++i) {
-    const auto &ln = tocLines[i];
-    if (!ln.empty() && !Text::looksLikePageNo(ln)) {
-      os << ln << '\n';
-      ++written;
-    }
-  }
-  return written;
+  for (const auto &ln : slice.lines)
+    os << ln << '\n';
+  return static_cast<int>(slice.lines.size());
 }
 
-std::size_t SliceToc::run(const std::filesystem::path &tocPath,
-                          const std::vector<ChapterMatch> &files) const {
-  const auto tocLines = readTocLines(tocPath);
+std::vector<TocSlice>
+SliceToc::slice(const std::vector<std::string> &tocLines,
+                const std::vector<ChapterMatch> &files) const {
+  std::vector<TocSlice> slices;
   if (tocLines.empty())
-    return 0;
+    return slices;
 
   const auto tocNorm = normalize(tocLines);
   const auto positions = computePositions(tocNorm, files);
 
-  std::filesystem::create_directories(cfg_.outDir);
-
-  std::size_t filesWritten = 0;
   for (size_t idx = 0; idx + 1 < files.size(); ++idx) {
     const int start = positions[idx];
     const int end = positions[idx + 1];
@@ -73,12 +77,36 @@ std::size_t SliceToc::run(const std::filesystem::path &tocPath,
 
     const std::string stem =
         std::filesystem::path(files[idx].file).stem().string();
-    const auto out = std::filesystem::path(cfg_.outDir) / (stem + ".txt");
+    slices.push_back(
+        TocSlice{stem + ".txt", start, end, keepLines(tocLines, start, end)});
+  }
+  return slices;
+}
+
+std::size_t SliceToc::write(const std::vector<TocSlice> &slices) const {
+  std::filesystem::create_directories(cfg_.outDir);
 
-    const int written = writeSlice(tocLines, start, end, out);
+  for (const auto &s : slices) {
+    const auto out = std::filesystem::path(cfg_.outDir) / s.file;
+    const int written = writeSlice(s, out);
     std::cout << "◆ wrote " << written << " lines → " << out << "  (slice "
-              << start << " .. " << (end - 1) << ")\n";
-    ++filesWritten;
+              << s.start << " .. " << (s.end - 1) << ")\n";
   }
-  return filesWritten;
+  return slices.size();
+}
+
+std::size_t SliceToc::run(const std::filesystem::path &tocPath,
+                          const std::vector<ChapterMatch> &files) const {
+  const auto tocLines = readTocLines(tocPath);
+  if (tocLines.empty())
+    return 0;
+  return write(slice(tocLines, files));
+}
+
+std::vector<TocSlice> SliceToc::run(const ChapterText &toc,
+                                    const std::vector<ChapterMatch> &files) const {
+  std::vector<std::string> tocLines;
+  for (std::string_view ln : toc.body.lines())
+    tocLines.push_back(Text::trim(std::string(ln)));
+  return slice(tocLines, files);
 }
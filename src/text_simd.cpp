@@ -0,0 +1,166 @@
+#include "text_simd.hpp"
+
+#include <bit>
+
+// BOOKSLICE_NO_SIMD keeps only the per-byte loops, for comparing the two
+// (bench/text_simd_bench.cpp)
+#if defined(__SSE2__) && !defined(BOOKSLICE_NO_SIMD)
+#define TEXT_SIMD_SSE2 1
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+constexpr bool isUpper(unsigned char c) noexcept {
+  return static_cast<unsigned char>(c - 'A') < 26;
+}
+constexpr bool isAlpha(unsigned char c) noexcept {
+  return static_cast<unsigned char>((c | 0x20) - 'a') < 26;
+}
+constexpr bool isAlnum(unsigned char c) noexcept {
+  return isAlpha(c) || static_cast<unsigned char>(c - '0') < 10;
+}
+constexpr bool isSpace(unsigned char c) noexcept {
+  return c == ' ' || static_cast<unsigned char>(c - '\t') < 5; // \t..\r
+}
+constexpr char lower(unsigned char c) noexcept {
+  return static_cast<char>(isUpper(c) ? c | 0x20 : c);
+}
+
+#ifdef TEXT_SIMD_SSE2
+constexpr std::size_t kBlock = 16;
+
+// Signed byte compares: bytes >= 0x80 are negative and never in range.
+inline __m128i inRange(__m128i v, char lo, char hi) noexcept {
+  return _mm_and_si128(_mm_cmpgt_epi8(v, _mm_set1_epi8(lo - 1)),
+                       _mm_cmplt_epi8(v, _mm_set1_epi8(hi + 1)));
+}
+inline __m128i upperMask(__m128i v) noexcept { return inRange(v, 'A', 'Z'); }
+inline __m128i alphaMask(__m128i v) noexcept {
+  return inRange(_mm_or_si128(v, _mm_set1_epi8(0x20)), 'a', 'z');
+}
+inline __m128i spaceMask(__m128i v) noexcept {
+  return _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')),
+                      inRange(v, '\t', '\r'));
+}
+inline __m128i lowerBlock(__m128i v) noexcept {
+  return _mm_or_si128(v, _mm_and_si128(upperMask(v), _mm_set1_epi8(0x20)));
+}
+inline __m128i load(const char *p) noexcept {
+  return _mm_loadu_si128(reinterpret_cast<const __m128i *>(p));
+}
+inline void store(char *p, __m128i v) noexcept {
+  _mm_storeu_si128(reinterpret_cast<__m128i *>(p), v);
+}
+inline unsigned bits(__m128i m) noexcept {
+  return static_cast<unsigned>(_mm_movemask_epi8(m));
+}
+#endif
+
+} // namespace
+
+void TextSimd::toLower(char *s, std::size_t n) noexcept {
+  std::size_t i = 0;
+#ifdef TEXT_SIMD_SSE2
+  for (; i + kBlock <= n; i += kBlock)
+    store(s + i, lowerBlock(load(s + i)));
+#endif
+  for (; i < n; ++i)
+    s[i] = lower(static_cast<unsigned char>(s[i]));
+}
+
+std::size_t TextSimd::lowerAlnum(const char *in, std::size_t n,
+                                 char *out) noexcept {
+  std::size_t i = 0, k = 0;
+#ifdef TEXT_SIMD_SSE2
+  for (; i + kBlock <= n; i += kBlock) {
+    const __m128i v = load(in + i);
+    const __m128i lo = lowerBlock(v);
+    unsigned keep = bits(
+        _mm_or_si128(alphaMask(v), inRange(v, '0', '9')));
+    if (keep == 0xFFFF) {
+      store(out + k, lo);
+      k += kBlock;
+      continue;
+    }
+    alignas(16) char buf[kBlock];
+    store(buf, lo);
+    for (; keep; keep &= keep - 1)
+      out[k++] = buf[std::countr_zero(keep)];
+  }
+#endif
+  for (; i < n; ++i) {
+    const auto c = static_cast<unsigned char>(in[i]);
+    if (isAlnum(c))
+      out[k++] = lower(c);
+  }
+  return k;
+}
+
+std::size_t TextSimd::collapseWhitespace(const char *in, std::size_t n,
+                                         char *out) noexcept {
+  std::size_t i = 0, k = 0;
+  bool inSpace = false;
+  auto scalar = [&](std::size_t end) {
+    for (; i < end; ++i) {
+      const auto c = static_cast<unsigned char>(in[i]);
+      if (isSpace(c)) {
+        inSpace = true;
+        continue;
+      }
+      if (inSpace && k)
+        out[k++] = ' ';
+      out[k++] = static_cast<char>(c);
+      inSpace = false;
+    }
+  };
+#ifdef TEXT_SIMD_SSE2
+  while (i + kBlock <= n) {
+    const __m128i v = load(in + i);
+    if (bits(spaceMask(v)) != 0) {
+      scalar(i + kBlock);
+      continue;
+    }
+    // no whitespace: the block is copied as is
+    if (inSpace && k)
+      out[k++] = ' ';
+    inSpace = false;
+    store(out + k, v);
+    k += kBlock;
+    i += kBlock;
+  }
+#endif
+  scalar(n);
+  return k;
+}
+
+bool TextSimd::hasLetters(const char *s, std::size_t n) noexcept {
+  std::size_t i = 0;
+#ifdef TEXT_SIMD_SSE2
+  for (; i + kBlock <= n; i += kBlock)
+    if (bits(alphaMask(load(s + i))))
+      return true;
+#endif
+  for (; i < n; ++i)
+    if (isAlpha(static_cast<unsigned char>(s[i])))
+      return true;
+  return false;
+}
+
+void TextSimd::countLetters(const char *s, std::size_t n, int &letters,
+                            int &uppers) noexcept {
+  std::size_t i = 0;
+  letters = uppers = 0;
+#ifdef TEXT_SIMD_SSE2
+  for (; i + kBlock <= n; i += kBlock) {
+    const __m128i v = load(s + i);
+    letters += std::popcount(bits(alphaMask(v)));
+    uppers += std::popcount(bits(upperMask(v)));
+  }
+#endif
+  for (; i < n; ++i) {
+    const auto c = static_cast<unsigned char>(s[i]);
+    letters += isAlpha(c);
+    uppers += isUpper(c);
+  }
+}
@@ -5,39 +5,42 @@
 #include <iomanip>
 #include <iostream>
 #include <nlohmann/json.hpp>
-#include <regex>
 #include <stdexcept>
 #include <string>
 #include <string_view>
 
+#include "chapters.hpp"
+#include "text_match.hpp"
+#include "text_simd.hpp"
 #include "types.hpp"
 #include "utils.hpp"
 
+// regex parity spot checks; the matchers are constexpr
+static_assert(TextMatch::numberPrefix("01_intro") == 3);
+static_assert(TextMatch::numberPrefix("_intro") == 0);
+static_assert(TextMatch::numberPrefix("12") == 0);
+static_assert(TextMatch::chapterTag("Chapter 3: Intro") == 11);
+static_assert(TextMatch::chapterTag("ch iv - x") == 8);
+static_assert(TextMatch::chapterTag("chapters 3") == 0);
+static_assert(TextMatch::chapterTag("chapter civic duty") == 14);
+static_assert(TextMatch::pageNumber("  xiv \n"));
+static_assert(!TextMatch::pageNumber("   "));
+static_assert(!TextMatch::pageNumber("12a"));
+
 // ───── Text ─────────────────────────────────────────────────────────────────
 std::string Text::toLower(const std::string &s) {
   std::string out = s;
-  std::transform(out.begin(), out.end(), out.begin(),
-                 [](unsigned char c) { return std::tolower(c); });
+  TextSimd::toLower(out.data(), out.size());
   return out;
 }
 
 bool Text::hasLetters(std::string_view s) noexcept {
-  for (unsigned char c : s) {
-    if (std::isalpha(c))
-      return true;
-  }
-  return false;
+  return TextSimd::hasLetters(s.data(), s.size());
 }
 
 double Text::upperRatio(std::string_view s) noexcept {
   int letters = 0, uppers = 0;
-  for (unsigned char c : s) {
-    if (std::isalpha(c)) {
-      ++letters;
-      if (std::isupper(c))
-        ++uppers;
-    }
-  }
+  TextSimd::countLetters(s.data(), s.size(), letters, uppers);
   return letters ? static_cast<double>(uppers) / letters : 0.0;
 }
 
@@ -54,32 +57,24 @@ std::string Text::trim(const std::string &s) {
   return s.substr(i, j - i);
 }
 
+std::string_view Text::trimView(std::string_view s) noexcept {
+  while (!s.empty() && isSpace(s.front()))
+    s.remove_prefix(1);
+  while (!s.empty() && isSpace(s.back()))
+    s.remove_suffix(1);
+  return s;
+}
+
 std::string Text::collapseWhitespace(std::string_view s) {
-  std::string out;
-  out.reserve(s.size());
-  bool inSpace = false;
-  for (unsigned char ch : s) {
-    if (std::isspace(ch)) {
-      inSpace = true;
-    } else {
-      if (inSpace && !out.empty())
-        out.push_back(' ');
-      out.push_back(static_cast<char>(ch));
-      inSpace = false;
-    }
-  }
+  std::string out(s.size(), '\0');
+  out.resize(TextSimd::collapseWhitespace(s.data(), s.size(), out.data()));
   return out;
 }
 
 std::string Text::normalizeStr(std::string s) {
-  std::transform(s.begin(), s.end(), s.begin(),
-                 [](unsigned char c) { return std::tolower(c); });
-  std::string out;
-  out.reserve(s.size());
-  for (unsigned char c : s)
-    if (std::isalnum(c))
-      out.push_back(c);
-  return out;
+  // in place: the kernel never writes ahead of what it has read
+  s.resize(TextSimd::lowerAlnum(s.data(), s.size(), s.data()));
+  return s;
 }
 
 bool Text::contains(std::string_view hay, std::string_view needle) {
@@ -91,8 +86,7 @@ bool Text::contains(std::string_view hay, std::string_view needle) {
 }
 
 bool Text::looksLikePageNo(const std::string &s) {
-  static const std::regex digits(R"(^\s*[0-9ivxlcdm]+\s*$)", std::regex::icase);
-  return std::regex_match(s, digits);
+  return TextMatch::pageNumber(s);
 }
 
 std::vector<std::string>
@@ -117,9 +111,7 @@ void Title::replaceAll(std::string &s, const std::string &from,
 }
 
 std::string Title::stripLeadingChapterTag(const std::string &s) {
-  static const std::regex re(
-      R"(^(chapter|ch)\s+([0-9]+|[ivxlcdm]+)\s*[:.\-]?\s*)", std::regex::icase);
-  return std::regex_replace(s, re, "");
+  return s.substr(TextMatch::chapterTag(s));
 }
 
 std::string Title::stripLeadingThe(std::string s) {
@@ -145,6 +137,14 @@ std::filesystem::path Title::findToc(const std::filesystem::path &dir) {
   return {};
 }
 
+const ChapterText *Title::findToc(const std::vector<ChapterText> &chapters) {
+  for (const auto &c : chapters) {
+    if (Title::isTocLabel(c.file))
+      return &c;
+  }
+  return nullptr;
+}
+
 bool Title::containsAnyOf(std::string_view s,
                           std::span<const std::string_view> words) {
   for (auto w : words) {
@@ -154,12 +154,6 @@ bool Title::containsAnyOf(std::string_view s,
   return false;
 }
 
-bool Title::hasBannedWord(std::string_view s) {
-  static const std::array<std::string_view, 4> kBanned{"download", "wowebook",
-                                                       "copyright", "page"};
-  return containsAnyOf(s, kBanned);
-}
-
 bool Title::isTocLabel(std::string_view text) {
   const std::string norm = Text::normalizeStr(std::string(text));
   static const std::array<std::string_view, 3> keys = {"tableofcontents",
@@ -173,7 +167,7 @@ bool Title::looksLikeTocName(const std::string &filename) {
 
 std::string Title::extractChapterTitle(const std::string &path) {
   std::string name = std::filesystem::path(path).stem().string();
-  name = std::regex_replace(name, std::regex(R"(^\d+_)"), "");
+  name.erase(0, TextMatch::numberPrefix(name));
   Title::replaceAll(name, "__", "_");
   std::replace(name.begin(), name.end(), '_', ' ');
   name = Text::toLower(name);
@@ -187,34 +181,6 @@ bool Title::isSubtitleMatch(std::string_view tocLine,
   return Text::contains(chapterLine, n);
 }
 
-bool Title::hasChapterName(std::string_view s,
-                           const std::string &chapterTitle) {
-  std::string lower = Text::toLower(std::string(s));
-  return Text::collapseWhitespace(lower).find(chapterTitle) !=
-         std::string::npos;
-}
-
-bool Title::hasWeirdChars(std::string_view s) {
-  return (std::string_view::npos != s.find("()")) ||
-         (std::string_view::npos != s.find("//"));
-}
-
-bool Title::isNoisy(const std::string &s, const std::string &chapterTitle) {
-  static constexpr double kUpperRatioCap = 0.6;
-  if (hasChapterName(s, chapterTitle))
-    return true;
-
-  std::string lower = Text::toLower(s);
-  if (hasBannedWord(lower))
-    return true;
-  if (hasWeirdChars(s))
-    return true;
-
-  if (!Text::hasLetters(s))
-    return true;
-  return Text::upperRatio(s) >= kUpperRatioCap;
-}
-
 // ───── FileIO ────────────────────────────────────────────────────────────────
 std::vector<std::string> FileIO::readLines(const std::filesystem::path &p) {
   std::vector<std::string> lines;
@@ -251,6 +217,133 @@ void FileIO::writeJson(const std::filesystem::path &outPath,
   o << std::setw(2) << j;
 }
 
+bool FileIO::writeText(const std::filesystem::path &outPath,
+                       std::string_view text) {
+  const auto parent = outPath.parent_path();
+  if (!parent.empty())
+    std::filesystem::create_directories(parent);
+  auto tmp = outPath;
+  tmp += ".tmp";
+  {
+    std::ofstream o(tmp, std::ios::binary);
+    if (!o) {
+      std::cerr << "writeText: failed to open " << tmp << '\n';
+      return false;
+    }
+    o.write(text.data(), static_cast<std::streamsize>(text.size()));
+    if (!o.flush()) {
+      std::cerr << "writeText: failed to write " << tmp << '\n';
+      return false;
+    }
+  }
+  std::error_code ec;
+  std::filesystem::rename(tmp, outPath, ec);
+  if (ec) {
+    std::cerr << "writeText: cannot replace " << outPath << ": "
+              << ec.message() << '\n';
+    std::filesystem::remove(tmp, ec);
+    return false;
+  }
+  return true;
+}
+
+// ───── Hash ──────────────────────────────────────────────────────────────────
+std::uint64_t Hash::fnv1a(std::string_view s, std::uint64_t seed) noexcept {
+  std::uint64_t h = seed;
+  for (unsigned char c : s) {
+    h ^= c;
+    h *= 0x100000001b3ull;
+  }
+  return h;
+}
+
+std::uint64_t Hash::file(const std::filesystem::path &p) {
+  std::ifstream f(p, std::ios::binary);
+  if (!f)
+    throw std::runtime_error("Hash::file: failed to open " + p.string());
+  std::uint64_t h = kSeed;
+  std::string buf(1 << 16, '\0');
+  while (f) {
+    f.read(buf.data(), static_cast<std::streamsize>(buf.size()));
+    h = fnv1a(std::string_view(buf.data(), static_cast<size_t>(f.gcount())), h);
+  }
+  return h;
+}
+
+std::string Hash::hex(std::uint64_t h) {
+  static constexpr char kDigits[] = "0123456789abcdef";
+  std::string out(16, '0');
+  for (int i = 15; i >= 0; --i, h >>= 4)
+    out[i] = kDigits[h & 0xf];
+  return out;
+}
+
+// ───── Base64 ────────────────────────────────────────────────────────────────
+static constexpr char kBase64[] =
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+std::string Base64::encode(std::string_view bytes) {
+  std::string out;
+  out.reserve((bytes.size() + 2) / 3 * 4);
+  std::size_t i = 0;
+  for (; i + 3 <= bytes.size(); i += 3) {
+    const auto v = std::uint32_t(std::uint8_t(bytes[i])) << 16 |
+                   std::uint32_t(std::uint8_t(bytes[i + 1])) << 8 |
+                   std::uint8_t(bytes[i + 2]);
+    out += kBase64[v >> 18];
+    out += kBase64[v >> 12 & 63];
+    out += kBase64[v >> 6 & 63];
+    out += kBase64[v & 63];
+  }
+  if (const std::size_t rest = bytes.size() - i; rest > 0) {
+    std::uint32_t v = std::uint32_t(std::uint8_t(bytes[i])) << 16;
+    if (rest == 2)
+      v |= std::uint32_t(std::uint8_t(bytes[i + 1])) << 8;
+    out += kBase64[v >> 18];
+    out += kBase64[v >> 12 & 63];
+    out += rest == 2 ? kBase64[v >> 6 & 63] : '=';
+    out += '=';
+  }
+  return out;
+}
+
+std::optional<std::string> Base64::decode(std::string_view text) {
+  static constexpr auto kValues = [] {
+    std::array<std::int8_t, 256> t{};
+    t.fill(-1);
+    for (int i = 0; i < 64; ++i)
+      t[static_cast<unsigned char>(kBase64[i])] = static_cast<std::int8_t>(i);
+    return t;
+  }();
+  if (text.size() % 4 != 0)
+    return std::nullopt;
+  std::size_t pad = 0;
+  while (pad < 2 && pad < text.size() && text[text.size() - 1 - pad] == '=')
+    ++pad;
+
+  std::string out;
+  out.reserve(text.size() / 4 * 3);
+  std::uint32_t v = 0;
+  for (std::size_t i = 0; i < text.size() - pad; ++i) {
+    const int d = kValues[static_cast<unsigned char>(text[i])];
+    if (d < 0)
+      return std::nullopt;
+    v = v << 6 | static_cast<std::uint32_t>(d);
+    if (i % 4 == 3) {
+      out += static_cast<char>(v >> 16);
+      out += static_cast<char>(v >> 8 & 0xff);
+      out += static_cast<char>(v & 0xff);
+    }
+  }
+  if (pad == 1) {
+    out += static_cast<char>(v >> 10);
+    out += static_cast<char>(v >> 2 & 0xff);
+  } else if (pad == 2) {
+    out += static_cast<char>(v >> 4);
+  }
+  return out;
+}
+
 // ───── OutlineView ───────────────────────────────────────────────────────────
 void OutlineView::print(const std::vector<Outline> &entries, int totalPages) {
   for (size_t i = 0; i < entries.size(); i++) {
@@ -0,0 +1,64 @@
+#include "work_pool.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <thread>
+
+WorkStealingPool::WorkStealingPool(unsigned workers) {
+  if (workers == 0)
+    workers = std::max(1u, std::thread::hardware_concurrency());
+  queues_.reserve(workers);
+  for (unsigned i = 0; i < workers; ++i)
+    queues_.push_back(std::make_unique<Queue>());
+}
+
+void WorkStealingPool::submit(Task task) {
+  Queue &q = *queues_[next_++ % queues_.size()];
+  std::lock_guard lock(q.m);
+  q.tasks.push_back(std::move(task));
+}
+
+bool WorkStealingPool::popOwn(std::size_t self, Task &out) {
+  Queue &q = *queues_[self];
+  std::lock_guard lock(q.m);
+  if (q.tasks.empty())
+    return false;
+  out = std::move(q.tasks.front());
+  q.tasks.pop_front();
+  return true;
+}
+
+bool WorkStealingPool::steal(std::size_t self, Task &out) {
+  const std::size_t n = queues_.size();
+  for (std::size_t k = 1; k < n; ++k) {
+    Queue &victim = *queues_[(self + k) % n];
+    std::lock_guard lock(victim.m);
+    if (victim.tasks.empty())
+      continue;
+    out = std::move(victim.tasks.back());
+    victim.tasks.pop_back();
+    std::lock_guard stats(statsMutex_);
+    ++steals_;
+    return true;
+  }
+  return false;
+}
+
+void WorkStealingPool::run() {
+  auto work = [this](std::size_t self) {
+    Task task;
+    while (popOwn(self, task) || steal(self, task)) {
+      try {
+        task();
+      } catch (const std::exception &e) {
+        std::cerr << "WorkStealingPool: task failed: " << e.what() << '\n';
+      }
+      task = nullptr;
+    }
+  };
+
+  std::vector<std::jthread> threads;
+  threads.reserve(queues_.size());
+  for (std::size_t i = 0; i < queues_.size(); ++i)
+    threads.emplace_back(work, i);
+}
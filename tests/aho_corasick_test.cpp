@@ -0,0 +1,110 @@
+// AhoCorasick against a find() loop over each pattern: every occurrence of
+// every non-empty pattern, overlapping and nested ones included, reported at
+// the byte where it ends. The automaton is byte-exact; callers fold case by
+// feeding it folded bytes, as NoiseFilter does.
+#include <algorithm>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "core/aho_corasick.hpp"
+
+namespace {
+
+using Hits = std::vector<std::pair<std::size_t, int>>; // (end, pattern)
+
+Hits scan(const AhoCorasick &ac, std::string_view text, bool fold = false) {
+  Hits hits;
+  int state = AhoCorasick::kRoot;
+  for (std::size_t i = 0; i < text.size(); ++i) {
+    unsigned char c = static_cast<unsigned char>(text[i]);
+    if (fold && c >= 'A' && c <= 'Z')
+      c |= 0x20;
+    state = ac.next(state, c);
+    const std::size_t before = hits.size();
+    ac.forEachMatch(state, [&](int p) { hits.emplace_back(i + 1, p); });
+    EXPECT_EQ(ac.hasMatch(state), hits.size() > before) << "at " << i;
+  }
+  std::sort(hits.begin(), hits.end());
+  return hits;
+}
+
+Hits naive(const std::vector<std::string> &patterns, std::string_view text) {
+  Hits hits;
+  for (int p = 0; p < static_cast<int>(patterns.size()); ++p) {
+    if (patterns[p].empty())
+      continue;
+    for (auto at = text.find(patterns[p]); at != std::string_view::npos;
+         at = text.find(patterns[p], at + 1))
+      hits.emplace_back(at + patterns[p].size(), p);
+  }
+  std::sort(hits.begin(), hits.end());
+  return hits;
+}
+
+} // namespace
+
+TEST(AhoCorasick, OverlappingAndNestedPatterns) {
+  const std::vector<std::string> patterns{"he", "she", "his", "hers"};
+  const AhoCorasick ac(patterns);
+  EXPECT_EQ(scan(ac, "ushers"), (Hits{{4, 0}, {4, 1}, {6, 3}}));
+  EXPECT_EQ(scan(ac, "ahishers"), naive(patterns, "ahishers"));
+
+  const std::vector<std::string> runs{"a", "aa", "aaa"};
+  EXPECT_EQ(scan(AhoCorasick(runs), "aaaa"), naive(runs, "aaaa"));
+  EXPECT_EQ(scan(AhoCorasick(runs), "aaaa").size(), 4u + 3u + 2u);
+}
+
+TEST(AhoCorasick, DuplicatePatternsAreBothReported) {
+  const AhoCorasick ac({"page", "page"});
+  EXPECT_EQ(scan(ac, "a page"), (Hits{{6, 0}, {6, 1}}));
+}
+
+TEST(AhoCorasick, EmptyPatternsAreSkipped) {
+  const std::vector<std::string> patterns{"", "ab", ""};
+  const AhoCorasick ac(patterns);
+  EXPECT_FALSE(ac.empty());
+  EXPECT_EQ(scan(ac, "xabab"), (Hits{{3, 1}, {5, 1}}));
+
+  const AhoCorasick none({"", ""});
+  EXPECT_TRUE(none.empty());
+  EXPECT_TRUE(scan(none, "anything").empty());
+  EXPECT_TRUE(AhoCorasick({}).empty());
+}
+
+// bytes the patterns never use lead back to the root
+TEST(AhoCorasick, OtherBytesResetTheMatch) {
+  const AhoCorasick ac({"abc"});
+  EXPECT_TRUE(scan(ac, "ab\xff" "c ab-c").empty());
+  EXPECT_EQ(scan(ac, "\x80" "abc\xff"), (Hits{{4, 0}}));
+}
+
+TEST(AhoCorasick, CaseIsFoldedByTheCaller) {
+  const AhoCorasick ac({"copyright", "Page"});
+  EXPECT_EQ(scan(ac, "COPYRIGHT page"), Hits{});
+  EXPECT_EQ(scan(ac, "Page"), (Hits{{4, 1}}));
+  // lower-case patterns, folded text
+  EXPECT_EQ(scan(ac, "COPYRIGHT Page", true), (Hits{{9, 0}}));
+}
+
+TEST(AhoCorasick, RandomPatternsMatchFind) {
+  std::mt19937 rng(20261016);
+  const std::string alphabet = "abcab \xe9";
+  auto text = [&](std::size_t n) {
+    std::string s;
+    for (std::size_t i = 0; i < n; ++i)
+      s.push_back(alphabet[rng() % alphabet.size()]);
+    return s;
+  };
+  for (int round = 0; round < 2000; ++round) {
+    std::vector<std::string> patterns;
+    for (int p = static_cast<int>(rng() % 8); p >= 0; --p)
+      patterns.push_back(text(rng() % 6));
+    const AhoCorasick ac(patterns);
+    const std::string t = text(rng() % 64);
+    ASSERT_EQ(scan(ac, t), naive(patterns, t)) << "round " << round;
+  }
+}
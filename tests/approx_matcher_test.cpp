@@ -0,0 +1,189 @@
+// ApproxMatcher against the plain dynamic program it computes in parallel:
+// the smallest edit distance between a pattern and any substring of a line
+// (Sellers' search variant), with the pattern's budget capped at its length
+// minus one and patterns that are empty, longer than 64 bytes or without a
+// budget left alone. Random groups cover partly filled lanes, lanes already
+// satisfied by an earlier line, and candidate lists.
+#include <algorithm>
+#include <cctype>
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/approx_matcher.hpp"
+
+namespace {
+
+// fewest edits turning pattern into some substring of text
+int substringDistance(std::string_view pattern, std::string_view text) {
+  std::vector<int> prev(text.size() + 1, 0), cur(text.size() + 1);
+  for (std::size_t i = 1; i <= pattern.size(); ++i) {
+    cur[0] = static_cast<int>(i);
+    for (std::size_t j = 1; j <= text.size(); ++j)
+      cur[j] = std::min({prev[j - 1] + (pattern[i - 1] != text[j - 1]),
+                         prev[j] + 1, cur[j - 1] + 1});
+    std::swap(prev, cur);
+  }
+  return *std::min_element(prev.begin(), prev.end());
+}
+
+// Text::collapseWhitespace: runs of whitespace become one space, and
+// leading and trailing ones go
+std::string collapsed(std::string_view s) {
+  std::string out;
+  bool gap = false;
+  for (unsigned char c : s) {
+    if (std::isspace(c)) {
+      gap = true;
+      continue;
+    }
+    if (gap && !out.empty())
+      out.push_back(' ');
+    out.push_back(static_cast<char>(c));
+    gap = false;
+  }
+  return out;
+}
+
+// what firstLines should leave in first
+std::vector<int> expected(const std::vector<std::string> &patterns,
+                          const std::vector<int> &maxErrors,
+                          const std::vector<std::string_view> &lines,
+                          const std::vector<int> *candidates,
+                          std::vector<int> first) {
+  std::vector<int> order;
+  if (candidates) {
+    order = *candidates;
+  } else {
+    for (int i = 0; i < static_cast<int>(lines.size()); ++i)
+      order.push_back(i);
+  }
+  for (std::size_t p = 0; p < patterns.size(); ++p) {
+    const int m = static_cast<int>(patterns[p].size());
+    const int budget = std::min(maxErrors[p], m - 1);
+    if (m == 0 || m > 64 || budget <= 0)
+      continue;
+    for (int i : order) {
+      if (first[p] >= 0 && first[p] <= i)
+        break;
+      if (substringDistance(patterns[p], collapsed(lines[i])) <= budget) {
+        first[p] = i;
+        break;
+      }
+    }
+  }
+  return first;
+}
+
+std::vector<int> run(const std::vector<std::string> &patterns,
+                     const std::vector<int> &maxErrors,
+                     const std::vector<std::string_view> &lines,
+                     const std::vector<int> *candidates,
+                     std::vector<int> first) {
+  ApproxMatcher(patterns, maxErrors).firstLines(lines, candidates, first);
+  return first;
+}
+
+} // namespace
+
+TEST(ApproxMatcher, ZeroBudgetLeavesTheExactResult) {
+  const std::vector<std::string> patterns{"chapter"};
+  const std::vector<std::string_view> lines{"chapte", "xx chapter"};
+  EXPECT_EQ(run(patterns, {0}, lines, nullptr, {-1}),
+            (std::vector<int>{-1}));
+  EXPECT_EQ(run(patterns, {0}, lines, nullptr, {1}), (std::vector<int>{1}));
+  EXPECT_EQ(run(patterns, {1}, lines, nullptr, {1}), (std::vector<int>{0}));
+}
+
+// a budget of len or more would match every line by deleting the pattern
+TEST(ApproxMatcher, BudgetIsCappedBelowThePatternLength) {
+  const std::vector<std::string> patterns{"ab"};
+  const std::vector<std::string_view> lines{"zzz", "zzbz"};
+  EXPECT_EQ(run(patterns, {5}, lines, nullptr, {-1}), (std::vector<int>{1}));
+  // one byte, so no budget at all
+  EXPECT_EQ(run({"a"}, {3}, {"b", "a"}, nullptr, {-1}),
+            (std::vector<int>{-1}));
+}
+
+TEST(ApproxMatcher, PatternsOfSixtyFourBytesAndMore) {
+  const std::string p64(64, 'q'), p65(65, 'q');
+  std::string near64 = p64;
+  near64[10] = 'x';
+  const std::vector<std::string_view> lines{"nothing", near64, p65};
+  // 64 fits a lane; 65 is left to the exact search
+  EXPECT_EQ(run({p64, p65}, {1, 1}, lines, nullptr, {-1, -1}),
+            (std::vector<int>{1, -1}));
+  EXPECT_EQ(run({p64}, {0}, lines, nullptr, {-1}), (std::vector<int>{-1}));
+}
+
+TEST(ApproxMatcher, PartlyFilledAndSatisfiedLanes) {
+  // five patterns: one full group and one with a single lane
+  const std::vector<std::string> patterns{"alpha", "bravo", "charlie",
+                                          "delta", "echo"};
+  const std::vector<int> budgets{1, 1, 1, 1, 1};
+  const std::vector<std::string_view> lines{"zulu", "brave", "delta",
+                                            "ecko", "charly"};
+  EXPECT_EQ(run(patterns, budgets, lines, nullptr, {-1, -1, -1, -1, -1}),
+            (std::vector<int>{-1, 1, -1, 2, 3}));
+  // an earlier exact line stays; a later one is lowered
+  EXPECT_EQ(run(patterns, budgets, lines, nullptr, {0, 4, -1, 0, 4}),
+            (std::vector<int>{0, 1, -1, 0, 3}));
+  const std::vector<int> candidates{2, 3};
+  EXPECT_EQ(run(patterns, budgets, lines, &candidates, {-1, -1, -1, -1, -1}),
+            (std::vector<int>{-1, -1, -1, 2, 3}));
+}
+
+TEST(ApproxMatcher, LinesAreComparedCollapsed) {
+  const std::vector<std::string_view> lines{"  one\t\t two  "};
+  EXPECT_EQ(run({"one two!"}, {1}, lines, nullptr, {-1}),
+            (std::vector<int>{0}));
+}
+
+// random pattern sets against the dynamic program
+TEST(ApproxMatcher, RandomGroupsMatchTheDynamicProgram) {
+  std::mt19937 rng(20261016);
+  const std::string alphabet = "abcab  \t";
+  auto text = [&](std::size_t n) {
+    std::string s;
+    std::uniform_int_distribution<std::size_t> c(0, alphabet.size() - 1);
+    for (std::size_t i = 0; i < n; ++i)
+      s.push_back(alphabet[c(rng)]);
+    return s;
+  };
+  std::uniform_int_distribution<int> patternCount(1, 9);
+  std::uniform_int_distribution<std::size_t> patternLength(0, 70);
+  std::uniform_int_distribution<std::size_t> lineLength(0, 90);
+  std::uniform_int_distribution<int> lineCount(1, 12);
+
+  for (int round = 0; round < 3000; ++round) {
+    std::vector<std::string> patterns;
+    std::vector<int> budgets, first;
+    const int lines = lineCount(rng);
+    std::uniform_int_distribution<int> firstLine(-1, lines - 1);
+    for (int p = patternCount(rng); p > 0; --p) {
+      // mostly short patterns, so matches are common
+      const std::size_t n = round % 4 ? patternLength(rng) % 12
+                                      : patternLength(rng);
+      patterns.push_back(collapsed(text(n)));
+      std::uniform_int_distribution<int> budget(0, static_cast<int>(n) + 2);
+      budgets.push_back(budget(rng));
+      first.push_back(firstLine(rng));
+    }
+    std::vector<std::string> owned;
+    for (int i = 0; i < lines; ++i)
+      owned.push_back(text(lineLength(rng)));
+    const std::vector<std::string_view> views(owned.begin(), owned.end());
+    std::vector<int> candidates;
+    for (int i = 0; i < lines; ++i)
+      if (rng() % 2)
+        candidates.push_back(i);
+
+    SCOPED_TRACE("round " + std::to_string(round));
+    ASSERT_EQ(run(patterns, budgets, views, nullptr, first),
+              expected(patterns, budgets, views, nullptr, first));
+    ASSERT_EQ(run(patterns, budgets, views, &candidates, first),
+              expected(patterns, budgets, views, &candidates, first));
+  }
+}
@@ -0,0 +1,312 @@
+// Writes small Arrow IPC files with ArrowExport and reads them back with a
+// minimal FlatBuffers reader: the file framing (magic, end-of-stream
+// marker, footer), the schema, the blocks the footer points at, and the
+// dictionary batches, including the deltas of a second book.
+#include <cstdint>
+#include <cstring>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "content_store.hpp"
+#include "pipeline/arrow_export.hpp"
+#include "scratch_dir.hpp"
+
+namespace {
+
+std::string slurp(const std::filesystem::path &p) {
+  std::ifstream is(p, std::ios::binary);
+  return {std::istreambuf_iterator<char>(is), {}};
+}
+
+template <class T> T at(std::string_view buf, std::size_t pos) {
+  if (pos > buf.size() || sizeof(T) > buf.size() - pos)
+    throw std::out_of_range("read past the end at " + std::to_string(pos));
+  T v;
+  std::memcpy(&v, buf.data() + pos, sizeof v);
+  return v;
+}
+
+// A FlatBuffers table: reads fields by id through its vtable. Every read is
+// bounds-checked, so a bad offset fails the test instead of crashing it.
+class Table {
+public:
+  Table(std::string_view buf, std::size_t pos) : buf_(buf), pos_(pos) {}
+
+  static Table root(std::string_view buf) {
+    return {buf, at<std::uint32_t>(buf, 0)};
+  }
+
+  bool has(int id) const { return slot(id) != 0; }
+  template <class T> T scalar(int id, T fallback = {}) const {
+    const auto o = slot(id);
+    return o ? at<T>(buf_, pos_ + o) : fallback;
+  }
+  Table table(int id) const { return {buf_, deref(id)}; }
+  std::string_view string(int id) const {
+    const auto p = deref(id);
+    const auto n = at<std::uint32_t>(buf_, p);
+    if (p + 4 + n > buf_.size())
+      throw std::out_of_range("string past the end");
+    return buf_.substr(p + 4, n);
+  }
+  std::uint32_t length(int id) const { return at<std::uint32_t>(buf_, deref(id)); }
+  Table element(int id, std::size_t i) const {
+    const auto p = deref(id) + 4 + 4 * i;
+    return {buf_, p + at<std::uint32_t>(buf_, p)};
+  }
+  template <class T> T structAt(int id, std::size_t i) const {
+    return at<T>(buf_, deref(id) + 4 + sizeof(T) * i);
+  }
+
+private:
+  std::uint16_t slot(int id) const {
+    const auto vtable = pos_ - at<std::int32_t>(buf_, pos_);
+    const auto size = at<std::uint16_t>(buf_, vtable);
+    const std::size_t entry = 4 + 2 * static_cast<std::size_t>(id);
+    return entry < size ? at<std::uint16_t>(buf_, vtable + entry) : 0;
+  }
+  std::size_t deref(int id) const {
+    const auto o = slot(id);
+    if (!o)
+      throw std::out_of_range("field " + std::to_string(id) + " absent");
+    return pos_ + o + at<std::uint32_t>(buf_, pos_ + o);
+  }
+
+  std::string_view buf_;
+  std::size_t pos_;
+};
+
+// File.fbs Block and Message.fbs FieldNode / Buffer
+struct Block {
+  std::int64_t offset;
+  std::int32_t metaDataLength;
+  std::int32_t pad;
+  std::int64_t bodyLength;
+};
+struct Buffer {
+  std::int64_t offset;
+  std::int64_t length;
+};
+
+constexpr std::uint8_t kHeaderDictionary = 2, kHeaderRecordBatch = 3;
+
+// One framed message of the file: its Message table and its body.
+struct Message {
+  Table meta;
+  std::string_view body;
+};
+
+Message message(std::string_view file, const Block &b) {
+  EXPECT_EQ(b.offset % 8, 0);
+  EXPECT_EQ(at<std::uint32_t>(file, b.offset), 0xFFFFFFFFu);
+  const auto metaLength = at<std::int32_t>(file, b.offset + 4);
+  EXPECT_EQ(8 + metaLength, b.metaDataLength);
+  EXPECT_EQ(b.metaDataLength % 8, 0);
+  const auto meta = file.substr(b.offset + 8, metaLength);
+  const auto body = file.substr(b.offset + b.metaDataLength, b.bodyLength);
+  const auto m = Table::root(meta);
+  EXPECT_EQ(m.scalar<std::int16_t>(0), 4); // MetadataVersion V5
+  EXPECT_EQ(m.scalar<std::int64_t>(3), b.bodyLength);
+  return {m, body};
+}
+
+// The strings of a Utf8 array: buffers are validity, offsets, data.
+std::vector<std::string> utf8(const Message &m, Table batch,
+                              std::size_t first) {
+  const auto offsets = batch.structAt<Buffer>(2, first + 1);
+  const auto data = batch.structAt<Buffer>(2, first + 2);
+  const auto n = batch.scalar<std::int64_t>(0);
+  std::vector<std::string> out;
+  for (std::int64_t i = 0; i < n; ++i) {
+    const auto b = at<std::int32_t>(m.body, offsets.offset + 4 * i);
+    const auto e = at<std::int32_t>(m.body, offsets.offset + 4 * (i + 1));
+    out.emplace_back(m.body.substr(data.offset + b, e - b));
+  }
+  return out;
+}
+
+// Column `column` of a record batch as int32 (dictionary indices and the
+// int columns; each has a validity and a data buffer).
+std::vector<std::int32_t> int32s(const Message &m, Table batch, int column) {
+  const auto data = batch.structAt<Buffer>(2, 2 * column + 1);
+  std::vector<std::int32_t> out;
+  for (std::int64_t i = 0; i < batch.scalar<std::int64_t>(0); ++i)
+    out.push_back(at<std::int32_t>(m.body, data.offset + 4 * i));
+  return out;
+}
+
+struct Footer {
+  Table table;
+  std::vector<Block> dictionaries;
+  std::vector<Block> batches;
+};
+
+// Checks the framing and returns the footer.
+Footer footer(std::string_view file) {
+  const std::string_view magic("ARROW1\0\0", 8);
+  EXPECT_EQ(file.substr(0, 8), magic);
+  EXPECT_EQ(file.substr(file.size() - 6), magic.substr(0, 6));
+  const auto length = at<std::int32_t>(file, file.size() - 10);
+  const std::size_t start = file.size() - 10 - length;
+  // end-of-stream marker: continuation and a zero metadata length
+  EXPECT_EQ(at<std::uint32_t>(file, start - 8), 0xFFFFFFFFu);
+  EXPECT_EQ(at<std::uint32_t>(file, start - 4), 0u);
+
+  const auto t = Table::root(file.substr(start, length));
+  EXPECT_EQ(t.scalar<std::int16_t>(0), 4);
+  Footer f{t, {}, {}};
+  for (std::uint32_t i = 0; i < t.length(2); ++i)
+    f.dictionaries.push_back(t.structAt<Block>(2, i));
+  for (std::uint32_t i = 0; i < t.length(3); ++i)
+    f.batches.push_back(t.structAt<Block>(3, i));
+  return f;
+}
+
+SectionRow row(std::string title, std::string content) {
+  SectionRow r;
+  r.title = std::move(title);
+  r.startline = 1;
+  r.endline = 9;
+  r.content = std::move(content);
+  return r;
+}
+
+} // namespace
+
+TEST(ArrowExport, EmptyFileHasSchemaAndFooter) {
+  ScratchDir dir;
+  const auto path = dir / "empty.arrow";
+  {
+    ArrowExport out(path);
+    ASSERT_TRUE(out.isValid());
+    EXPECT_TRUE(out.finish());
+    EXPECT_TRUE(out.finish()); // later calls are no-ops
+  }
+  EXPECT_FALSE(std::filesystem::exists(dir / "empty.arrow.tmp"));
+  const std::string file = slurp(path);
+  const auto f = footer(file);
+  EXPECT_TRUE(f.dictionaries.empty());
+  EXPECT_TRUE(f.batches.empty());
+}
+
+TEST(ArrowExport, Schema) {
+  ScratchDir dir;
+  ArrowExport out(dir / "s.arrow");
+  ASSERT_TRUE(out.finish());
+  const std::string file = slurp(dir / "s.arrow");
+  const auto schema = footer(file).table.table(1);
+  EXPECT_EQ(schema.scalar<std::int16_t>(0), 0); // little endian
+
+  struct Expected {
+    std::string_view name;
+    std::uint8_t type; // Type union: 2 Int, 5 Utf8
+    std::int64_t dictId;
+  };
+  const Expected columns[] = {
+      {"book_title", 5, 0}, {"chapter", 5, 1}, {"section_index", 2, -1},
+      {"title", 5, 2},      {"startline", 2, -1}, {"endline", 2, -1},
+      {"content", 5, -1}};
+  ASSERT_EQ(schema.length(1), std::size(columns));
+  for (std::size_t i = 0; i < std::size(columns); ++i) {
+    const auto &c = columns[i];
+    SCOPED_TRACE(std::string(c.name));
+    const auto field = schema.element(1, i);
+    EXPECT_EQ(field.string(0), c.name);
+    EXPECT_EQ(field.scalar<std::uint8_t>(1), 0); // not nullable
+    EXPECT_EQ(field.scalar<std::uint8_t>(2), c.type);
+    if (c.type == 2) {
+      EXPECT_EQ(field.table(3).scalar<std::int32_t>(0), 32);
+      EXPECT_EQ(field.table(3).scalar<std::uint8_t>(1), 1);
+    }
+    EXPECT_EQ(field.has(4), c.dictId >= 0);
+    if (c.dictId >= 0) {
+      const auto dict = field.table(4);
+      EXPECT_EQ(dict.scalar<std::int64_t>(0), c.dictId);
+      EXPECT_EQ(dict.table(1).scalar<std::int32_t>(0), 32); // int32 indices
+    }
+    EXPECT_EQ(field.length(5), 0u); // no children
+  }
+}
+
+// The second book sends only the strings it adds to each dictionary, as
+// deltas, and its indices continue from the first book's.
+TEST(ArrowExport, DeltaDictionaries) {
+  ScratchDir dir;
+  const auto path = dir / "books.arrow";
+  {
+    ArrowExport out(path);
+    ASSERT_TRUE(out.isValid());
+    ChapterSegments intro{"01_intro.json", {row("Start", "aaa"),
+                                            row("Next", "bbbb")}, {}, {}};
+    ASSERT_TRUE(out.add({"Book A", false, {}}, {intro}));
+    ChapterSegments again{"01_intro.json", {row("Next", "c")}, {}, {}};
+    ChapterSegments body{"02_body.json", {row("Deep", "dd")}, {}, {}};
+    ASSERT_TRUE(out.add({"Book B", false, {}}, {again, body}));
+    EXPECT_EQ(out.rows(), 4u);
+    ASSERT_TRUE(out.finish());
+  }
+  const std::string file = slurp(path);
+  const auto f = footer(file);
+
+  struct ExpectedDict {
+    std::int64_t id;
+    bool delta;
+    std::vector<std::string> values;
+  };
+  const ExpectedDict dicts[] = {
+      {0, false, {"Book A"}}, {1, false, {"01_intro"}},
+      {2, false, {"Start", "Next"}}, {0, true, {"Book B"}},
+      {1, true, {"02_body"}}, {2, true, {"Deep"}}};
+  ASSERT_EQ(f.dictionaries.size(), std::size(dicts));
+  for (std::size_t i = 0; i < std::size(dicts); ++i) {
+    SCOPED_TRACE("dictionary block " + std::to_string(i));
+    const auto m = message(file, f.dictionaries[i]);
+    ASSERT_EQ(m.meta.scalar<std::uint8_t>(1), kHeaderDictionary);
+    const auto batch = m.meta.table(2);
+    EXPECT_EQ(batch.scalar<std::int64_t>(0), dicts[i].id);
+    EXPECT_EQ(batch.scalar<std::uint8_t>(2) != 0, dicts[i].delta);
+    EXPECT_EQ(utf8(m, batch.table(1), 0), dicts[i].values);
+  }
+
+  ASSERT_EQ(f.batches.size(), 2u);
+  const auto first = message(file, f.batches[0]);
+  const auto second = message(file, f.batches[1]);
+  ASSERT_EQ(second.meta.scalar<std::uint8_t>(1), kHeaderRecordBatch);
+  const auto batch = second.meta.table(2);
+  EXPECT_EQ(batch.scalar<std::int64_t>(0), 2);
+  EXPECT_EQ(batch.length(1), 7u); // one node per column
+  EXPECT_EQ(int32s(second, batch, 0), (std::vector<std::int32_t>{1, 1}));
+  EXPECT_EQ(int32s(second, batch, 1), (std::vector<std::int32_t>{0, 1}));
+  EXPECT_EQ(int32s(second, batch, 2), (std::vector<std::int32_t>{0, 0}));
+  EXPECT_EQ(int32s(second, batch, 3), (std::vector<std::int32_t>{1, 2}));
+  EXPECT_EQ(utf8(second, batch, 12), (std::vector<std::string>{"c", "dd"}));
+  EXPECT_EQ(utf8(first, first.meta.table(2), 12),
+            (std::vector<std::string>{"aaa", "bbbb"}));
+  // messages follow each other: dictionaries of a book, then its batch
+  EXPECT_LT(f.dictionaries[2].offset, f.batches[0].offset);
+  EXPECT_LT(f.batches[0].offset, f.dictionaries[3].offset);
+}
+
+// rows stored by reference are written out in full
+TEST(ArrowExport, ResolvesReferencedRows) {
+  ScratchDir dir;
+  ArrowExport out(dir / "ref.arrow");
+  ChapterSegments seg{"03_ref.json", {row("Ref", "")}, "0123456789", {}};
+  seg.rows[0].ref = {ContentStore::id(seg.text), 2, 5};
+  ASSERT_TRUE(out.add({"Book", false, {}}, {seg}));
+  seg.rows[0].ref.length = 50; // past the end of the text
+  EXPECT_FALSE(out.add({"Book", false, {}}, {seg}));
+  ASSERT_TRUE(out.finish());
+
+  const std::string file = slurp(dir / "ref.arrow");
+  const auto f = footer(file);
+  ASSERT_EQ(f.batches.size(), 1u);
+  const auto m = message(file, f.batches[0]);
+  EXPECT_EQ(utf8(m, m.meta.table(2), 12),
+            (std::vector<std::string>{"23456"}));
+}
@@ -0,0 +1,209 @@
+// Bundle's guarantees against losing data: what commit() wrote survives a
+// reopen, whatever came after the last good trailer is cut off, compaction
+// keeps exactly the live blobs, and files that are not bundles, or bundles
+// open elsewhere, are refused rather than written to.
+#include <filesystem>
+#include <fstream>
+#include <gtest/gtest.h>
+#include <iterator>
+#include <string>
+
+#include "bundle.hpp"
+#include "scratch_dir.hpp"
+
+namespace fs = std::filesystem;
+
+namespace {
+
+std::string slurp(const fs::path &p) {
+  std::ifstream is(p, std::ios::binary);
+  return {std::istreambuf_iterator<char>(is), {}};
+}
+
+void append(const fs::path &p, const std::string &bytes) {
+  std::ofstream os(p, std::ios::binary | std::ios::app);
+  os << bytes;
+}
+
+} // namespace
+
+TEST(Bundle, CommittedBlobsSurviveReopen) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.isValid());
+    ASSERT_TRUE(b.put("chapters/01.txt", "first chapter"));
+    ASSERT_TRUE(b.put("chapters/02.txt", "second chapter"));
+    ASSERT_TRUE(b.put("toc_sections/01.json", "{}"));
+    ASSERT_TRUE(b.commit());
+  }
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_EQ(b.read("chapters/01.txt"), "first chapter");
+  EXPECT_EQ(b.read("chapters/02.txt"), "second chapter");
+  EXPECT_EQ(b.list("chapters/"),
+            (std::vector<std::string>{"chapters/01.txt", "chapters/02.txt"}));
+  EXPECT_FALSE(b.read("chapters/03.txt"));
+  EXPECT_EQ(b.fileBytes(), fs::file_size(path));
+}
+
+TEST(Bundle, IdenticalBytesAreStoredOnce) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  std::uint64_t size = 0;
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("a", "the same bytes"));
+    size = b.fileBytes();
+    ASSERT_TRUE(b.put("b", "the same bytes"));
+    EXPECT_EQ(b.fileBytes(), size);
+    ASSERT_TRUE(b.commit());
+    size = b.fileBytes();
+  }
+  // the hash index is rebuilt on open
+  Bundle b(path);
+  ASSERT_TRUE(b.put("c", "the same bytes"));
+  EXPECT_EQ(b.fileBytes(), size);
+  EXPECT_EQ(b.read("c"), "the same bytes");
+  EXPECT_EQ(b.liveBytes(), 14u);
+}
+
+TEST(Bundle, UncommittedTailIsDropped) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  std::uint64_t committed = 0;
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("kept", "committed bytes"));
+    ASSERT_TRUE(b.commit());
+    committed = b.fileBytes();
+    ASSERT_TRUE(b.put("lost", "written but never committed"));
+    ASSERT_TRUE(b.put("kept", "replaced but never committed"));
+  }
+  EXPECT_GT(fs::file_size(path), committed);
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_EQ(b.read("kept"), "committed bytes");
+  EXPECT_FALSE(b.contains("lost"));
+  EXPECT_EQ(fs::file_size(path), committed);
+}
+
+TEST(Bundle, NeverCommittedOpensEmpty) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("lost", "bytes"));
+  }
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_TRUE(b.list("").empty());
+  EXPECT_EQ(fs::file_size(path), 8u);
+}
+
+// a commit cut short leaves half a trailer: the one before it wins
+TEST(Bundle, TornTrailerFallsBackToPreviousCommit) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  std::uint64_t first = 0;
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("a", "one"));
+    ASSERT_TRUE(b.commit());
+    first = b.fileBytes();
+    ASSERT_TRUE(b.put("b", "two"));
+    ASSERT_TRUE(b.commit());
+  }
+  fs::resize_file(path, fs::file_size(path) - 5);
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_EQ(b.read("a"), "one");
+  EXPECT_FALSE(b.contains("b"));
+  EXPECT_EQ(fs::file_size(path), first);
+}
+
+// trailer magic in blob bytes or garbage does not pass for a commit
+TEST(Bundle, GarbageThatLooksLikeATrailerIsDropped) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  std::uint64_t committed = 0;
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("a", "BSINDEX1 inside a blob"));
+    ASSERT_TRUE(b.commit());
+    committed = b.fileBytes();
+  }
+  append(path, std::string("\x40\0\0\0\0\0\0\0BSINDEX1junk", 20));
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_EQ(b.read("a"), "BSINDEX1 inside a blob");
+  EXPECT_EQ(fs::file_size(path), committed);
+}
+
+TEST(Bundle, RefusesFilesThatAreNotBundles) {
+  ScratchDir dir;
+  for (const std::string bytes : {"not a bundle at all", "short", "BSBX"}) {
+    SCOPED_TRACE(bytes);
+    const auto path = dir / "other";
+    { std::ofstream(path, std::ios::binary) << bytes; }
+    Bundle b(path);
+    EXPECT_FALSE(b.isValid());
+    EXPECT_EQ(slurp(path), bytes);
+  }
+  // empty, or the start of the magic: a bundle never written
+  for (const std::string bytes : {"", "BSBU"}) {
+    const auto path = dir / ("new" + std::to_string(bytes.size()));
+    { std::ofstream(path, std::ios::binary) << bytes; }
+    Bundle b(path);
+    EXPECT_TRUE(b.isValid());
+  }
+}
+
+TEST(Bundle, SecondOpenIsRefusedWhileLocked) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  {
+    Bundle first(path);
+    ASSERT_TRUE(first.isValid());
+    Bundle second(path);
+    EXPECT_FALSE(second.isValid());
+  }
+  Bundle again(path);
+  EXPECT_TRUE(again.isValid());
+}
+
+// Garbage beyond the live data and 1 MiB makes commit() rewrite the file.
+TEST(Bundle, CompactionKeepsOnlyLiveBlobs) {
+  ScratchDir dir;
+  const auto path = dir / "book.bundle";
+  const std::string big(2 << 20, 'x');
+  {
+    Bundle b(path);
+    ASSERT_TRUE(b.put("big", big));
+    ASSERT_TRUE(b.put("keep", "kept bytes"));
+    ASSERT_TRUE(b.put("shared", "kept bytes"));
+    ASSERT_TRUE(b.commit());
+    b.remove("big");
+    ASSERT_TRUE(b.put("late", "put before compaction"));
+    ASSERT_TRUE(b.commit());
+
+    EXPECT_LT(b.fileBytes(), 1024u);
+    EXPECT_EQ(b.fileBytes(), fs::file_size(path));
+    EXPECT_FALSE(fs::exists(dir / "book.bundle.tmp"));
+    EXPECT_EQ(b.list(""),
+              (std::vector<std::string>{"keep", "late", "shared"}));
+    // still locked, and still writable after the swap
+    EXPECT_FALSE(Bundle(path).isValid());
+    ASSERT_TRUE(b.put("after", "more"));
+    ASSERT_TRUE(b.commit());
+  }
+  Bundle b(path);
+  ASSERT_TRUE(b.isValid());
+  EXPECT_FALSE(b.contains("big"));
+  EXPECT_EQ(b.read("keep"), "kept bytes");
+  EXPECT_EQ(b.read("shared"), "kept bytes");
+  EXPECT_EQ(b.read("late"), "put before compaction");
+  EXPECT_EQ(b.read("after"), "more");
+  EXPECT_EQ(b.liveBytes(), 10u + 21u + 4u); // the shared copy counts once
+}
@@ -0,0 +1,94 @@
+// ContentCodec round trips, and what it refuses: frames whose header claims
+// more than the row's code points or kMaxContentBytes allow, frames of
+// unknown size, other dictionaries, and content pack() must leave plain.
+#include <cstdint>
+#include <gtest/gtest.h>
+#include <string>
+#include <vector>
+
+#include "content_codec.hpp"
+
+namespace {
+
+// a book-like text long enough to train on
+std::string bookText() {
+  static const char *kWords[] = {"chapter", "section", "the",    "of",
+                                 "memory",  "page",    "résumé", "and",
+                                 "index",   "figure",  "table",  "a"};
+  std::string text;
+  std::uint32_t x = 12345;
+  while (text.size() < (400 << 10)) {
+    x = x * 1103515245 + 12345;
+    text += kWords[(x >> 16) % std::size(kWords)];
+    text += (x >> 8) % 13 ? " " : ".\n";
+  }
+  return text;
+}
+
+const ContentCodec &codec() {
+  static const ContentCodec c = [] {
+    const std::string text = bookText();
+    return ContentCodec(ContentCodec::train({text}));
+  }();
+  return c;
+}
+
+// a zstd frame header declaring size bytes of content, and nothing else
+std::string frameClaiming(std::uint64_t size) {
+  std::string f("\x28\xb5\x2f\xfd", 4);
+  f.push_back('\xe0'); // single segment, 8-byte content size
+  for (int i = 0; i < 8; ++i)
+    f.push_back(static_cast<char>(size >> (8 * i)));
+  f += std::string(8, '\0');
+  return f;
+}
+
+} // namespace
+
+TEST(ContentCodec, RoundTrip) {
+  ASSERT_TRUE(codec().isValid());
+  const std::string section = "The chapter on memory, with a résumé.\n";
+  const auto packed = codec().pack(section);
+  ASSERT_TRUE(packed);
+  EXPECT_EQ(packed->dict, codec().id());
+  EXPECT_EQ(packed->chars, section.size() - 2); // é is two bytes
+  EXPECT_EQ(codec().unpack(*packed), section);
+  // empty content packs too
+  const auto empty = codec().pack("");
+  ASSERT_TRUE(empty);
+  EXPECT_EQ(codec().unpack(*empty), "");
+}
+
+TEST(ContentCodec, RefusesOtherDictionaries) {
+  auto packed = codec().pack("some text");
+  ASSERT_TRUE(packed);
+  packed->dict = "0000000000000000-1024";
+  EXPECT_FALSE(codec().unpack(*packed));
+}
+
+// the header is read before anything is allocated for it
+TEST(ContentCodec, RefusesSizesTheRowCannotHave) {
+  const std::string id = codec().id();
+  // a terabyte
+  EXPECT_FALSE(codec().unpack({id, frameClaiming(1ull << 40), 1ull << 40}));
+  // more than 4 bytes per recorded code point
+  EXPECT_FALSE(codec().unpack({id, frameClaiming(41), 10}));
+  // past the cap, whatever the row says
+  EXPECT_FALSE(codec().unpack(
+      {id, frameClaiming(ContentCodec::kMaxContentBytes + 1), 1ull << 40}));
+  // unknown size: no single segment, no content size field
+  EXPECT_FALSE(codec().unpack({id, std::string("\x28\xb5\x2f\xfd\0\0", 6), 9}));
+  EXPECT_FALSE(codec().unpack({id, "not a frame", 11}));
+
+  // a real frame whose row undercounts its characters
+  auto packed = codec().pack("forty bytes of section text, more or so");
+  ASSERT_TRUE(packed);
+  packed->chars = 2;
+  EXPECT_FALSE(codec().unpack(*packed));
+}
+
+// invalid UTF-8 can have more bytes than code points allow; it stays plain
+TEST(ContentCodec, LeavesUnpackableContentPlain) {
+  EXPECT_FALSE(codec().pack(std::string(9, '\x80') + "a"));
+  EXPECT_FALSE(ContentCodec("").pack("text"));
+}
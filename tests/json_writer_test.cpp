@@ -0,0 +1,152 @@
+// JsonWriter against nlohmann's dump() and dump(2), which the segment files
+// were written with before: the same documents, built both ways, must give
+// the same bytes. Strings mix control characters, quotes, backslashes,
+// well-formed UTF-8 and invalid sequences (both sides write U+FFFD).
+#include <functional>
+#include <gtest/gtest.h>
+#include <nlohmann/json.hpp>
+#include <random>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "json_writer.hpp"
+
+namespace {
+
+using ordered = nlohmann::ordered_json;
+
+// what nlohmann writes, with invalid UTF-8 replaced rather than thrown on
+std::string dump(const ordered &j, bool pretty) {
+  return j.dump(pretty ? 2 : -1, ' ', false,
+                nlohmann::json::error_handler_t::replace);
+}
+
+const std::vector<std::string> &pieces() {
+  static const std::vector<std::string> p = {
+      "plain", " ", "\"", "\\", "/", "\b", "\f", "\n", "\r", "\t",
+      std::string(1, '\0'), "\x01", "\x1f", "\x7f",
+      "\xc3\xa9",         // é
+      "\xe2\x82\xac",     // €
+      "\xf0\x9f\x93\x96", // 📖
+      "\x80",             // lone continuation byte
+      "\xc3",             // truncated two-byte sequence
+      "\xe2\x82",         // truncated three-byte sequence
+      "\xc0\xaf",         // overlong '/'
+      "\xed\xa0\x80",     // surrogate
+      "\xf4\x90\x80\x80", // past U+10FFFF
+      "\xf5", "\xff"};
+  return p;
+}
+
+// Builds the same random document into a JsonWriter and an ordered_json.
+class Twin {
+public:
+  explicit Twin(unsigned seed) : rng_(seed) {}
+
+  ordered value(JsonWriter &w, int depth) {
+    switch (depth > 3 ? rng_() % 2 : rng_() % 4) {
+    case 0: {
+      const std::string s = text();
+      w.value(s);
+      return s;
+    }
+    case 1: {
+      std::int64_t n = static_cast<std::int64_t>(rng_()) - (1ll << 31);
+      if (rng_() % 4 == 0)
+        n *= 1ll << 31;
+      w.value(n);
+      return n;
+    }
+    case 2: {
+      ordered a = ordered::array();
+      w.beginArray();
+      for (int k = static_cast<int>(rng_() % 4); k > 0; --k)
+        a.push_back(value(w, depth + 1));
+      w.endArray();
+      return a;
+    }
+    default: {
+      ordered o = ordered::object();
+      w.beginObject();
+      for (int k = static_cast<int>(rng_() % 4); k > 0; --k) {
+        std::string key = std::to_string(k);
+        key += text();
+        w.key(key);
+        o[key] = value(w, depth + 1);
+      }
+      w.endObject();
+      return o;
+    }
+    }
+  }
+
+private:
+  std::string text() {
+    std::string s;
+    for (int k = static_cast<int>(rng_() % 6); k > 0; --k)
+      s += pieces()[rng_() % pieces().size()];
+    return s;
+  }
+
+  std::mt19937 rng_;
+};
+
+std::string written(bool pretty, const std::function<void(JsonWriter &)> &f,
+                    std::size_t bufferBytes = 1 << 16) {
+  std::ostringstream os;
+  {
+    JsonWriter w(os, {.pretty = pretty, .bufferBytes = bufferBytes});
+    f(w);
+  }
+  return os.str();
+}
+
+} // namespace
+
+TEST(JsonWriter, EscapesLikeNlohmann) {
+  for (const auto &p : pieces()) {
+    std::string out;
+    JsonWriter::escape(out, p);
+    EXPECT_EQ(out, dump(ordered(p), false)) << "piece of " << p.size();
+  }
+}
+
+TEST(JsonWriter, InvalidUtf8BecomesReplacementCharacter) {
+  std::string out;
+  JsonWriter::escape(out, "a\x80z\xc3");
+  EXPECT_EQ(out, "\"a\xef\xbf\xbdz\xef\xbf\xbd\"");
+}
+
+TEST(JsonWriter, EmptyContainers) {
+  for (bool pretty : {false, true}) {
+    EXPECT_EQ(written(pretty,
+                      [](JsonWriter &w) {
+                        w.beginObject();
+                        w.key("a");
+                        w.beginArray();
+                        w.endArray();
+                        w.key("o");
+                        w.beginObject();
+                        w.endObject();
+                        w.endObject();
+                      }),
+              dump(ordered{{"a", ordered::array()}, {"o", ordered::object()}},
+                   pretty));
+  }
+}
+
+// random nested documents, compact and indented, through small buffers too
+TEST(JsonWriter, RandomDocumentsMatchNlohmann) {
+  for (unsigned seed = 1; seed <= 2000; ++seed) {
+    for (bool pretty : {false, true}) {
+      ordered expected;
+      const std::string got = written(
+          pretty,
+          [&](JsonWriter &w) { expected = Twin(seed).value(w, 0); },
+          seed % 3 ? 1 << 16 : 16);
+      ASSERT_EQ(got, dump(expected, pretty))
+          << "seed " << seed << (pretty ? " pretty" : " compact");
+    }
+  }
+}
@@ -0,0 +1,78 @@
+// NoiseFilter against the Title::isNoisy chain it replaced (kept here as the
+// oracle): lower-case and collapse the line, look for the chapter title and
+// the banned words, then "()"/"//", letters and the upper-case ratio. Lines
+// are drawn from fragments that trip each check, alone and spread across
+// runs of whitespace and case changes.
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/noise_filter.hpp"
+#include "utils.hpp"
+
+namespace {
+
+bool oracle(const std::string &s, const std::string &chapterTitle) {
+  const std::string lower = Text::toLower(s);
+  if (Text::collapseWhitespace(lower).find(chapterTitle) != std::string::npos)
+    return true;
+  if (Title::containsAnyOf(lower, Title::kBannedWords))
+    return true;
+  if (s.find("()") != std::string::npos || s.find("//") != std::string::npos)
+    return true;
+  if (!Text::hasLetters(s))
+    return true;
+  return Text::upperRatio(s) >= Title::kUpperRatioCap;
+}
+
+const std::vector<std::string> &fragments() {
+  static const std::vector<std::string> f = {
+      "the",   "Memory", "MODEL", "of",   "page", "PaGe", "pa ge", "Down",
+      "load",  "wowe",   "book",  "(",    ")",    "/",    "1.2",   "42",
+      " ",     "  ",     "\t",    "\n ",  "é",    "\xff", "A",     "b",
+      "Copy",  "right",  "-",     "..."};
+  return f;
+}
+
+} // namespace
+
+TEST(NoiseFilter, KnownLines) {
+  const NoiseFilter f("memory model");
+  EXPECT_TRUE(f.isNoisy("The Memory   Model in practice"));
+  EXPECT_TRUE(f.isNoisy("see page 12"));
+  EXPECT_TRUE(f.isNoisy("Download the code"));
+  EXPECT_TRUE(f.isNoisy("call f() here"));
+  EXPECT_TRUE(f.isNoisy("http://example.com"));
+  EXPECT_TRUE(f.isNoisy("1.2.3 ..."));
+  EXPECT_TRUE(f.isNoisy("ALL CAPS Line"));
+  EXPECT_FALSE(f.isNoisy("Atomic operations"));
+  EXPECT_FALSE(f.isNoisy("Memory and the model")); // not the title
+  // an empty title is found in every line
+  EXPECT_TRUE(NoiseFilter("").isNoisy("Atomic operations"));
+}
+
+TEST(NoiseFilter, RandomLinesMatchTheTitleChecks) {
+  std::mt19937 rng(20261016);
+  const auto &f = fragments();
+  std::uniform_int_distribution<std::size_t> pick(0, f.size() - 1);
+  auto line = [&](int n) {
+    std::string s;
+    for (int i = 0; i < n; ++i)
+      s += f[pick(rng)];
+    return s;
+  };
+  std::uniform_int_distribution<int> length(0, 12);
+  for (int round = 0; round < 2000; ++round) {
+    // titles as extractChapterTitle leaves them: lower case, collapsed
+    const std::string title =
+        Text::collapseWhitespace(Text::toLower(line(round % 20 ? 2 : 0)));
+    const NoiseFilter filter(title);
+    for (int i = 0; i < 50; ++i) {
+      const std::string s = line(length(rng));
+      ASSERT_EQ(filter.isNoisy(s), oracle(s, title))
+          << "title '" << title << "', line '" << s << "'";
+    }
+  }
+}
@@ -0,0 +1,34 @@
+#pragma once
+#include <filesystem>
+#include <gtest/gtest.h>
+#include <string>
+
+// A fresh directory under the system temp dir for the running test, removed
+// with the object.
+class ScratchDir {
+public:
+  ScratchDir() {
+    const auto *info = ::testing::UnitTest::GetInstance()->current_test_info();
+    std::string name = "bookslice-";
+    if (info)
+      name += std::string(info->test_suite_name()) + '-' + info->name();
+    path_ = std::filesystem::temp_directory_path() / name;
+    std::filesystem::remove_all(path_);
+    std::filesystem::create_directories(path_);
+  }
+  ~ScratchDir() {
+    std::error_code ec;
+    std::filesystem::remove_all(path_, ec);
+  }
+
+  ScratchDir(const ScratchDir &) = delete;
+  ScratchDir &operator=(const ScratchDir &) = delete;
+
+  const std::filesystem::path &path() const noexcept { return path_; }
+  std::filesystem::path operator/(const std::string &name) const {
+    return path_ / name;
+  }
+
+private:
+  std::filesystem::path path_;
+};
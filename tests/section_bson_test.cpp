@@ -0,0 +1,155 @@
+// Builds and encodes records with the real bsoncxx and reads the documents
+// back: the filter, every $set field and the $unset of the other forms.
+#include <bsoncxx/document/view.hpp>
+#include <bsoncxx/types.hpp>
+#include <gtest/gtest.h>
+#include <set>
+#include <string>
+#include <string_view>
+
+#include "db/section_bson.hpp"
+#include "utils.hpp"
+
+namespace {
+
+std::shared_ptr<const ChapterFields> chapter(std::string stem) {
+  return std::make_shared<const ChapterFields>(ChapterFields{
+      "Book", "metadata", "/books/book.pdf", stem + ".json", stem,
+      "Chapter " + stem});
+}
+
+Record plain(std::shared_ptr<const ChapterFields> origin) {
+  Record r;
+  r.origin = std::move(origin);
+  r.section_index = 3;
+  r.title = "1.2 Section";
+  r.startline = 10;
+  r.endline = 42;
+  r.content = "section text";
+  r.content_hash = 0x0123456789abcdefull;
+  return r;
+}
+
+std::string_view str(bsoncxx::document::view doc, std::string_view key) {
+  const auto e = doc[key];
+  EXPECT_TRUE(e) << key;
+  EXPECT_EQ(e.type(), bsoncxx::type::k_string) << key;
+  return e.get_string().value;
+}
+
+std::set<std::string> keys(bsoncxx::document::view doc) {
+  std::set<std::string> out;
+  for (const auto &e : doc)
+    out.emplace(e.key());
+  return out;
+}
+
+bsoncxx::document::view sub(bsoncxx::document::view doc,
+                            std::string_view key) {
+  const auto e = doc[key];
+  EXPECT_TRUE(e) << key;
+  EXPECT_EQ(e.type(), bsoncxx::type::k_document) << key;
+  return e.get_document().value;
+}
+
+} // namespace
+
+TEST(SectionBson, FilterIsTheSectionKey) {
+  SectionBson bson;
+  const Record r = plain(chapter("01_intro"));
+  bson.encode(r);
+  EXPECT_EQ(keys(bson.filter()),
+            (std::set<std::string>{"book_title", "chapter", "title"}));
+  EXPECT_EQ(str(bson.filter(), "book_title"), "Book");
+  EXPECT_EQ(str(bson.filter(), "chapter"), "01_intro");
+  EXPECT_EQ(str(bson.filter(), "title"), "1.2 Section");
+}
+
+TEST(SectionBson, PlainContent) {
+  SectionBson bson;
+  const Record r = plain(chapter("01_intro"));
+  bson.encode(r);
+  const auto set = sub(bson.update(), "$set");
+  EXPECT_EQ(str(set, "book_title_src"), "metadata");
+  EXPECT_EQ(str(set, "book_path"), "/books/book.pdf");
+  EXPECT_EQ(str(set, "chapter_file"), "01_intro.json");
+  EXPECT_EQ(str(set, "chapter_title"), "Chapter 01_intro");
+  EXPECT_EQ(set["section_index"].get_int32().value, 3);
+  EXPECT_EQ(set["startline"].get_int32().value, 10);
+  EXPECT_EQ(set["endline"].get_int32().value, 42);
+  EXPECT_EQ(str(set, "content_hash"), Hash::hex(r.content_hash));
+  EXPECT_EQ(str(set, "content"), "section text");
+  EXPECT_FALSE(set["content_blob"]);
+  EXPECT_EQ(keys(sub(bson.update(), "$unset")),
+            (std::set<std::string>{"content_blob", "content_offset",
+                                   "content_length", "content_z",
+                                   "content_dict", "content_codec",
+                                   "content_chars"}));
+}
+
+TEST(SectionBson, ByReference) {
+  SectionBson bson;
+  Record r = plain(chapter("01_intro"));
+  r.content = {};
+  r.content_blob = "00112233-4096";
+  r.content_offset = 1 << 20;
+  r.content_length = 512;
+  bson.encode(r);
+  const auto set = sub(bson.update(), "$set");
+  EXPECT_EQ(str(set, "content_blob"), "00112233-4096");
+  EXPECT_EQ(set["content_offset"].get_int64().value, 1 << 20);
+  EXPECT_EQ(set["content_length"].get_int64().value, 512);
+  EXPECT_FALSE(set["content"]);
+  EXPECT_EQ(keys(sub(bson.update(), "$unset")),
+            (std::set<std::string>{"content", "content_z", "content_dict",
+                                   "content_codec", "content_chars"}));
+}
+
+TEST(SectionBson, PackedContentIsBinary) {
+  SectionBson bson;
+  Record r = plain(chapter("01_intro"));
+  const std::string frame("\x28\xb5\x2f\xfd\x00\x01\xff", 7);
+  r.content = {};
+  r.content_z = frame;
+  r.content_dict = "dict-1";
+  r.content_codec = 2;
+  r.content_chars = 900;
+  bson.encode(r);
+  const auto set = sub(bson.update(), "$set");
+  const auto z = set["content_z"];
+  ASSERT_TRUE(z);
+  ASSERT_EQ(z.type(), bsoncxx::type::k_binary);
+  const auto bin = z.get_binary();
+  EXPECT_EQ(bin.sub_type, bsoncxx::binary_sub_type::k_binary);
+  EXPECT_EQ(std::string_view(reinterpret_cast<const char *>(bin.bytes),
+                             bin.size),
+            frame);
+  EXPECT_EQ(str(set, "content_dict"), "dict-1");
+  EXPECT_EQ(set["content_codec"].get_int32().value, 2);
+  EXPECT_EQ(set["content_chars"].get_int64().value, 900);
+  EXPECT_EQ(keys(sub(bson.update(), "$unset")),
+            (std::set<std::string>{"content", "content_blob",
+                                   "content_offset", "content_length"}));
+}
+
+// the builders are reused: nothing of one record may reach the next
+TEST(SectionBson, ReusedAcrossRecordsAndChapters) {
+  SectionBson bson;
+  Record packed = plain(chapter("01_intro"));
+  packed.content = {};
+  packed.content_z = "zz";
+  packed.content_dict = "dict-1";
+  bson.encode(packed);
+
+  Record next = plain(chapter("02_body"));
+  next.title = "2.1 Next";
+  next.content = "other text";
+  bson.encode(next);
+  EXPECT_EQ(str(bson.filter(), "chapter"), "02_body");
+  EXPECT_EQ(str(bson.filter(), "title"), "2.1 Next");
+  const auto set = sub(bson.update(), "$set");
+  EXPECT_EQ(str(set, "chapter_file"), "02_body.json");
+  EXPECT_EQ(str(set, "content"), "other text");
+  EXPECT_EQ(str(set, "chapter"), "02_body");
+  EXPECT_FALSE(set["content_z"]);
+}
@@ -0,0 +1,137 @@
+// Differential tests of the TextMatch matchers against the std::regex
+// patterns they replaced, used the way the title helpers used them: random
+// strings built from tokens that exercise every branch, plus every short
+// sequence of those tokens. A mismatch prints the input escaped; the
+// random part is seeded from --gtest_random_seed when one is given.
+#include <gtest/gtest.h>
+#include <random>
+#include <regex>
+#include <string>
+#include <vector>
+
+#include "text_match.hpp"
+
+namespace {
+
+// the patterns exactly as the title helpers compiled them
+const std::regex &numberPrefixRe() {
+  static const std::regex re(R"(^\d+_)");
+  return re;
+}
+const std::regex &chapterTagRe() {
+  static const std::regex re(
+      R"(^(chapter|ch)\s+([0-9]+|[ivxlcdm]+)\s*[:.\-]?\s*)",
+      std::regex::icase);
+  return re;
+}
+const std::regex &pageNumberRe() {
+  static const std::regex re(R"(^\s*[0-9ivxlcdm]+\s*$)", std::regex::icase);
+  return re;
+}
+
+// Pieces of titles, page numbers and file names, and the bytes next to
+// them that must not match: every \s character, digits, roman letters in
+// both cases, near misses of "chapter", separators, a UTF-8 sequence.
+const std::vector<std::string> &tokens() {
+  static const std::vector<std::string> t = {
+      "chapter", "Chapter", "CHAPTER", "chapte", "ch", "CH", "Ch", "c",
+      "h", " ", "\t", "\n", "\v", "\f", "\r", "0", "7", "42", "i", "V",
+      "x", "L", "C", "D", "m", "iv", "MCM", "civic", ":", ".", "-", "_",
+      "a", "z", "Intro", "\xc3\xa9", "\x80", std::string(1, '\0')};
+  return t;
+}
+
+std::string escaped(std::string_view s) {
+  static constexpr char kHex[] = "0123456789abcdef";
+  std::string out = "\"";
+  for (unsigned char c : s) {
+    if (c >= 0x20 && c < 0x7f && c != '"' && c != '\\') {
+      out.push_back(static_cast<char>(c));
+      continue;
+    }
+    out += "\\x";
+    out.push_back(kHex[c >> 4]);
+    out.push_back(kHex[c & 0xf]);
+  }
+  return out + '"';
+}
+
+// every matcher against its regex on one input
+void expectSame(const std::string &s) {
+  EXPECT_EQ(s.substr(TextMatch::numberPrefix(s)),
+            std::regex_replace(s, numberPrefixRe(), ""))
+      << "numberPrefix on " << escaped(s);
+  EXPECT_EQ(s.substr(TextMatch::chapterTag(s)),
+            std::regex_replace(s, chapterTagRe(), ""))
+      << "chapterTag on " << escaped(s);
+  EXPECT_EQ(TextMatch::pageNumber(s), std::regex_match(s, pageNumberRe()))
+      << "pageNumber on " << escaped(s);
+}
+
+unsigned seed() {
+  const int given = ::testing::UnitTest::GetInstance()->random_seed();
+  return given ? static_cast<unsigned>(given) : 20261016u;
+}
+
+} // namespace
+
+TEST(TextMatch, KnownCases) {
+  for (const std::string s :
+       {"", "_", "12_intro", "12intro", "_12", "007_", "1_2_3",
+        "Chapter 3: Intro", "chapter IV. Rest", "CH 12 - x", "ch12",
+        "chapter civic", "Chapter\t\tXI", "Chapters 3", "chapter  -",
+        "chapter 3", "chapter x:", "  xiv  ", "12", "12 3", " ", "iiv",
+        "1a", "mdclxvi\n", "\v3\f"})
+    expectSame(s);
+}
+
+// all sequences of up to three tokens
+TEST(TextMatch, ShortSequencesMatchRegex) {
+  const auto &t = tokens();
+  std::vector<std::size_t> at;
+  for (std::size_t len = 0; len <= 3; ++len) {
+    at.assign(len, 0);
+    while (true) {
+      std::string s;
+      for (std::size_t k : at)
+        s += t[k];
+      expectSame(s);
+      if (::testing::Test::HasFailure())
+        return;
+      std::size_t pos = 0;
+      while (pos < len && ++at[pos] == t.size())
+        at[pos++] = 0;
+      if (pos == len)
+        break;
+    }
+  }
+}
+
+// random sequences of up to twelve tokens, starting like a chapter title
+// half the time
+TEST(TextMatch, RandomStringsMatchRegex) {
+  const unsigned s0 = seed();
+  SCOPED_TRACE("seed " + std::to_string(s0));
+  std::mt19937 rng(s0);
+  const auto &t = tokens();
+  std::uniform_int_distribution<std::size_t> token(0, t.size() - 1);
+  std::uniform_int_distribution<int> count(0, 12);
+  std::bernoulli_distribution titled(0.5);
+  const std::string heads[] = {"Chapter ", "ch ", "CHAPTER\t", "12_", " "};
+  std::uniform_int_distribution<std::size_t> head(0, std::size(heads) - 1);
+
+  for (int n = 0; n < 200000; ++n) {
+    std::string s = titled(rng) ? heads[head(rng)] : "";
+    for (int k = count(rng); k > 0; --k)
+      s += t[token(rng)];
+    expectSame(s);
+    if (::testing::Test::HasFailure())
+      return;
+  }
+}
+
+// the matchers are constexpr: the results hold at compile time too
+static_assert(TextMatch::numberPrefix("03_part") == 3);
+static_assert(TextMatch::chapterTag("Chapter 7 - Title") == 12);
+static_assert(TextMatch::pageNumber(" xii "));
+static_assert(!TextMatch::pageNumber("12a"));
@@ -0,0 +1,104 @@
+// TrigramIndex against a find() scan over the same lines. Lines holding
+// every trigram of a needle but not the needle itself must be dropped by the
+// verify step; needles shorter than a trigram take the scan path; empty
+// lines never match. Lookups are byte-exact, case included.
+#include <gtest/gtest.h>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "core/trigram_index.hpp"
+
+namespace {
+
+std::vector<int> scanAll(const std::vector<std::string> &lines,
+                         std::string_view needle) {
+  std::vector<int> out;
+  for (int i = 0; i < static_cast<int>(lines.size()); ++i)
+    if (!lines[i].empty() && lines[i].find(needle) != std::string::npos)
+      out.push_back(i);
+  return out;
+}
+
+int scanFirst(const std::vector<std::string> &lines, std::string_view needle,
+              int startAt) {
+  for (int i : scanAll(lines, needle))
+    if (i >= startAt)
+      return i;
+  return -1;
+}
+
+} // namespace
+
+TEST(TrigramIndex, TrigramsWithoutTheNeedleAreNotMatches) {
+  // abc, bca and cab all occur, "abcab" does not
+  const std::vector<std::string> lines{"abcxbcaxcab", "zzabcabzz", "cababc"};
+  const TrigramIndex index(lines);
+  EXPECT_EQ(index.findAll("abcab"), (std::vector<int>{1}));
+  EXPECT_EQ(index.findFirst("abcab"), 1);
+  EXPECT_EQ(index.findFirst("abcab", 2), -1);
+  EXPECT_EQ(index.findAll("cababc"), (std::vector<int>{2}));
+  // a trigram no line has
+  EXPECT_TRUE(index.findAll("abq").empty());
+}
+
+TEST(TrigramIndex, ShortNeedlesAndEmptyLines) {
+  const std::vector<std::string> lines{"", "ab", "xaby", "", "b"};
+  const TrigramIndex index(lines);
+  EXPECT_EQ(index.findAll("ab"), (std::vector<int>{1, 2}));
+  EXPECT_EQ(index.findAll("b"), (std::vector<int>{1, 2, 4}));
+  // the empty needle is in every non-empty line
+  EXPECT_EQ(index.findAll(""), (std::vector<int>{1, 2, 4}));
+  EXPECT_EQ(index.findFirst("", 3), 4);
+  EXPECT_EQ(index.findFirst("ab", -5), 1);
+  EXPECT_EQ(index.findFirst("ab", 3), -1);
+  EXPECT_EQ(index.findFirst("xab", 2), 2);
+  EXPECT_EQ(TrigramIndex().findFirst("abc"), -1);
+}
+
+TEST(TrigramIndex, RepeatedTrigramsAndHighBytes) {
+  const std::vector<std::string> lines{"aaa", "aaaa", "\xff\xfe\xfd\xff",
+                                       "\x7f\xfe\xfd"};
+  const TrigramIndex index(lines);
+  EXPECT_EQ(index.findAll("aaaa"), (std::vector<int>{1}));
+  EXPECT_EQ(index.findAll("aaa"), (std::vector<int>{0, 1}));
+  EXPECT_EQ(index.findAll("\xfe\xfd\xff"), (std::vector<int>{2}));
+  EXPECT_EQ(index.findAll("\xff\xfe\xfd"), (std::vector<int>{2}));
+}
+
+TEST(TrigramIndex, CaseSensitive) {
+  const std::vector<std::string> lines{"Chapter One", "chapter one"};
+  const TrigramIndex index(lines);
+  EXPECT_EQ(index.findAll("chapter"), (std::vector<int>{1}));
+  EXPECT_EQ(index.findFirst("Chapter"), 0);
+  EXPECT_EQ(index.findFirst("CHAPTER"), -1);
+}
+
+TEST(TrigramIndex, RandomLinesMatchFind) {
+  std::mt19937 rng(20261016);
+  // a small alphabet, so needles share trigrams with lines that lack them
+  const std::string alphabet = "abcab ";
+  auto text = [&](std::size_t n) {
+    std::string s;
+    for (std::size_t i = 0; i < n; ++i)
+      s.push_back(alphabet[rng() % alphabet.size()]);
+    return s;
+  };
+  for (int round = 0; round < 500; ++round) {
+    std::vector<std::string> lines;
+    for (int i = static_cast<int>(rng() % 30); i > 0; --i)
+      lines.push_back(text(rng() % 24));
+    const TrigramIndex index(lines);
+    for (int q = 0; q < 20; ++q) {
+      const std::string needle = text(rng() % 8);
+      const int startAt = static_cast<int>(rng() % 34) - 2;
+      ASSERT_EQ(index.findAll(needle), scanAll(lines, needle))
+          << "round " << round << " needle '" << needle << "'";
+      ASSERT_EQ(index.findFirst(needle, startAt),
+                scanFirst(lines, needle, startAt))
+          << "round " << round << " needle '" << needle << "' from "
+          << startAt;
+    }
+  }
+}